@@ -24,7 +24,7 @@ let package = Package(
         .target(
             name: "ORSSerial",
 			path: "Sources",
-			exclude: ["ORSSerialBuffer.h", "Resources/Info.plist"],
+			exclude: ["ORSSerialBuffer.h", "ORSSerialPacketMatcher.h", "ORSSerialErrorMarkParser.h", "ORSSerialPortCounters.h", "ORSSerialPortMonitor.h", "ORSSerialTransmitPacer.h", "ORSSerialEchoCanceller.h", "ORSSerialBaudRateProbe.h", "ORSSerialPortDiscovery.h", "ORSSerialFrameCodec.h", "ORSSerialPortTracing.h", "ORSSerialErrorLog.h", "Resources/Info.plist"],
 			cSettings: [ .define("SWIFTPM") ]
 		//	sources: ["Source/**/*.m"]
 		)
@@ -0,0 +1,39 @@
+//
+//  ORSSerialBaudRateProbe.h
+//  ORSSerialPort
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 Open Reel Software. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+@class ORSSerialRequest;
+
+/**
+ *  Finds the baud rate a device is using, by sending it a probe request at each candidate
+ *  rate in turn and checking what comes back.
+ *
+ *  A rate is accepted as soon as a response matching the request's responseDescriptor is
+ *  received. A rate is rejected as soon as most of the bytes received at it have parity or
+ *  framing errors, which is what a device sending at a different rate looks like. Otherwise,
+ *  the probe moves on after the request's timeoutInterval. If no rate got a matching response,
+ *  the one that received the most bytes without errors is chosen.
+ *
+ *  Received data must include the error marks a tty inserts when PARMRK is set.
+ */
+@interface ORSSerialBaudRateProbe : NSObject
+
+- (instancetype)initWithBaudRates:(NSArray *)baudRates request:(ORSSerialRequest *)request NS_DESIGNATED_INITIALIZER;
+
+// Switches the port to baudRate, discarding anything buffered. Returns NO on failure.
+@property (nonatomic, copy) BOOL(^configureHandler)(NSNumber *baudRate);
+// Sends data. Returns NO on failure.
+@property (nonatomic, copy) BOOL(^sendHandler)(NSData *data);
+// Called once, on the probe's queue, with the detected rate or an error
+@property (nonatomic, copy) void(^completionHandler)(NSNumber *baudRate, NSError *error);
+
+- (void)start;
+- (void)receiveData:(NSData *)data;
+
+@end
@@ -0,0 +1,164 @@
+//
+//  ORSSerialBaudRateProbe.m
+//  ORSSerialPort
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 Open Reel Software. All rights reserved.
+//
+
+#import "ORSSerialBaudRateProbe.h"
+#import "ORSSerial/ORSSerialRequest.h"
+#import "ORSSerial/ORSSerialPacketDescriptor.h"
+#import "ORSSerialBuffer.h"
+#import "ORSSerialErrorMarkParser.h"
+
+// A rate is rejected once at least this many errors have been received, and they're at least half the bytes
+static const NSUInteger ORSSerialBaudRateProbeMinimumRejectionErrorCount = 4;
+
+static const NSTimeInterval ORSSerialBaudRateProbeDefaultTimeout = 0.5;
+
+@interface ORSSerialBaudRateProbe ()
+
+@property (nonatomic, copy) NSArray *baudRates;
+@property (nonatomic, strong) ORSSerialRequest *request;
+
+// Only used on queue
+@property (nonatomic, strong) dispatch_queue_t queue;
+@property (nonatomic, strong) dispatch_source_t timeoutTimer;
+@property (nonatomic, strong) ORSSerialErrorMarkParser *errorMarkParser;
+@property (nonatomic, strong) ORSSerialBuffer *responseBuffer;
+@property (nonatomic) NSUInteger rateIndex;
+@property (nonatomic) NSUInteger receivedByteCount; // At the current rate
+@property (nonatomic) NSUInteger errorCount; // At the current rate
+@property (nonatomic, strong) NSNumber *bestBaudRate; // Received the most bytes without errors
+@property (nonatomic) NSUInteger bestBaudRateByteCount;
+@property (nonatomic) BOOL finished;
+
+@end
+
+@implementation ORSSerialBaudRateProbe
+
+- (instancetype)init NS_UNAVAILABLE
+{
+	[NSException raise:NSInternalInconsistencyException format:@"You must initialize %@ with -initWithBaudRates:request:", NSStringFromClass([self class])];
+	return nil;
+}
+
+- (instancetype)initWithBaudRates:(NSArray *)baudRates request:(ORSSerialRequest *)request
+{
+	self = [super init];
+	if (self) {
+		_baudRates = [baudRates copy];
+		_request = request;
+		_queue = dispatch_queue_create("com.openreelsoftware.ORSSerialBaudRateProbe", 0);
+		_errorMarkParser = [[ORSSerialErrorMarkParser alloc] init];
+		NSUInteger maximumLength = request.responseDescriptor.maximumPacketLength;
+		_responseBuffer = [[ORSSerialBuffer alloc] initWithMaximumLength:MAX(maximumLength, 1)];
+	}
+	return self;
+}
+
+- (void)start
+{
+	dispatch_async(self.queue, ^{ [self probeRateAtIndex:0]; });
+}
+
+- (void)receiveData:(NSData *)data
+{
+	dispatch_async(self.queue, ^{
+		if (self.finished) return;
+		
+		NSIndexSet *errorIndexes = nil, *breakIndexes = nil;
+		NSData *parsedData = [self.errorMarkParser dataByParsingData:data errorIndexes:&errorIndexes breakIndexes:&breakIndexes];
+		self.receivedByteCount += [parsedData length];
+		self.errorCount += [errorIndexes count] + [breakIndexes count];
+		
+		NSUInteger errorCount = self.errorCount;
+		if (errorCount >= ORSSerialBaudRateProbeMinimumRejectionErrorCount && errorCount * 2 >= self.receivedByteCount) {
+			[self probeRateAtIndex:self.rateIndex + 1];
+			return;
+		}
+		
+		ORSSerialPacketDescriptor *descriptor = self.request.responseDescriptor;
+		if (!descriptor) return;
+		const uint8_t *bytes = [parsedData bytes];
+		for (NSUInteger i=0; i<[parsedData length]; i++) {
+			if ([errorIndexes containsIndex:i]) {
+				[self.responseBuffer clearBuffer];
+				continue;
+			}
+			[self.responseBuffer appendBytes:bytes+i length:1];
+			if ([descriptor packetMatchingAtEndOfSerialBuffer:self.responseBuffer]) {
+				[self finishWithBaudRate:self.baudRates[self.rateIndex] error:nil];
+				return;
+			}
+		}
+	});
+}
+
+#pragma mark - Private
+
+// Must only be called on queue
+- (void)probeRateAtIndex:(NSUInteger)index
+{
+	[self scoreCurrentRate];
+	self.timeoutTimer = nil;
+	
+	if (index >= [self.baudRates count]) {
+		NSError *error = nil;
+		if (!self.bestBaudRate) {
+			error = [NSError errorWithDomain:NSPOSIXErrorDomain code:ETIMEDOUT userInfo:@{NSLocalizedDescriptionKey: @(strerror(ETIMEDOUT))}];
+		}
+		[self finishWithBaudRate:self.bestBaudRate error:error];
+		return;
+	}
+	
+	self.rateIndex = index;
+	self.receivedByteCount = 0;
+	self.errorCount = 0;
+	[self.errorMarkParser reset];
+	[self.responseBuffer clearBuffer];
+	
+	if (!self.configureHandler(self.baudRates[index]) || !self.sendHandler(self.request.dataToSend)) {
+		NSError *error = [NSError errorWithDomain:NSPOSIXErrorDomain code:errno userInfo:@{NSLocalizedDescriptionKey: @(strerror(errno))}];
+		[self finishWithBaudRate:nil error:error];
+		return;
+	}
+	
+	NSTimeInterval timeout = self.request.timeoutInterval > 0 ? self.request.timeoutInterval : ORSSerialBaudRateProbeDefaultTimeout;
+	dispatch_source_t timer = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, self.queue);
+	dispatch_source_set_timer(timer, dispatch_time(DISPATCH_TIME_NOW, (int64_t)(timeout * NSEC_PER_SEC)), DISPATCH_TIME_FOREVER, 0);
+	dispatch_source_set_event_handler(timer, ^{
+		if (self.finished || self.rateIndex != index) return;
+		[self probeRateAtIndex:index + 1];
+	});
+	dispatch_resume(timer);
+	self.timeoutTimer = timer;
+}
+
+- (void)scoreCurrentRate
+{
+	if (self.errorCount > 0 || self.receivedByteCount <= self.bestBaudRateByteCount) return;
+	if (self.rateIndex >= [self.baudRates count]) return;
+	self.bestBaudRate = self.baudRates[self.rateIndex];
+	self.bestBaudRateByteCount = self.receivedByteCount;
+}
+
+- (void)finishWithBaudRate:(NSNumber *)baudRate error:(NSError *)error
+{
+	if (self.finished) return;
+	self.finished = YES;
+	self.timeoutTimer = nil;
+	if (self.completionHandler) self.completionHandler(baudRate, error);
+	self.completionHandler = nil;
+}
+
+- (void)setTimeoutTimer:(dispatch_source_t)timeoutTimer
+{
+	if (timeoutTimer != _timeoutTimer) {
+		if (_timeoutTimer) dispatch_source_cancel(_timeoutTimer);
+		_timeoutTimer = timeoutTimer;
+	}
+}
+
+@end
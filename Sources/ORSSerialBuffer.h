@@ -8,19 +8,69 @@
 
 #import <Foundation/Foundation.h>
 
+#ifdef SWIFTPM
+#import "ORSSerial/ORSSerialPacketDescriptor.h"
+#else
+#import <ORSSerial/ORSSerialPacketDescriptor.h>
+#endif
+
 // Keep older versions of the compiler happy
 #ifndef NS_DESIGNATED_INITIALIZER
 #define NS_DESIGNATED_INITIALIZER
 #endif
 
+/**
+ *  A byte buffer that holds at most maximumLength bytes, discarding the
+ *  oldest bytes as new ones are appended.
+ *
+ *  Bytes are stored contiguously, so they can be inspected in place using
+ *  the peek methods below. Pointers returned by those methods are only valid
+ *  until the buffer is next modified. An NSData object is only created when
+ *  -data or -dataWithLastBytes: is called.
+ */
 @interface ORSSerialBuffer : NSObject
 
 - (instancetype)initWithMaximumLength:(NSUInteger)maxLength NS_DESIGNATED_INITIALIZER;
 
 - (void)appendData:(NSData *)data;
+- (void)appendBytes:(const void *)bytes length:(NSUInteger)length;
 - (void)clearBuffer;
 
-@property (nonatomic, strong, readonly) NSData *data;
+// Peeking
+- (uint8_t)byteAtIndex:(NSUInteger)index;
+- (const uint8_t *)bytes; // All buffered bytes, oldest first
+- (const uint8_t *)lastBytes:(NSUInteger)length; // The newest length bytes. length must be <= -length.
+
+// Copying
+- (NSData *)dataWithLastBytes:(NSUInteger)length;
+
+@property (nonatomic, readonly) NSUInteger length;
+@property (nonatomic, strong, readonly) NSData *data; // Returns a copy of the buffered bytes
 @property (nonatomic, readonly) NSUInteger maximumLength;
 
+// Heap memory used by the buffer and its storage, in bytes
+@property (nonatomic, readonly) NSUInteger memoryFootprint;
+
+@end
+
+@interface ORSSerialPacketDescriptor (ORSSerialBuffer)
+
+/**
+ *  Equivalent to -packetMatchingAtEndOfBuffer:, but inspects the buffer's bytes
+ *  in place. A new NSData is only created for a matching packet.
+ */
+- (NSData *)packetMatchingAtEndOfSerialBuffer:(ORSSerialBuffer *)buffer;
+
+/**
+ *  Checks windows of increasing length ending at bytes + length, returning a
+ *  copy of the first one that is a valid packet, or nil.
+ */
+- (NSData *)packetMatchingAtEndOfBytes:(const uint8_t *)bytes length:(NSUInteger)length;
+
+/**
+ *  Returns YES, and sets *byte, if every packet matching the receiver must end
+ *  with the same byte. Used to skip descriptors that can't match a received byte.
+ */
+- (BOOL)getLastPacketByte:(uint8_t *)byte;
+
 @end
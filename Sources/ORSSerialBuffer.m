@@ -7,14 +7,16 @@
 //
 
 #import "ORSSerialBuffer.h"
+#import <malloc/malloc.h>
 
-@interface ORSSerialBuffer ()
-
-@property (nonatomic, strong) NSMutableData *internalBuffer;
-
-@end
+static const NSUInteger ORSSerialBufferMinimumCapacity = 64;
 
 @implementation ORSSerialBuffer
+{
+	uint8_t *_storage;
+	NSUInteger _capacity;
+	NSUInteger _start;
+}
 
 - (instancetype)init NS_UNAVAILABLE
 {
@@ -26,31 +28,105 @@
 {
 	self = [super init];
 	if (self) {
-		_internalBuffer = [NSMutableData data];
 		_maximumLength = maxLength;
 	}
 	return self;
 }
 
+- (void)dealloc
+{
+	free(_storage);
+}
+
 - (void)appendData:(NSData *)data
 {
-	[self willChangeValueForKey:@"internalBuffer"];
-	[self.internalBuffer appendData:data];
-	if ([self.internalBuffer length] > self.maximumLength) {
-		NSRange rangeToDelete = NSMakeRange(0, [self.internalBuffer length] - self.maximumLength);
-		[self.internalBuffer replaceBytesInRange:rangeToDelete withBytes:NULL length:0];
+	[self appendBytes:[data bytes] length:[data length]];
+}
+
+- (void)appendBytes:(const void *)bytes length:(NSUInteger)length
+{
+	if (length == 0 || self.maximumLength == 0) return;
+	
+	if (length >= self.maximumLength) {
+		// Only the newest maximumLength bytes of the incoming data will survive
+		bytes = (const uint8_t *)bytes + (length - self.maximumLength);
+		length = self.maximumLength;
+		_start = 0;
+		_length = 0;
+	}
+	
+	if (_length + length > self.maximumLength) {
+		// Drop the oldest bytes
+		NSUInteger overflow = _length + length - self.maximumLength;
+		_start += overflow;
+		_length -= overflow;
 	}
-	[self didChangeValueForKey:@"internalBuffer"];
+	
+	if (_start + _length + length > _capacity) {
+		// Slide what's left to the front of storage, growing it if that's still not enough room.
+		// Storage grows to at most twice maximumLength, so sliding happens at most once per maximumLength
+		// appended bytes.
+		if (_length) memmove(_storage, _storage + _start, _length);
+		_start = 0;
+		
+		if (_length + length > _capacity) {
+			NSUInteger limit = self.maximumLength > NSUIntegerMax / 2 ? self.maximumLength : self.maximumLength * 2;
+			NSUInteger newCapacity = MAX(MAX(_capacity * 2, ORSSerialBufferMinimumCapacity), _length + length);
+			newCapacity = MIN(newCapacity, limit);
+			uint8_t *newStorage = realloc(_storage, newCapacity);
+			if (!newStorage) {
+				[NSException raise:NSMallocException format:@"Unable to grow %@ to %lu bytes", NSStringFromClass([self class]), (unsigned long)newCapacity];
+			}
+			_storage = newStorage;
+			_capacity = newCapacity;
+		}
+	}
+	
+	memcpy(_storage + _start + _length, bytes, length);
+	_length += length;
 }
 
 - (void)clearBuffer
 {
-	self.internalBuffer = [NSMutableData data];
+	_start = 0;
+	_length = 0;
+}
+
+- (uint8_t)byteAtIndex:(NSUInteger)index
+{
+	if (index >= _length) {
+		[NSException raise:NSRangeException format:@"Index %lu beyond end of buffer with length %lu", (unsigned long)index, (unsigned long)_length];
+	}
+	return _storage[_start + index];
+}
+
+- (const uint8_t *)bytes
+{
+	return _storage ? _storage + _start : NULL;
+}
+
+- (const uint8_t *)lastBytes:(NSUInteger)length
+{
+	if (length > _length) {
+		[NSException raise:NSRangeException format:@"Requested last %lu bytes of buffer with length %lu", (unsigned long)length, (unsigned long)_length];
+	}
+	return _storage ? _storage + _start + (_length - length) : NULL;
+}
+
+- (NSData *)dataWithLastBytes:(NSUInteger)length
+{
+	return [NSData dataWithBytes:[self lastBytes:length] length:length];
 }
 
 #pragma mark - Properties
 
-+ (NSSet *)keyPathsForValuesAffectingData { return [NSSet setWithObjects:@"internalData", nil]; }
-- (NSData *)data { return self.internalBuffer; }
+- (NSData *)data { return [NSData dataWithBytes:[self bytes] length:_length]; }
+
+- (NSUInteger)memoryFootprint
+{
+	NSUInteger footprint = malloc_size((__bridge const void *)self);
+	if (_storage) footprint += malloc_size(_storage);
+	return footprint;
+}
 
 @end
@@ -0,0 +1,50 @@
+//
+//  ORSSerialEchoCanceller.h
+//  ORSSerialPort
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 Open Reel Software. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+/**
+ *  Strips the local echo of sent bytes from received data, as happens on two-wire
+ *  half-duplex links where a port receives everything it transmits.
+ *
+ *  Sent bytes are recorded before they're written. Received bytes are then compared
+ *  against them in order. While echo is expected, every received byte is consumed as
+ *  echo, whether it matches or not, and mismatches are counted. Expected echo that doesn't
+ *  arrive by its deadline is given up on, and counted as missing, so a link that doesn't
+ *  echo doesn't swallow received data indefinitely.
+ *
+ *  Safe to use from multiple threads.
+ */
+@interface ORSSerialEchoCanceller : NSObject
+
+/**
+ *  Records bytes about to be sent. transmissionTime is how long the line takes to transmit them.
+ *  Their echo is expected to have been received transmissionTime plus echoTimeout after
+ *  previously expected echo.
+ */
+- (void)expectEchoOfBytes:(const void *)bytes length:(NSUInteger)length transmissionTime:(NSTimeInterval)transmissionTime;
+
+/**
+ *  Returns the number of bytes at the start of bytes that are echo, and should be discarded.
+ *  mismatchCount is set to the number of those that didn't match what was sent, and
+ *  missingByteCount to the number of expected echo bytes given up on.
+ */
+- (NSUInteger)lengthOfEchoAtStartOfBytes:(const uint8_t *)bytes
+								  length:(NSUInteger)length
+						   mismatchCount:(NSUInteger *)mismatchCount
+						missingByteCount:(NSUInteger *)missingByteCount;
+
+// Stops expecting echo of anything sent so far
+- (void)reset;
+
+@property (atomic) NSTimeInterval echoTimeout; // Defaults to 0.1 seconds
+
+// Heap memory used by the canceller and the sent bytes it's waiting for echo of, in bytes
+@property (nonatomic, readonly) NSUInteger memoryFootprint;
+
+@end
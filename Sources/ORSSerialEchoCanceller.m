@@ -0,0 +1,118 @@
+//
+//  ORSSerialEchoCanceller.m
+//  ORSSerialPort
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 Open Reel Software. All rights reserved.
+//
+
+#import "ORSSerialEchoCanceller.h"
+#import <malloc/malloc.h>
+
+@interface ORSSerialEchoCancellerChunk : NSObject
+
+@property (nonatomic, strong) NSData *data;
+@property (nonatomic) NSUInteger offset; // Number of bytes already echoed
+@property (nonatomic) NSTimeInterval deadline; // Echo not received by this time is missing
+
+@end
+
+@implementation ORSSerialEchoCancellerChunk
+@end
+
+@interface ORSSerialEchoCanceller ()
+
+@property (nonatomic, strong) NSMutableArray *chunks; // Guarded by @synchronized(self)
+
+@end
+
+@implementation ORSSerialEchoCanceller
+
+- (instancetype)init
+{
+	self = [super init];
+	if (self) {
+		_chunks = [NSMutableArray array];
+		_echoTimeout = 0.1;
+	}
+	return self;
+}
+
+- (void)expectEchoOfBytes:(const void *)bytes length:(NSUInteger)length transmissionTime:(NSTimeInterval)transmissionTime
+{
+	if (length == 0) return;
+	
+	ORSSerialEchoCancellerChunk *chunk = [[ORSSerialEchoCancellerChunk alloc] init];
+	chunk.data = [NSData dataWithBytes:bytes length:length];
+	
+	NSTimeInterval timeout = self.echoTimeout;
+	@synchronized(self) {
+		// Bytes still waiting to be transmitted delay this chunk's echo
+		NSTimeInterval start = [self currentTime];
+		ORSSerialEchoCancellerChunk *previous = [self.chunks lastObject];
+		if (previous) start = MAX(start, previous.deadline - timeout);
+		chunk.deadline = start + transmissionTime + timeout;
+		[self.chunks addObject:chunk];
+	}
+}
+
+- (NSUInteger)lengthOfEchoAtStartOfBytes:(const uint8_t *)bytes
+								  length:(NSUInteger)length
+						   mismatchCount:(NSUInteger *)mismatchCount
+						missingByteCount:(NSUInteger *)missingByteCount
+{
+	NSUInteger echoLength = 0, mismatches = 0, missing = 0;
+	@synchronized(self) {
+		NSTimeInterval now = [self currentTime];
+		while ([self.chunks count] && echoLength < length)
+		{
+			ORSSerialEchoCancellerChunk *chunk = self.chunks[0];
+			NSUInteger remaining = [chunk.data length] - chunk.offset;
+			if (chunk.deadline < now) {
+				missing += remaining;
+				[self.chunks removeObjectAtIndex:0];
+				continue;
+			}
+			
+			NSUInteger compareLength = MIN(remaining, length - echoLength);
+			const uint8_t *expected = (const uint8_t *)[chunk.data bytes] + chunk.offset;
+			if (memcmp(expected, bytes + echoLength, compareLength) != 0) {
+				for (NSUInteger i=0; i<compareLength; i++) {
+					if (expected[i] != bytes[echoLength + i]) mismatches++;
+				}
+			}
+			echoLength += compareLength;
+			chunk.offset += compareLength;
+			if (chunk.offset == [chunk.data length]) [self.chunks removeObjectAtIndex:0];
+		}
+	}
+	
+	if (mismatchCount) *mismatchCount = mismatches;
+	if (missingByteCount) *missingByteCount = missing;
+	return echoLength;
+}
+
+- (void)reset
+{
+	@synchronized(self) {
+		[self.chunks removeAllObjects];
+	}
+}
+
+#pragma mark - Private
+
+- (NSTimeInterval)currentTime { return [[NSProcessInfo processInfo] systemUptime]; }
+
+- (NSUInteger)memoryFootprint
+{
+	NSUInteger footprint = malloc_size((__bridge const void *)self);
+	@synchronized(self) {
+		footprint += malloc_size((__bridge const void *)self.chunks);
+		for (ORSSerialEchoCancellerChunk *chunk in self.chunks) {
+			footprint += malloc_size((__bridge const void *)chunk) + [chunk.data length];
+		}
+	}
+	return footprint;
+}
+
+@end
@@ -0,0 +1,62 @@
+//
+//  ORSSerialErrorLog.h
+//  ORSSerialPort
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 Open Reel Software. All rights reserved.
+//
+
+// Structured error log shared by every port in the process. Recording an error copies it
+// into a fixed-size lock-free ring buffer and returns without allocating, taking a lock or
+// doing any I/O, so it's safe on the read, write and request handling paths. A background
+// queue drains the ring to the unified logging system (subsystem
+// "com.openreelsoftware.ORSSerialPort", category "Errors"), or NSLog() before 10.12, with
+// at most ORS_SERIAL_ERROR_LOG_MAXIMUM_MESSAGES_PER_SECOND messages per second. Entries
+// over the limit, or recorded while the ring is full, are counted and reported in a summary
+// message instead. Define ORS_SERIAL_PORT_DISABLE_ERROR_LOG to compile recording out entirely.
+
+#import <Foundation/Foundation.h>
+
+#ifndef ORS_SERIAL_ERROR_LOG_CAPACITY
+#define ORS_SERIAL_ERROR_LOG_CAPACITY 256 // Must be a power of two
+#endif
+
+#ifndef ORS_SERIAL_ERROR_LOG_MAXIMUM_MESSAGES_PER_SECOND
+#define ORS_SERIAL_ERROR_LOG_MAXIMUM_MESSAGES_PER_SECOND 20
+#endif
+
+// What was being done when the error occurred
+typedef NS_ENUM(uint16_t, ORSSerialErrorLogOperation) {
+	ORSSerialErrorLogOperationOpen = 1,
+	ORSSerialErrorLogOperationConfigure,
+	ORSSerialErrorLogOperationClose,
+	ORSSerialErrorLogOperationDrain,
+	ORSSerialErrorLogOperationWrite,
+	ORSSerialErrorLogOperationModemLines,
+	ORSSerialErrorLogOperationPortDiscovery,
+	ORSSerialErrorLogOperationPowerNotifications,
+};
+
+#ifndef ORS_SERIAL_PORT_DISABLE_ERROR_LOG
+
+// Records an error. path may be nil for errors that aren't specific to a port. errorCode is
+// an errno value, or a kern_return_t for ORSSerialErrorLogOperationPortDiscovery and
+// ORSSerialErrorLogOperationPowerNotifications. function must be a string literal. Leaves errno unchanged.
+void ORSSerialErrorLogRecord(ORSSerialErrorLogOperation operation, NSString *path, int errorCode, const char *function, int line);
+
+#define ORS_LOG_SERIAL_PORT_ERROR(operation, path, errorCode) ORSSerialErrorLogRecord(operation, path, errorCode, __func__, __LINE__)
+
+// For testing. Messages are passed to handler, on the drain queue, instead of being logged. Pass nil to log them again.
+void ORSSerialErrorLogSetMessageHandler(void(^handler)(NSString *message));
+
+// For testing. Changes the rate limit from ORS_SERIAL_ERROR_LOG_MAXIMUM_MESSAGES_PER_SECOND, starting a new window.
+void ORSSerialErrorLogSetMaximumMessagesPerSecond(NSUInteger maximum);
+
+// Drains everything recorded so far, returning once it has been logged.
+void ORSSerialErrorLogFlush(void);
+
+#else
+
+#define ORS_LOG_SERIAL_PORT_ERROR(operation, path, errorCode) do {} while (0)
+
+#endif
@@ -0,0 +1,268 @@
+//
+//  ORSSerialErrorLog.m
+//  ORSSerialPort
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 Open Reel Software. All rights reserved.
+//
+//	Permission is hereby granted, free of charge, to any person obtaining a
+//	copy of this software and associated documentation files (the
+//	"Software"), to deal in the Software without restriction, including
+//	without limitation the rights to use, copy, modify, merge, publish,
+//	distribute, sublicense, and/or sell copies of the Software, and to
+//	permit persons to whom the Software is furnished to do so, subject to
+//	the following conditions:
+//
+//	The above copyright notice and this permission notice shall be included
+//	in all copies or substantial portions of the Software.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+//	OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//	CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//	TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//	SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#import "ORSSerialErrorLog.h"
+
+#ifndef ORS_SERIAL_PORT_DISABLE_ERROR_LOG
+
+#import <stdatomic.h>
+#import <time.h>
+#import <sys/time.h>
+#import <mach/mach_error.h>
+
+#if __has_include(<os/log.h>)
+#import <os/log.h>
+#endif
+
+#define ORS_SERIAL_ERROR_LOG_PATH_LENGTH 128
+
+typedef struct {
+	// Equal to the slot's index in the ring when it's free to write, and one more than that when it's
+	// been filled. Each pass around the ring adds ORS_SERIAL_ERROR_LOG_CAPACITY.
+	_Atomic(uint64_t) sequence;
+	struct timeval timestamp;
+	ORSSerialErrorLogOperation operation;
+	int errorCode;
+	const char *function;
+	int line;
+	char path[ORS_SERIAL_ERROR_LOG_PATH_LENGTH];
+} ORSSerialErrorLogEntry;
+
+_Static_assert((ORS_SERIAL_ERROR_LOG_CAPACITY & (ORS_SERIAL_ERROR_LOG_CAPACITY - 1)) == 0, "ORS_SERIAL_ERROR_LOG_CAPACITY must be a power of two");
+
+static ORSSerialErrorLogEntry ORSSerialErrorLogEntries[ORS_SERIAL_ERROR_LOG_CAPACITY];
+static _Atomic(uint64_t) ORSSerialErrorLogEnqueuePosition;
+static _Atomic(uint64_t) ORSSerialErrorLogDroppedCount;
+static dispatch_queue_t ORSSerialErrorLogDrainQueue;
+static dispatch_source_t ORSSerialErrorLogDrainSource;
+
+// Only touched on the drain source's queue
+static uint64_t ORSSerialErrorLogDequeuePosition;
+static NSUInteger ORSSerialErrorLogMaximumMessagesPerSecond = ORS_SERIAL_ERROR_LOG_MAXIMUM_MESSAGES_PER_SECOND;
+static void(^ORSSerialErrorLogMessageHandler)(NSString *message);
+static time_t ORSSerialErrorLogWindowStart;
+static NSUInteger ORSSerialErrorLogMessagesInWindow;
+static uint64_t ORSSerialErrorLogSuppressedCount;
+static BOOL ORSSerialErrorLogSummaryScheduled;
+
+static void ORSSerialErrorLogDrain(void);
+
+static void ORSSerialErrorLogInitialize(void)
+{
+	static dispatch_once_t onceToken;
+	dispatch_once(&onceToken, ^{
+		for (uint64_t i=0; i<ORS_SERIAL_ERROR_LOG_CAPACITY; i++) {
+			atomic_init(&ORSSerialErrorLogEntries[i].sequence, i);
+		}
+
+		dispatch_queue_attr_t attributes = dispatch_queue_attr_make_with_qos_class(DISPATCH_QUEUE_SERIAL, QOS_CLASS_UTILITY, 0);
+		ORSSerialErrorLogDrainQueue = dispatch_queue_create("com.openreelsoftware.ORSSerialPort.errorLog", attributes);
+		ORSSerialErrorLogDrainSource = dispatch_source_create(DISPATCH_SOURCE_TYPE_DATA_ADD, 0, 0, ORSSerialErrorLogDrainQueue);
+		dispatch_source_set_event_handler(ORSSerialErrorLogDrainSource, ^{ ORSSerialErrorLogDrain(); });
+		dispatch_resume(ORSSerialErrorLogDrainSource);
+	});
+}
+
+void ORSSerialErrorLogRecord(ORSSerialErrorLogOperation operation, NSString *path, int errorCode, const char *function, int line)
+{
+	int savedErrno = errno;
+	ORSSerialErrorLogInitialize();
+
+	// Multiple producer, single consumer bounded queue. A producer claims a slot by advancing
+	// the enqueue position, then publishes it by bumping the slot's sequence once it's filled in.
+	ORSSerialErrorLogEntry *entry = NULL;
+	uint64_t position = atomic_load_explicit(&ORSSerialErrorLogEnqueuePosition, memory_order_relaxed);
+	while (1) {
+		entry = &ORSSerialErrorLogEntries[position & (ORS_SERIAL_ERROR_LOG_CAPACITY - 1)];
+		uint64_t sequence = atomic_load_explicit(&entry->sequence, memory_order_acquire);
+		int64_t difference = (int64_t)sequence - (int64_t)position;
+		if (difference == 0) {
+			if (atomic_compare_exchange_weak_explicit(&ORSSerialErrorLogEnqueuePosition, &position, position + 1,
+													  memory_order_relaxed, memory_order_relaxed)) break;
+		} else if (difference < 0) {
+			// Full. The drain hasn't caught up, so don't wait for it.
+			atomic_fetch_add_explicit(&ORSSerialErrorLogDroppedCount, 1, memory_order_relaxed);
+			dispatch_source_merge_data(ORSSerialErrorLogDrainSource, 1);
+			errno = savedErrno;
+			return;
+		} else {
+			position = atomic_load_explicit(&ORSSerialErrorLogEnqueuePosition, memory_order_relaxed);
+		}
+	}
+
+	gettimeofday(&entry->timestamp, NULL);
+	entry->operation = operation;
+	entry->errorCode = errorCode;
+	entry->function = function;
+	entry->line = line;
+	entry->path[0] = '\0';
+	if (path) {
+		// Converts as much of the path as fits, without allocating
+		CFIndex usedLength = 0;
+		CFStringGetBytes((__bridge CFStringRef)path, CFRangeMake(0, CFStringGetLength((__bridge CFStringRef)path)),
+						 kCFStringEncodingUTF8, '?', false, (UInt8 *)entry->path, sizeof(entry->path) - 1, &usedLength);
+		entry->path[usedLength] = '\0';
+	}
+	atomic_store_explicit(&entry->sequence, position + 1, memory_order_release);
+
+	dispatch_source_merge_data(ORSSerialErrorLogDrainSource, 1);
+	errno = savedErrno;
+}
+
+#pragma mark - Draining
+
+static const char *ORSSerialErrorLogOperationName(ORSSerialErrorLogOperation operation)
+{
+	switch (operation) {
+		case ORSSerialErrorLogOperationOpen: return "open";
+		case ORSSerialErrorLogOperationConfigure: return "configure";
+		case ORSSerialErrorLogOperationClose: return "close";
+		case ORSSerialErrorLogOperationDrain: return "drain";
+		case ORSSerialErrorLogOperationWrite: return "write";
+		case ORSSerialErrorLogOperationModemLines: return "modem lines";
+		case ORSSerialErrorLogOperationPortDiscovery: return "port discovery";
+		case ORSSerialErrorLogOperationPowerNotifications: return "power notifications";
+	}
+	return "unknown";
+}
+
+static void ORSSerialErrorLogWriteMessage(NSString *message)
+{
+	if (ORSSerialErrorLogMessageHandler) {
+		ORSSerialErrorLogMessageHandler(message);
+		return;
+	}
+	
+#if __has_include(<os/log.h>)
+	if (@available(macOS 10.12, *)) {
+		static os_log_t log;
+		static dispatch_once_t onceToken;
+		dispatch_once(&onceToken, ^{
+			log = os_log_create("com.openreelsoftware.ORSSerialPort", "Errors");
+		});
+		os_log_error(log, "%{public}@", message);
+		return;
+	}
+#endif
+	NSLog(@"%@", message);
+}
+
+static NSString *ORSSerialErrorLogMessageForEntry(const ORSSerialErrorLogEntry *entry)
+{
+	char timeString[32] = "";
+	struct tm time;
+	if (localtime_r(&entry->timestamp.tv_sec, &time)) strftime(timeString, sizeof(timeString), "%H:%M:%S", &time);
+
+	BOOL isKernReturn = (entry->operation == ORSSerialErrorLogOperationPortDiscovery ||
+						 entry->operation == ORSSerialErrorLogOperationPowerNotifications);
+	const char *description = "failed";
+	if (entry->errorCode) description = isKernReturn ? mach_error_string(entry->errorCode) : strerror(entry->errorCode);
+
+	return [NSString stringWithFormat:@"ORSSerialPort %s error on %s: %s (%s %d) in %s:%d at %s.%03ld",
+			ORSSerialErrorLogOperationName(entry->operation),
+			entry->path[0] ? entry->path : "(no port)",
+			description,
+			isKernReturn ? "kern_return_t" : "errno",
+			entry->errorCode,
+			entry->function,
+			entry->line,
+			timeString,
+			(long)(entry->timestamp.tv_usec / 1000)];
+}
+
+// Reports entries that were over the rate limit once the window they were in has passed
+static void ORSSerialErrorLogScheduleSummary(void)
+{
+	if (ORSSerialErrorLogSummaryScheduled) return;
+	ORSSerialErrorLogSummaryScheduled = YES;
+	dispatch_after(dispatch_time(DISPATCH_TIME_NOW, NSEC_PER_SEC), ORSSerialErrorLogDrainQueue, ^{
+		ORSSerialErrorLogSummaryScheduled = NO;
+		ORSSerialErrorLogDrain();
+	});
+}
+
+static void ORSSerialErrorLogDrain(void)
+{
+	time_t now = time(NULL);
+	if (now != ORSSerialErrorLogWindowStart) {
+		ORSSerialErrorLogWindowStart = now;
+		ORSSerialErrorLogMessagesInWindow = 0;
+		if (ORSSerialErrorLogSuppressedCount) {
+			ORSSerialErrorLogWriteMessage([NSString stringWithFormat:@"ORSSerialPort suppressed %llu error messages over the rate limit",
+										   ORSSerialErrorLogSuppressedCount]);
+			ORSSerialErrorLogSuppressedCount = 0;
+		}
+	}
+
+	uint64_t droppedCount = atomic_exchange_explicit(&ORSSerialErrorLogDroppedCount, 0, memory_order_relaxed);
+	if (droppedCount) {
+		ORSSerialErrorLogWriteMessage([NSString stringWithFormat:@"ORSSerialPort dropped %llu error messages because the error log was full", droppedCount]);
+	}
+
+	while (1) {
+		uint64_t position = ORSSerialErrorLogDequeuePosition;
+		ORSSerialErrorLogEntry *entry = &ORSSerialErrorLogEntries[position & (ORS_SERIAL_ERROR_LOG_CAPACITY - 1)];
+		if (atomic_load_explicit(&entry->sequence, memory_order_acquire) != position + 1) break; // Empty, or still being filled in
+
+		if (ORSSerialErrorLogMessagesInWindow < ORSSerialErrorLogMaximumMessagesPerSecond) {
+			ORSSerialErrorLogMessagesInWindow++;
+			NSString *message = ORSSerialErrorLogMessageForEntry(entry);
+			atomic_store_explicit(&entry->sequence, position + ORS_SERIAL_ERROR_LOG_CAPACITY, memory_order_release);
+			ORSSerialErrorLogWriteMessage(message);
+		} else {
+			ORSSerialErrorLogSuppressedCount++;
+			atomic_store_explicit(&entry->sequence, position + ORS_SERIAL_ERROR_LOG_CAPACITY, memory_order_release);
+		}
+		ORSSerialErrorLogDequeuePosition = position + 1;
+	}
+
+	if (ORSSerialErrorLogSuppressedCount) ORSSerialErrorLogScheduleSummary();
+}
+
+void ORSSerialErrorLogFlush(void)
+{
+	ORSSerialErrorLogInitialize();
+	dispatch_sync(ORSSerialErrorLogDrainQueue, ^{ ORSSerialErrorLogDrain(); });
+}
+
+#pragma mark - Testing
+
+void ORSSerialErrorLogSetMessageHandler(void(^handler)(NSString *message))
+{
+	ORSSerialErrorLogInitialize();
+	dispatch_sync(ORSSerialErrorLogDrainQueue, ^{ ORSSerialErrorLogMessageHandler = [handler copy]; });
+}
+
+void ORSSerialErrorLogSetMaximumMessagesPerSecond(NSUInteger maximum)
+{
+	ORSSerialErrorLogInitialize();
+	dispatch_sync(ORSSerialErrorLogDrainQueue, ^{
+		ORSSerialErrorLogMaximumMessagesPerSecond = maximum;
+		ORSSerialErrorLogMessagesInWindow = 0;
+	});
+}
+
+#endif
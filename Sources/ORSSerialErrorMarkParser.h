@@ -0,0 +1,35 @@
+//
+//  ORSSerialErrorMarkParser.h
+//  ORSSerialPort
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 Open Reel Software. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+/**
+ *  Removes the escape sequences a tty inserts into received data when PARMRK is set.
+ *
+ *  With PARMRK (and without IGNPAR, IGNBRK or ISTRIP), the driver marks a byte received with
+ *  a parity or framing error as 0xFF 0x00 <byte>, a break as 0xFF 0x00 0x00, and escapes a
+ *  real 0xFF byte as 0xFF 0xFF. Note that a 0x00 byte received with an error can't be
+ *  distinguished from a break, so it is reported as a break.
+ *
+ *  Escape sequences may be split across calls. Chunks without any 0xFF bytes are found with
+ *  a single memchr() scan and returned unchanged.
+ */
+@interface ORSSerialErrorMarkParser : NSObject
+
+/**
+ *  Returns data with escape sequences removed. *errorIndexes is set to the indexes in the
+ *  returned data of bytes received with errors, and *breakIndexes to the indexes at which
+ *  breaks were received (a break at index i came before the byte at i, and may be equal to
+ *  the returned data's length). Both are set to nil if there were none.
+ */
+- (NSData *)dataByParsingData:(NSData *)data errorIndexes:(NSIndexSet **)errorIndexes breakIndexes:(NSIndexSet **)breakIndexes;
+
+// Discards any partially received escape sequence
+- (void)reset;
+
+@end
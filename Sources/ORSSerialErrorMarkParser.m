@@ -0,0 +1,94 @@
+//
+//  ORSSerialErrorMarkParser.m
+//  ORSSerialPort
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 Open Reel Software. All rights reserved.
+//
+
+#import "ORSSerialErrorMarkParser.h"
+
+typedef NS_ENUM(NSUInteger, ORSSerialErrorMarkParserState) {
+	ORSSerialErrorMarkParserStateData,
+	ORSSerialErrorMarkParserStateMark, // Received 0xFF
+	ORSSerialErrorMarkParserStateMarkZero, // Received 0xFF 0x00
+};
+
+static const uint8_t ORSSerialErrorMark = 0xFF;
+
+@interface ORSSerialErrorMarkParser ()
+
+@property (nonatomic) ORSSerialErrorMarkParserState state;
+
+@end
+
+@implementation ORSSerialErrorMarkParser
+
+- (NSData *)dataByParsingData:(NSData *)data errorIndexes:(NSIndexSet **)errorIndexes breakIndexes:(NSIndexSet **)breakIndexes
+{
+	if (errorIndexes) *errorIndexes = nil;
+	if (breakIndexes) *breakIndexes = nil;
+	
+	const uint8_t *bytes = [data bytes];
+	NSUInteger length = [data length];
+	if (!length) return data;
+	if (self.state == ORSSerialErrorMarkParserStateData && !memchr(bytes, ORSSerialErrorMark, length)) return data;
+	
+	NSMutableData *result = [NSMutableData dataWithCapacity:length];
+	NSMutableIndexSet *errors = nil;
+	NSMutableIndexSet *breaks = nil;
+	ORSSerialErrorMarkParserState state = self.state;
+	const uint8_t *p = bytes, *end = bytes + length;
+	while (p < end)
+	{
+		switch (state) {
+			case ORSSerialErrorMarkParserStateData: {
+				// Copy everything up to the next mark in one go
+				const uint8_t *mark = memchr(p, ORSSerialErrorMark, end - p);
+				const uint8_t *runEnd = mark ?: end;
+				[result appendBytes:p length:runEnd - p];
+				p = runEnd;
+				if (mark) {
+					state = ORSSerialErrorMarkParserStateMark;
+					p++;
+				}
+				break;
+			}
+			case ORSSerialErrorMarkParserStateMark:
+				if (*p == 0x00) {
+					state = ORSSerialErrorMarkParserStateMarkZero;
+				} else {
+					// 0xFF 0xFF is an escaped 0xFF. Anything else isn't a valid sequence, so pass it through.
+					[result appendBytes:&ORSSerialErrorMark length:1];
+					if (*p != ORSSerialErrorMark) [result appendBytes:p length:1];
+					state = ORSSerialErrorMarkParserStateData;
+				}
+				p++;
+				break;
+			case ORSSerialErrorMarkParserStateMarkZero:
+				if (*p == 0x00) {
+					if (!breaks) breaks = [NSMutableIndexSet indexSet];
+					[breaks addIndex:[result length]];
+				} else {
+					if (!errors) errors = [NSMutableIndexSet indexSet];
+					[errors addIndex:[result length]];
+					[result appendBytes:p length:1];
+				}
+				state = ORSSerialErrorMarkParserStateData;
+				p++;
+				break;
+		}
+	}
+	self.state = state;
+	
+	if (errorIndexes) *errorIndexes = errors;
+	if (breakIndexes) *breakIndexes = breaks;
+	return result;
+}
+
+- (void)reset
+{
+	self.state = ORSSerialErrorMarkParserStateData;
+}
+
+@end
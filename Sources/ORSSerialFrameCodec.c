@@ -0,0 +1,401 @@
+//
+//  ORSSerialFrameCodec.c
+//  ORSSerialPort
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 Open Reel Software. All rights reserved.
+//
+//	Permission is hereby granted, free of charge, to any person obtaining a
+//	copy of this software and associated documentation files (the
+//	"Software"), to deal in the Software without restriction, including
+//	without limitation the rights to use, copy, modify, merge, publish,
+//	distribute, sublicense, and/or sell copies of the Software, and to
+//	permit persons to whom the Software is furnished to do so, subject to
+//	the following conditions:
+//
+//	The above copyright notice and this permission notice shall be included
+//	in all copies or substantial portions of the Software.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+//	OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//	CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//	TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//	SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "ORSSerialFrameCodec.h"
+#include <string.h>
+
+#define ORS_LZ_MINIMUM_MATCH 3
+#define ORS_LZ_MAXIMUM_MATCH (0x7F + ORS_LZ_MINIMUM_MATCH)
+#define ORS_LZ_MAXIMUM_LITERALS 0x80
+#define ORS_LZ_MAXIMUM_OFFSET 0xFFFF
+#define ORS_LZ_HASH_BITS 10
+
+static uint16_t ORSSerialCRC16(const uint8_t *bytes, size_t length, uint16_t crc)
+{
+	for (size_t i=0; i<length; i++) {
+		crc ^= (uint16_t)bytes[i] << 8;
+		for (int bit=0; bit<8; bit++) {
+			crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+		}
+	}
+	return crc;
+}
+
+static uint32_t ORSSerialLZHash(const uint8_t *bytes)
+{
+	uint32_t value = (uint32_t)bytes[0] | ((uint32_t)bytes[1] << 8) | ((uint32_t)bytes[2] << 16);
+	return (value * 2654435761u) >> (32 - ORS_LZ_HASH_BITS);
+}
+
+// Appends literals to destination. Returns the new output position, or 0 if there isn't room.
+static size_t ORSSerialLZEmitLiterals(const uint8_t *literals, size_t count, uint8_t *destination, size_t position, size_t capacity)
+{
+	while (count > 0) {
+		size_t run = count < ORS_LZ_MAXIMUM_LITERALS ? count : ORS_LZ_MAXIMUM_LITERALS;
+		if (position + 1 + run >= capacity) return 0;
+		destination[position++] = (uint8_t)(run - 1);
+		memcpy(destination + position, literals, run);
+		position += run;
+		literals += run;
+		count -= run;
+	}
+	return position;
+}
+
+size_t ORSSerialLZCompress(const uint8_t *source, size_t length, uint8_t *destination, size_t capacity)
+{
+	int32_t table[1 << ORS_LZ_HASH_BITS]; // Last position each hash was seen at
+	for (size_t i=0; i<(1 << ORS_LZ_HASH_BITS); i++) table[i] = -1;
+	
+	size_t position = 0, literalStart = 0, i = 0;
+	while (i + ORS_LZ_MINIMUM_MATCH <= length) {
+		uint32_t hash = ORSSerialLZHash(source + i);
+		int32_t candidate = table[hash];
+		table[hash] = (int32_t)i;
+		
+		size_t matchLength = 0;
+		if (candidate >= 0 && i - (size_t)candidate <= ORS_LZ_MAXIMUM_OFFSET) {
+			size_t limit = length - i < ORS_LZ_MAXIMUM_MATCH ? length - i : ORS_LZ_MAXIMUM_MATCH;
+			while (matchLength < limit && source[candidate + matchLength] == source[i + matchLength]) matchLength++;
+		}
+		if (matchLength < ORS_LZ_MINIMUM_MATCH) {
+			i++;
+			continue;
+		}
+		
+		position = ORSSerialLZEmitLiterals(source + literalStart, i - literalStart, destination, position, capacity);
+		if ((literalStart != i && position == 0) || position + 3 >= capacity) return 0;
+		size_t offset = i - (size_t)candidate;
+		destination[position++] = (uint8_t)(0x80 | (matchLength - ORS_LZ_MINIMUM_MATCH));
+		destination[position++] = (uint8_t)(offset & 0xFF);
+		destination[position++] = (uint8_t)(offset >> 8);
+		i += matchLength;
+		literalStart = i;
+	}
+	
+	if (literalStart < length) {
+		position = ORSSerialLZEmitLiterals(source + literalStart, length - literalStart, destination, position, capacity);
+	}
+	return position;
+}
+
+size_t ORSSerialLZDecompress(const uint8_t *source, size_t length, uint8_t *destination, size_t capacity)
+{
+	size_t i = 0, position = 0;
+	while (i < length) {
+		uint8_t control = source[i++];
+		if (control < 0x80) {
+			size_t run = (size_t)control + 1;
+			if (i + run > length || position + run > capacity) return SIZE_MAX;
+			memcpy(destination + position, source + i, run);
+			position += run;
+			i += run;
+		} else {
+			if (i + 2 > length) return SIZE_MAX;
+			size_t matchLength = (size_t)(control & 0x7F) + ORS_LZ_MINIMUM_MATCH;
+			size_t offset = (size_t)source[i] | ((size_t)source[i+1] << 8);
+			i += 2;
+			if (offset == 0 || offset > position || position + matchLength > capacity) return SIZE_MAX;
+			// Byte by byte, since a match can overlap the bytes it produces
+			for (size_t j=0; j<matchLength; j++, position++) destination[position] = destination[position - offset];
+		}
+	}
+	return position;
+}
+
+// Appends a delta producing payload from reference to destination. Returns its length, or 0
+// if it would be capacity bytes or more.
+static size_t ORSSerialDeltaEncode(const uint8_t *reference, size_t referenceLength, const uint8_t *payload, size_t length, uint8_t *destination, size_t capacity)
+{
+	size_t i = 0, position = 0;
+	while (i < length) {
+		size_t run = 0;
+		if (i < referenceLength && payload[i] == reference[i]) {
+			while (i + run < length && i + run < referenceLength && run < 0x80 && payload[i + run] == reference[i + run]) run++;
+			if (position + 1 >= capacity) return 0;
+			destination[position++] = (uint8_t)(run - 1);
+		} else {
+			// A single unchanged byte costs as much as a copy token, so only end at two
+			while (i + run < length && run < 0x80) {
+				size_t j = i + run;
+				int same = j < referenceLength && payload[j] == reference[j];
+				int nextSame = j + 1 >= length || (j + 1 < referenceLength && payload[j + 1] == reference[j + 1]);
+				if (same && nextSame) break;
+				run++;
+			}
+			if (position + 1 + run >= capacity) return 0;
+			destination[position++] = (uint8_t)(0x80 | (run - 1));
+			memcpy(destination + position, payload + i, run);
+			position += run;
+		}
+		i += run;
+	}
+	return position;
+}
+
+// Returns the length of the payload produced by applying delta to reference, or SIZE_MAX if delta is malformed
+static size_t ORSSerialDeltaApply(const uint8_t *reference, size_t referenceLength, const uint8_t *delta, size_t length, uint8_t *destination, size_t capacity)
+{
+	size_t i = 0, position = 0;
+	while (i < length) {
+		uint8_t control = delta[i++];
+		size_t run = (size_t)(control & 0x7F) + 1;
+		if (position + run > capacity) return SIZE_MAX;
+		if (control < 0x80) {
+			if (position + run > referenceLength) return SIZE_MAX;
+			memcpy(destination + position, reference + position, run);
+		} else {
+			if (i + run > length) return SIZE_MAX;
+			memcpy(destination + position, delta + i, run);
+			i += run;
+		}
+		position += run;
+	}
+	return position;
+}
+
+void ORSSerialFrameReferencesReset(ORSSerialFrameReferences *references, uint8_t messageType)
+{
+	if (messageType == 0) {
+		memset(references->lengths, 0, sizeof(references->lengths));
+	} else if (messageType <= ORS_SERIAL_FRAME_MESSAGE_TYPE_COUNT) {
+		references->lengths[messageType - 1] = 0;
+	}
+}
+
+// Writes content to body, compressed if that makes it smaller. Returns its length.
+static size_t ORSSerialFrameEncodeContent(const uint8_t *content, size_t length, uint8_t *body, uint8_t *flags)
+{
+	size_t compressedLength = ORSSerialLZCompress(content, length, body, length);
+	if (compressedLength > 0) {
+		*flags |= ORS_SERIAL_FRAME_FLAG_COMPRESSED;
+		return compressedLength;
+	}
+	memcpy(body, content, length);
+	return length;
+}
+
+// Fills in the header and CRC of a frame whose body has been written. Returns the frame's length.
+static size_t ORSSerialFrameFinish(uint8_t *frame, uint8_t flags, size_t bodyLength)
+{
+	frame[0] = ORS_SERIAL_FRAME_START_BYTE;
+	frame[1] = flags;
+	frame[2] = (uint8_t)(bodyLength & 0xFF);
+	frame[3] = (uint8_t)(bodyLength >> 8);
+	uint8_t *trailer = frame + ORS_SERIAL_FRAME_HEADER_LENGTH + bodyLength;
+	uint16_t crc = ORSSerialCRC16(frame + 1, ORS_SERIAL_FRAME_HEADER_LENGTH - 1 + bodyLength, 0xFFFF);
+	trailer[0] = (uint8_t)(crc & 0xFF);
+	trailer[1] = (uint8_t)(crc >> 8);
+	return ORS_SERIAL_FRAME_MAXIMUM_LENGTH(bodyLength);
+}
+
+size_t ORSSerialFrameEncode(const uint8_t *payload, size_t payloadLength, uint8_t *frame)
+{
+	if (payloadLength > ORS_SERIAL_FRAME_MAXIMUM_PAYLOAD_LENGTH) return 0;
+	
+	uint8_t flags = 0;
+	size_t bodyLength = ORSSerialFrameEncodeContent(payload, payloadLength, frame + ORS_SERIAL_FRAME_HEADER_LENGTH, &flags);
+	return ORSSerialFrameFinish(frame, flags, bodyLength);
+}
+
+size_t ORSSerialFrameEncodeMessage(const uint8_t *payload, size_t payloadLength, uint8_t messageType, ORSSerialFrameReferences *references, uint8_t *frame)
+{
+	if (payloadLength > ORS_SERIAL_FRAME_MAXIMUM_MESSAGE_LENGTH) return 0;
+	if (messageType == 0 || messageType > ORS_SERIAL_FRAME_MESSAGE_TYPE_COUNT) return 0;
+	
+	uint8_t flags = ORS_SERIAL_FRAME_FLAG_TYPED;
+	uint8_t *body = frame + ORS_SERIAL_FRAME_HEADER_LENGTH;
+	body[0] = messageType;
+	size_t typeLength = 1;
+	const uint8_t *content = payload;
+	size_t contentLength = payloadLength;
+	uint8_t delta[ORS_SERIAL_FRAME_MAXIMUM_MESSAGE_LENGTH];
+	
+	if (references) {
+		uint8_t *reference = references->payloads[messageType - 1];
+		size_t referenceLength = references->lengths[messageType - 1];
+		if (referenceLength > 0) {
+			// The reference's CRC takes 2 bytes, so the delta has to save more than that
+			size_t deltaLength = ORSSerialDeltaEncode(reference, referenceLength, payload, payloadLength, delta, payloadLength);
+			if (deltaLength > 0 && deltaLength + 2 < payloadLength) {
+				uint16_t crc = ORSSerialCRC16(reference, referenceLength, 0xFFFF);
+				flags |= ORS_SERIAL_FRAME_FLAG_DELTA;
+				body[1] = (uint8_t)(crc & 0xFF);
+				body[2] = (uint8_t)(crc >> 8);
+				typeLength = 3;
+				content = delta;
+				contentLength = deltaLength;
+			}
+		}
+		memcpy(reference, payload, payloadLength);
+		references->lengths[messageType - 1] = payloadLength;
+	}
+	
+	size_t bodyLength = typeLength + ORSSerialFrameEncodeContent(content, contentLength, body + typeLength, &flags);
+	return ORSSerialFrameFinish(frame, flags, bodyLength);
+}
+
+size_t ORSSerialFrameEncodeResync(uint8_t messageType, uint8_t *frame)
+{
+	frame[ORS_SERIAL_FRAME_HEADER_LENGTH] = messageType;
+	return ORSSerialFrameFinish(frame, ORS_SERIAL_FRAME_FLAG_RESYNC, 1);
+}
+
+void ORSSerialFrameDecoderReset(ORSSerialFrameDecoder *decoder)
+{
+	decoder->frameLength = 0;
+}
+
+// Drops the start byte of a corrupt frame, and everything up to the next start byte after it
+static void ORSSerialFrameDecoderDiscardFrame(ORSSerialFrameDecoder *decoder)
+{
+	decoder->discardedFrameCount++;
+	uint8_t *nextStart = memchr(decoder->frame + 1, ORS_SERIAL_FRAME_START_BYTE, decoder->frameLength - 1);
+	if (!nextStart) {
+		decoder->frameLength = 0;
+		return;
+	}
+	decoder->frameLength -= (size_t)(nextStart - decoder->frame);
+	memmove(decoder->frame, nextStart, decoder->frameLength);
+}
+
+// Removes a complete frame from the start of the buffer. Bytes kept after a corrupt frame
+// can run past its end, so anything up to the next start byte is dropped too.
+static void ORSSerialFrameDecoderConsumeFrame(ORSSerialFrameDecoder *decoder, size_t frameLength)
+{
+	uint8_t *nextStart = memchr(decoder->frame + frameLength, ORS_SERIAL_FRAME_START_BYTE, decoder->frameLength - frameLength);
+	if (!nextStart) {
+		decoder->frameLength = 0;
+		return;
+	}
+	decoder->frameLength -= (size_t)(nextStart - decoder->frame);
+	memmove(decoder->frame, nextStart, decoder->frameLength);
+}
+
+typedef enum {
+	ORSSerialFrameBodyValid = 0,
+	ORSSerialFrameBodyInvalid,
+	ORSSerialFrameBodyMissingReference,
+} ORSSerialFrameBodyStatus;
+
+// Decodes the body of an intact frame into decoder->payload
+static ORSSerialFrameBodyStatus ORSSerialFrameDecoderDecodeBody(ORSSerialFrameDecoder *decoder, uint8_t flags, const uint8_t *body, size_t bodyLength, uint8_t *messageType, size_t *payloadLength)
+{
+	size_t typeLength = 0;
+	*messageType = 0;
+	if (flags & (ORS_SERIAL_FRAME_FLAG_TYPED | ORS_SERIAL_FRAME_FLAG_RESYNC)) {
+		if (bodyLength < 1) return ORSSerialFrameBodyInvalid;
+		*messageType = body[0];
+		typeLength = 1;
+	}
+	if (flags & ORS_SERIAL_FRAME_FLAG_RESYNC) return ORSSerialFrameBodyValid;
+	if ((flags & ORS_SERIAL_FRAME_FLAG_TYPED) && (*messageType == 0 || *messageType > ORS_SERIAL_FRAME_MESSAGE_TYPE_COUNT)) return ORSSerialFrameBodyInvalid;
+	
+	uint16_t referenceCRC = 0;
+	if (flags & ORS_SERIAL_FRAME_FLAG_DELTA) {
+		if (!(flags & ORS_SERIAL_FRAME_FLAG_TYPED) || bodyLength < 3) return ORSSerialFrameBodyInvalid;
+		referenceCRC = (uint16_t)body[1] | (uint16_t)(body[2] << 8);
+		typeLength = 3;
+	}
+	
+	const uint8_t *content = body + typeLength;
+	size_t contentLength = bodyLength - typeLength;
+	if (flags & ORS_SERIAL_FRAME_FLAG_COMPRESSED) {
+		contentLength = ORSSerialLZDecompress(content, contentLength, decoder->content, sizeof(decoder->content));
+		if (contentLength == SIZE_MAX) return ORSSerialFrameBodyInvalid;
+		content = decoder->content;
+	}
+	
+	if (!(flags & ORS_SERIAL_FRAME_FLAG_DELTA)) {
+		if (*messageType != 0 && contentLength > ORS_SERIAL_FRAME_MAXIMUM_MESSAGE_LENGTH) return ORSSerialFrameBodyInvalid;
+		memcpy(decoder->payload, content, contentLength);
+		*payloadLength = contentLength;
+		return ORSSerialFrameBodyValid;
+	}
+	
+	ORSSerialFrameReferences *references = decoder->references;
+	if (!references) return ORSSerialFrameBodyMissingReference;
+	const uint8_t *reference = references->payloads[*messageType - 1];
+	size_t referenceLength = references->lengths[*messageType - 1];
+	if (referenceLength == 0 || referenceCRC != ORSSerialCRC16(reference, referenceLength, 0xFFFF)) return ORSSerialFrameBodyMissingReference;
+	*payloadLength = ORSSerialDeltaApply(reference, referenceLength, content, contentLength, decoder->payload, ORS_SERIAL_FRAME_MAXIMUM_MESSAGE_LENGTH);
+	return *payloadLength == SIZE_MAX ? ORSSerialFrameBodyInvalid : ORSSerialFrameBodyValid;
+}
+
+// Decodes the frame at the start of the buffer, if it's complete. Returns 1 if a frame was
+// removed from the buffer, and 0 if more bytes are needed.
+static int ORSSerialFrameDecoderDecodeFrame(ORSSerialFrameDecoder *decoder, ORSSerialFrameHandler handler, void *context)
+{
+	if (decoder->frameLength < ORS_SERIAL_FRAME_HEADER_LENGTH) return 0;
+	size_t bodyLength = (size_t)decoder->frame[2] | ((size_t)decoder->frame[3] << 8);
+	if (bodyLength > ORS_SERIAL_FRAME_MAXIMUM_PAYLOAD_LENGTH) {
+		ORSSerialFrameDecoderDiscardFrame(decoder);
+		return 1;
+	}
+	size_t frameLength = ORS_SERIAL_FRAME_MAXIMUM_LENGTH(bodyLength);
+	if (decoder->frameLength < frameLength) return 0;
+	
+	uint8_t flags = decoder->frame[1];
+	const uint8_t *body = decoder->frame + ORS_SERIAL_FRAME_HEADER_LENGTH;
+	uint16_t crc = (uint16_t)body[bodyLength] | (uint16_t)(body[bodyLength + 1] << 8);
+	if (crc != ORSSerialCRC16(decoder->frame + 1, ORS_SERIAL_FRAME_HEADER_LENGTH - 1 + bodyLength, 0xFFFF)) {
+		ORSSerialFrameDecoderDiscardFrame(decoder);
+		return 1;
+	}
+	
+	// The frame is intact, so it's consumed whole even if it can't be used
+	uint8_t messageType = 0;
+	size_t payloadLength = 0;
+	ORSSerialFrameBodyStatus status = ORSSerialFrameDecoderDecodeBody(decoder, flags, body, bodyLength, &messageType, &payloadLength);
+	ORSSerialFrameDecoderConsumeFrame(decoder, frameLength);
+	if (status != ORSSerialFrameBodyValid) {
+		decoder->discardedFrameCount++;
+		// Deltas of this type can't be decoded until the peer sends a whole payload
+		if (status == ORSSerialFrameBodyMissingReference) handler(ORSSerialFrameEventResyncNeeded, messageType, NULL, 0, context);
+		return 1;
+	}
+	if (flags & ORS_SERIAL_FRAME_FLAG_RESYNC) {
+		handler(ORSSerialFrameEventResyncRequested, messageType, NULL, 0, context);
+		return 1;
+	}
+	
+	if (messageType != 0 && decoder->references) {
+		memcpy(decoder->references->payloads[messageType - 1], decoder->payload, payloadLength);
+		decoder->references->lengths[messageType - 1] = payloadLength;
+	}
+	handler(ORSSerialFrameEventPayload, messageType, decoder->payload, payloadLength, context);
+	return 1;
+}
+
+void ORSSerialFrameDecoderPushBytes(ORSSerialFrameDecoder *decoder, const uint8_t *bytes, size_t length, ORSSerialFrameHandler handler, void *context)
+{
+	for (size_t i=0; i<length; i++) {
+		if (decoder->frameLength == 0 && bytes[i] != ORS_SERIAL_FRAME_START_BYTE) continue;
+		decoder->frame[decoder->frameLength++] = bytes[i];
+		// Bytes kept after discarding a corrupt frame may hold more than one frame
+		while (ORSSerialFrameDecoderDecodeFrame(decoder, handler, context)) {}
+	}
+}
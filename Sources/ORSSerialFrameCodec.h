@@ -0,0 +1,152 @@
+//
+//  ORSSerialFrameCodec.h
+//  ORSSerialPort
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 Open Reel Software. All rights reserved.
+//
+//	Permission is hereby granted, free of charge, to any person obtaining a
+//	copy of this software and associated documentation files (the
+//	"Software"), to deal in the Software without restriction, including
+//	without limitation the rights to use, copy, modify, merge, publish,
+//	distribute, sublicense, and/or sell copies of the Software, and to
+//	permit persons to whom the Software is furnished to do so, subject to
+//	the following conditions:
+//
+//	The above copyright notice and this permission notice shall be included
+//	in all copies or substantial portions of the Software.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+//	OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//	CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//	TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//	SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+// Compressed framing for serial links. This file and ORSSerialFrameCodec.c only depend on
+// the C standard library, so they can be built into the firmware of a peer device as the
+// reference implementation of the other end of the link.
+//
+// Frame format, all multi-byte fields little-endian:
+//
+//   0xC5 | flags (1) | body length (2) | body | CRC-16 (2)
+//
+// The CRC is CRC-16/CCITT-FALSE over the flags, length and body. Flags:
+//
+//   bit 0, compressed: the content is LZ77 compressed, as described below. Content is only
+//          sent compressed if that makes it smaller.
+//   bit 1, typed: the body starts with a message type byte, from 1 to ORS_SERIAL_FRAME_MESSAGE_TYPE_COUNT.
+//          Each end keeps the last payload sent and received of each type as a reference.
+//   bit 2, delta: the content is a delta against the reference for the message type, which follows
+//          the type byte as its 2 byte CRC-16. Only sent if smaller than the payload itself.
+//   bit 3, resync: asks the receiver to discard its sent reference for the message type, or all
+//          of them for type 0, because a delta couldn't be applied. There's no content.
+//
+// The rest of the body is the content. Untyped frames carry a payload of up to
+// ORS_SERIAL_FRAME_MAXIMUM_PAYLOAD_LENGTH bytes, and typed frames one of up to
+// ORS_SERIAL_FRAME_MAXIMUM_MESSAGE_LENGTH bytes.
+//
+// Compressed content is a sequence of LZ77 tokens, each starting with a control byte c:
+//
+//   c < 0x80:  (c + 1) literal bytes follow
+//   c >= 0x80: a match of ((c & 0x7F) + 3) bytes, copied from (offset) bytes back in the
+//              decompressed output. A 2 byte offset follows.
+//
+// Deltas are a sequence of tokens producing the payload from the start, each starting with a control byte c:
+//
+//   c < 0x80:  (c + 1) bytes are the same as the reference at the same position
+//   c >= 0x80: ((c & 0x7F) + 1) replacement bytes follow
+
+#ifndef ORSSerialFrameCodec_h
+#define ORSSerialFrameCodec_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ORS_SERIAL_FRAME_START_BYTE 0xC5
+#define ORS_SERIAL_FRAME_FLAG_COMPRESSED 0x01
+#define ORS_SERIAL_FRAME_FLAG_TYPED 0x02
+#define ORS_SERIAL_FRAME_FLAG_DELTA 0x04
+#define ORS_SERIAL_FRAME_FLAG_RESYNC 0x08
+#define ORS_SERIAL_FRAME_HEADER_LENGTH 4
+#define ORS_SERIAL_FRAME_TRAILER_LENGTH 2
+#define ORS_SERIAL_FRAME_MAXIMUM_PAYLOAD_LENGTH 1024
+#define ORS_SERIAL_FRAME_MAXIMUM_MESSAGE_LENGTH (ORS_SERIAL_FRAME_MAXIMUM_PAYLOAD_LENGTH - 3)
+
+// Peers with little memory can define this as fewer message types, as long as both ends agree
+#ifndef ORS_SERIAL_FRAME_MESSAGE_TYPE_COUNT
+#define ORS_SERIAL_FRAME_MESSAGE_TYPE_COUNT 8
+#endif
+
+// The largest a frame encoding payloadLength bytes (at most ORS_SERIAL_FRAME_MAXIMUM_PAYLOAD_LENGTH) can be
+#define ORS_SERIAL_FRAME_MAXIMUM_LENGTH(payloadLength) ((payloadLength) + ORS_SERIAL_FRAME_HEADER_LENGTH + ORS_SERIAL_FRAME_TRAILER_LENGTH)
+
+// Compresses length bytes from source into destination. Returns the compressed length, or 0
+// if it would be capacity bytes or more.
+size_t ORSSerialLZCompress(const uint8_t *source, size_t length, uint8_t *destination, size_t capacity);
+
+// Decompresses length bytes from source into destination. Returns the decompressed length,
+// or SIZE_MAX if source is malformed or doesn't fit in capacity bytes.
+size_t ORSSerialLZDecompress(const uint8_t *source, size_t length, uint8_t *destination, size_t capacity);
+
+// The last payload of each message type, used as the reference for deltas. One set is
+// needed for sent frames, and another for received frames.
+typedef struct {
+	uint8_t payloads[ORS_SERIAL_FRAME_MESSAGE_TYPE_COUNT][ORS_SERIAL_FRAME_MAXIMUM_MESSAGE_LENGTH];
+	size_t lengths[ORS_SERIAL_FRAME_MESSAGE_TYPE_COUNT]; // 0 if there's no reference
+} ORSSerialFrameReferences;
+
+// Discards the reference for messageType, or all of them if messageType is 0
+void ORSSerialFrameReferencesReset(ORSSerialFrameReferences *references, uint8_t messageType);
+
+// Encodes payloadLength bytes (at most ORS_SERIAL_FRAME_MAXIMUM_PAYLOAD_LENGTH) as a frame in
+// frame, which must have room for ORS_SERIAL_FRAME_MAXIMUM_LENGTH(payloadLength) bytes.
+// Returns the frame's length, or 0 if payload is too long.
+size_t ORSSerialFrameEncode(const uint8_t *payload, size_t payloadLength, uint8_t *frame);
+
+// Encodes a payload of up to ORS_SERIAL_FRAME_MAXIMUM_MESSAGE_LENGTH bytes as a typed frame,
+// as a delta against the sent reference for messageType in references if that's smaller, and
+// makes it the new reference. frame must have room for ORS_SERIAL_FRAME_MAXIMUM_LENGTH(payloadLength + 3)
+// bytes. Returns the frame's length, or 0 if payload is too long or messageType is out of range.
+size_t ORSSerialFrameEncodeMessage(const uint8_t *payload, size_t payloadLength, uint8_t messageType, ORSSerialFrameReferences *references, uint8_t *frame);
+
+// Encodes a resync frame for messageType, or all message types if 0, in frame, which must have
+// room for ORS_SERIAL_FRAME_MAXIMUM_LENGTH(1) bytes. Returns the frame's length.
+size_t ORSSerialFrameEncodeResync(uint8_t messageType, uint8_t *frame);
+
+typedef enum {
+	ORSSerialFrameEventPayload = 0, // A payload was received
+	ORSSerialFrameEventResyncRequested, // The peer asked for the sent reference for the message type, or all of them if 0, to be discarded
+	ORSSerialFrameEventResyncNeeded, // A delta couldn't be applied, so a resync frame for the message type should be sent
+} ORSSerialFrameEvent;
+
+// Called for each decoded frame. messageType is 0 for untyped frames. payload is only valid until the handler returns.
+typedef void (*ORSSerialFrameHandler)(ORSSerialFrameEvent event, uint8_t messageType, const uint8_t *payload, size_t length, void *context);
+
+typedef struct {
+	uint8_t frame[ORS_SERIAL_FRAME_MAXIMUM_LENGTH(ORS_SERIAL_FRAME_MAXIMUM_PAYLOAD_LENGTH)];
+	size_t frameLength;
+	uint8_t content[ORS_SERIAL_FRAME_MAXIMUM_PAYLOAD_LENGTH];
+	uint8_t payload[ORS_SERIAL_FRAME_MAXIMUM_PAYLOAD_LENGTH];
+	ORSSerialFrameReferences *references; // Received references. If NULL, delta frames can't be decoded.
+	unsigned long discardedFrameCount; // Frames with a bad CRC, length, compressed content or delta
+} ORSSerialFrameDecoder;
+
+// Discards any partially received frame. Doesn't change references.
+void ORSSerialFrameDecoderReset(ORSSerialFrameDecoder *decoder);
+
+// Feeds received bytes to decoder, calling handler for each complete frame. Bytes outside
+// frames are skipped, and after a corrupt frame, decoding resumes at the next start byte within it.
+// A corrupt length field delays the frames behind it until that many bytes have been received.
+void ORSSerialFrameDecoderPushBytes(ORSSerialFrameDecoder *decoder, const uint8_t *bytes, size_t length, ORSSerialFrameHandler handler, void *context);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ORSSerialFrameCodec_h */
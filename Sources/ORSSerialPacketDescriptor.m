@@ -25,10 +25,12 @@
 //	SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #import "ORSSerial/ORSSerialPacketDescriptor.h"
+#import "ORSSerialBuffer.h"
 
 @interface ORSSerialPacketDescriptor ()
 
 @property (nonatomic, copy, readonly) ORSSerialPacketEvaluator responseEvaluator;
+@property (nonatomic, readonly) BOOL usesBuiltInPacketValidation; // Set once, when initialized
 
 @end
 
@@ -50,6 +52,15 @@
 		_userInfo = userInfo;
 		_responseEvaluator = [responseEvaluator ?: ^BOOL(NSData *d){ return [d length] > 0; } copy];
 		_uuid = [NSUUID UUID];
+		
+		// Subclasses that override -dataIsValidPacket: must be asked about every window, so they
+		// can't use the fast paths in -packetMatchingAtEndOfBytes:length:
+		static IMP builtInImplementation = NULL;
+		static dispatch_once_t onceToken;
+		dispatch_once(&onceToken, ^{
+			builtInImplementation = [ORSSerialPacketDescriptor instanceMethodForSelector:@selector(dataIsValidPacket:)];
+		});
+		_usesBuiltInPacketValidation = [self methodForSelector:@selector(dataIsValidPacket:)] == builtInImplementation;
 	}
 	return self;
 }
@@ -139,12 +150,65 @@
 
 - (NSData *)packetMatchingAtEndOfBuffer:(NSData *)buffer
 {
-	for (NSUInteger i=1; i<=[buffer length]; i++)
+	return [self packetMatchingAtEndOfBytes:[buffer bytes] length:[buffer length]];
+}
+
+@end
+
+@implementation ORSSerialPacketDescriptor (ORSSerialBuffer)
+
+// Checks windows of increasing length ending at the end of bytes, returning a copy of the first valid one.
+// Fixed data and prefix/suffix descriptors are matched directly against the bytes. Other descriptors
+// are given no-copy windows, so bytes are only copied once a packet has been found.
+- (NSData *)packetMatchingAtEndOfBytes:(const uint8_t *)bytes length:(NSUInteger)length
+{
+	if (length == 0) return nil;
+	
+	BOOL usesBuiltInValidation = self.usesBuiltInPacketValidation;
+	if (self.packetData && usesBuiltInValidation) {
+		NSUInteger packetLength = [self.packetData length];
+		if (packetLength == 0 || packetLength > length) return nil;
+		if (memcmp(bytes + length - packetLength, [self.packetData bytes], packetLength) != 0) return nil;
+		return [self.packetData copy];
+	}
+	
+	if ((self.prefix || self.suffix) && usesBuiltInValidation) {
+		NSUInteger prefixLength = [self.prefix length];
+		NSUInteger suffixLength = [self.suffix length];
+		if (suffixLength > length) return nil;
+		if (suffixLength && memcmp(bytes + length - suffixLength, [self.suffix bytes], suffixLength) != 0) return nil;
+		
+		NSUInteger minimumLength = MAX(MAX(prefixLength, suffixLength), 1);
+		const uint8_t *prefixBytes = [self.prefix bytes];
+		for (NSUInteger i=minimumLength; i<=length; i++)
+		{
+			const uint8_t *windowStart = bytes + length - i;
+			if (prefixLength && (*windowStart != prefixBytes[0] || memcmp(windowStart, prefixBytes, prefixLength) != 0)) continue;
+			return [NSData dataWithBytes:windowStart length:i];
+		}
+		return nil;
+	}
+	
+	for (NSUInteger i=1; i<=length; i++)
 	{
-		NSData *window = [buffer subdataWithRange:NSMakeRange([buffer length]-i, i)];
-		if ([self dataIsValidPacket:window]) return window;
+		const uint8_t *windowStart = bytes + length - i;
+		NSData *window = [NSData dataWithBytesNoCopy:(void *)windowStart length:i freeWhenDone:NO];
+		if ([self dataIsValidPacket:window]) return [NSData dataWithBytes:windowStart length:i];
 	}
 	return nil;
 }
 
+- (NSData *)packetMatchingAtEndOfSerialBuffer:(ORSSerialBuffer *)buffer
+{
+	return [self packetMatchingAtEndOfBytes:[buffer bytes] length:[buffer length]];
+}
+
+- (BOOL)getLastPacketByte:(uint8_t *)byte
+{
+	NSData *ending = self.packetData ?: self.suffix;
+	if (![ending length] || !self.usesBuiltInPacketValidation) return NO;
+	if (byte) *byte = ((const uint8_t *)[ending bytes])[[ending length]-1];
+	return YES;
+}
+
 @end
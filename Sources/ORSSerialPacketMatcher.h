@@ -0,0 +1,97 @@
+//
+//  ORSSerialPacketMatcher.h
+//  ORSSerialPort
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 Open Reel Software. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+#ifdef SWIFTPM
+#import "ORSSerial/ORSSerialPacketStatistics.h"
+#else
+#import <ORSSerial/ORSSerialPacketStatistics.h>
+#endif
+
+@class ORSSerialPacketDescriptor;
+
+typedef void(^ORSSerialPacketMatchHandler)(ORSSerialPacketDescriptor *descriptor, NSData *packet);
+
+/**
+ *  Finds packets matching a set of packet descriptors in a stream of bytes.
+ *
+ *  All descriptors share a single ORSSerialBuffer, sized for the longest
+ *  descriptor. Each descriptor only looks at the bytes received since its
+ *  last match, up to its own maximum packet length. Received packet sizes
+ *  are tracked per descriptor, and can optionally be used to shrink the
+ *  lengths searched (and the shared buffer) to fit the actual traffic.
+ *  Descriptors with a fixed last byte keep room for packets twice as long as
+ *  those seen so far, search it when the last byte arrives without a match,
+ *  and double it whenever it turns out to be full, so the lengths grow again
+ *  if longer packets start arriving.
+ *
+ *  Descriptors are evaluated in order of priority, then by how often they've
+ *  matched, so that when descriptors are mutually exclusive the most likely
+ *  match is found first.
+ *
+ *  When descriptors are added or removed, they are compiled into a plan that
+ *  lists, for each possible byte, the descriptors that could match a packet
+ *  ending with it. Descriptors with a fixed suffix (or fixed packet data) are
+ *  only evaluated when their last byte arrives.
+ *
+ *  Descriptors can be added and removed, and options changed, from any thread
+ *  without blocking. Changes take effect from the next appended byte. Matching
+ *  (-appendByte:matchHandler:) and -statisticsForPacketDescriptor: must only be
+ *  called from one thread at a time. ORSSerialPort only calls them on its
+ *  requestHandlingQueue.
+ */
+@interface ORSSerialPacketMatcher : NSObject
+
+- (void)addPacketDescriptor:(ORSSerialPacketDescriptor *)descriptor;
+- (void)removePacketDescriptor:(ORSSerialPacketDescriptor *)descriptor;
+
+// Adds or removes several descriptors at once. The matching plan is only rebuilt once.
+- (void)addPacketDescriptors:(NSArray *)descriptors;
+- (void)removePacketDescriptors:(NSArray *)descriptors;
+- (BOOL)containsPacketDescriptor:(ORSSerialPacketDescriptor *)descriptor;
+
+/**
+ *  Appends byte to the shared buffer, and calls handler for each descriptor
+ *  that finds a complete packet ending with it.
+ */
+- (void)appendByte:(uint8_t)byte matchHandler:(ORSSerialPacketMatchHandler)handler;
+
+// Discards the bytes all descriptors have received so far, so none of them can be part of a packet
+- (void)discardPartialPackets;
+
+- (ORSSerialPacketStatistics *)statisticsForPacketDescriptor:(ORSSerialPacketDescriptor *)descriptor;
+
+@property (nonatomic, copy, readonly) NSArray *packetDescriptors;
+
+// When YES, evaluation of a byte stops at the first (highest priority) descriptor that matches a
+// packet, and all other descriptors' buffered bytes are discarded.
+@property (atomic) BOOL descriptorsAreMutuallyExclusive;
+
+// When YES, each descriptor's search length is reduced to its recommended maximum packet
+// length once enough packets have been seen. Longer packets that are matched raise it again.
+@property (atomic) BOOL automaticallyTunesBufferLength;
+
+// Size of the shared buffer
+@property (nonatomic, readonly) NSUInteger bufferLength;
+
+// Heap memory used by matching state and the shared buffer, in bytes. Like matching, must only
+// be called from one thread at a time.
+@property (nonatomic, readonly) NSUInteger memoryFootprint;
+
+@end
+
+@interface ORSSerialPacketStatistics (ORSSerialPacketMatcher)
+
+- (instancetype)initWithPacketDescriptor:(ORSSerialPacketDescriptor *)descriptor
+							 packetCount:(NSUInteger)packetCount
+					 minimumPacketLength:(NSUInteger)minimumLength
+					 maximumPacketLength:(NSUInteger)maximumLength
+					   totalPacketLength:(unsigned long long)totalLength;
+
+@end
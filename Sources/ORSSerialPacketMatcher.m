@@ -0,0 +1,426 @@
+//
+//  ORSSerialPacketMatcher.m
+//  ORSSerialPort
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 Open Reel Software. All rights reserved.
+//
+
+#import "ORSSerialPacketMatcher.h"
+#import "ORSSerialBuffer.h"
+#import "ORSSerial/ORSSerialPacketDescriptor.h"
+#import <malloc/malloc.h>
+
+// Number of packets that must be seen for a descriptor before its search length is tuned
+static const NSUInteger ORSSerialPacketMatcherTuningSampleCount = 32;
+
+// Factor by which the room kept for packets longer than the search length exceeds it
+static const NSUInteger ORSSerialPacketMatcherRetryLengthFactor = 2;
+
+// Number of matches between re-sorting descriptors by hit rate
+static const NSUInteger ORSSerialPacketMatcherSortInterval = 64;
+
+@interface ORSSerialPacketMatchState : NSObject
+
+- (instancetype)initWithPacketDescriptor:(ORSSerialPacketDescriptor *)descriptor;
+
+@property (nonatomic, strong, readonly) ORSSerialPacketDescriptor *descriptor;
+@property (nonatomic, readonly) BOOL hasLastPacketByte; // Whether every packet ends with lastPacketByte
+@property (nonatomic, readonly) uint8_t lastPacketByte;
+@property (nonatomic) NSUInteger searchLength; // Maximum number of trailing bytes to search
+@property (nonatomic) NSUInteger retryLength; // Searched instead when the last byte arrives with no match within searchLength
+@property (nonatomic) unsigned long long windowStartIndex; // Index of the first byte received since the last match
+@property (nonatomic) unsigned long long firstByteIndex; // Index of the first byte the descriptor saw
+@property (nonatomic) BOOL adopted; // Whether matching has started for the descriptor
+
+// Statistics
+@property (nonatomic) NSUInteger packetCount;
+@property (nonatomic) NSUInteger minimumPacketLength;
+@property (nonatomic) NSUInteger maximumPacketLength;
+@property (nonatomic) unsigned long long totalPacketLength;
+
+- (ORSSerialPacketStatistics *)statistics;
+
+@end
+
+@implementation ORSSerialPacketMatchState
+
+- (instancetype)initWithPacketDescriptor:(ORSSerialPacketDescriptor *)descriptor
+{
+	self = [super init];
+	if (self) {
+		_descriptor = descriptor;
+		_hasLastPacketByte = [descriptor getLastPacketByte:&_lastPacketByte];
+		_searchLength = descriptor.maximumPacketLength;
+		_retryLength = _searchLength;
+	}
+	return self;
+}
+
+- (ORSSerialPacketStatistics *)statistics
+{
+	return [[ORSSerialPacketStatistics alloc] initWithPacketDescriptor:self.descriptor
+														   packetCount:self.packetCount
+												   minimumPacketLength:self.minimumPacketLength
+												   maximumPacketLength:self.maximumPacketLength
+													 totalPacketLength:self.totalPacketLength];
+}
+
+@end
+
+/**
+ *  A set of installed descriptors compiled for matching: the order to evaluate
+ *  them in, and for each possible byte, the descriptors that could match a packet
+ *  ending with that byte. Immutable once created, so it can be built on one thread
+ *  and used on another.
+ */
+@interface ORSSerialPacketMatchPlan : NSObject
+
+// Evaluates states by priority, keeping installation order otherwise
+- (instancetype)initWithInstalledStates:(NSArray *)installedStates;
+- (instancetype)initWithInstalledStates:(NSArray *)installedStates evaluationOrder:(NSArray *)states;
+
+- (NSArray *)candidateStatesForByte:(uint8_t)byte; // In evaluation order
+
+@property (nonatomic, copy, readonly) NSArray *installedStates; // In the order they were installed
+@property (nonatomic, copy, readonly) NSArray *states; // In evaluation order
+@property (nonatomic, readonly) NSUInteger maximumPacketLength; // Longest declared maximum packet length
+
+@end
+
+@implementation ORSSerialPacketMatchPlan
+{
+	NSArray *_candidateStates[256];
+}
+
+- (instancetype)initWithInstalledStates:(NSArray *)installedStates
+{
+	NSArray *states = [installedStates sortedArrayWithOptions:NSSortStable usingComparator:^NSComparisonResult(ORSSerialPacketMatchState *state1, ORSSerialPacketMatchState *state2) {
+		NSInteger priority1 = state1.descriptor.priority, priority2 = state2.descriptor.priority;
+		if (priority1 == priority2) return NSOrderedSame;
+		return priority1 > priority2 ? NSOrderedAscending : NSOrderedDescending;
+	}];
+	return [self initWithInstalledStates:installedStates evaluationOrder:states];
+}
+
+- (instancetype)initWithInstalledStates:(NSArray *)installedStates evaluationOrder:(NSArray *)states
+{
+	self = [super init];
+	if (self) {
+		_installedStates = [installedStates copy];
+		_states = [states copy];
+		
+		// Descriptors without a fixed last byte are candidates for every byte
+		uint8_t lastBytes[256];
+		NSUInteger lastByteCount = 0;
+		for (ORSSerialPacketMatchState *state in _states) {
+			_maximumPacketLength = MAX(_maximumPacketLength, state.descriptor.maximumPacketLength);
+			if (!state.hasLastPacketByte || _candidateStates[state.lastPacketByte]) continue;
+			_candidateStates[state.lastPacketByte] = [NSMutableArray array];
+			lastBytes[lastByteCount++] = state.lastPacketByte;
+		}
+		
+		NSMutableArray *otherStates = [NSMutableArray array];
+		for (ORSSerialPacketMatchState *state in _states) {
+			if (state.hasLastPacketByte) {
+				[(NSMutableArray *)_candidateStates[state.lastPacketByte] addObject:state];
+				continue;
+			}
+			[otherStates addObject:state];
+			for (NSUInteger i=0; i<lastByteCount; i++) {
+				[(NSMutableArray *)_candidateStates[lastBytes[i]] addObject:state];
+			}
+		}
+		
+		for (NSUInteger i=0; i<256; i++) {
+			if (!_candidateStates[i]) _candidateStates[i] = otherStates;
+		}
+	}
+	return self;
+}
+
+- (NSArray *)candidateStatesForByte:(uint8_t)byte { return _candidateStates[byte]; }
+
+@end
+
+@interface ORSSerialPacketMatcher ()
+
+// The installed descriptors, compiled into a plan when they are installed. A new
+// plan is published atomically whenever descriptors are added or removed, so the set
+// can be changed from any thread without waiting for matching in progress.
+@property (atomic, strong) ORSSerialPacketMatchPlan *installedPlan;
+
+// Everything below is only used by the thread doing the matching
+@property (nonatomic, strong) ORSSerialPacketMatchPlan *adoptedInstalledPlan; // installedPlan as of the last byte
+@property (nonatomic) BOOL adoptedTuning; // automaticallyTunesBufferLength as of the last byte
+@property (nonatomic, strong) ORSSerialPacketMatchPlan *plan; // adoptedInstalledPlan, re-sorted by hit rate
+@property (nonatomic, strong) ORSSerialBuffer *buffer;
+@property (nonatomic) unsigned long long byteCount;
+@property (nonatomic) unsigned long long consumedByteCount; // Bytes no descriptor may use, e.g. consumed by a mutually exclusive match
+@property (nonatomic) NSUInteger matchesSinceSort;
+
+@end
+
+@implementation ORSSerialPacketMatcher
+
+- (instancetype)init
+{
+	self = [super init];
+	if (self) {
+		_installedPlan = [[ORSSerialPacketMatchPlan alloc] initWithInstalledStates:@[]];
+		_adoptedInstalledPlan = _installedPlan;
+		_plan = _installedPlan;
+		_buffer = [[ORSSerialBuffer alloc] initWithMaximumLength:0];
+	}
+	return self;
+}
+
+- (void)addPacketDescriptor:(ORSSerialPacketDescriptor *)descriptor
+{
+	if (descriptor) [self addPacketDescriptors:@[descriptor]];
+}
+
+- (void)removePacketDescriptor:(ORSSerialPacketDescriptor *)descriptor
+{
+	if (descriptor) [self removePacketDescriptors:@[descriptor]];
+}
+
+- (void)addPacketDescriptors:(NSArray *)descriptors
+{
+	@synchronized(self) {
+		NSMutableArray *states = [self.installedPlan.installedStates mutableCopy];
+		NSMutableSet *installedDescriptors = [NSMutableSet setWithArray:[states valueForKey:@"descriptor"]];
+		for (ORSSerialPacketDescriptor *descriptor in descriptors) {
+			if ([installedDescriptors containsObject:descriptor]) continue;
+			[installedDescriptors addObject:descriptor];
+			[states addObject:[[ORSSerialPacketMatchState alloc] initWithPacketDescriptor:descriptor]];
+		}
+		if ([states count] == [self.installedPlan.installedStates count]) return;
+		self.installedPlan = [[ORSSerialPacketMatchPlan alloc] initWithInstalledStates:states];
+	}
+}
+
+- (void)removePacketDescriptors:(NSArray *)descriptors
+{
+	@synchronized(self) {
+		NSSet *removedDescriptors = [NSSet setWithArray:descriptors];
+		NSIndexSet *indexes = [self.installedPlan.installedStates indexesOfObjectsPassingTest:^BOOL(ORSSerialPacketMatchState *state, NSUInteger idx, BOOL *stop) {
+			return [removedDescriptors containsObject:state.descriptor];
+		}];
+		if (![indexes count]) return;
+		
+		NSMutableArray *states = [self.installedPlan.installedStates mutableCopy];
+		[states removeObjectsAtIndexes:indexes];
+		self.installedPlan = [[ORSSerialPacketMatchPlan alloc] initWithInstalledStates:states];
+	}
+}
+
+- (BOOL)containsPacketDescriptor:(ORSSerialPacketDescriptor *)descriptor
+{
+	return [self stateForPacketDescriptor:descriptor] != nil;
+}
+
+- (void)appendByte:(uint8_t)byte matchHandler:(ORSSerialPacketMatchHandler)handler
+{
+	[self adoptInstalledPlan];
+	if (![self.plan.states count]) return;
+	
+	[self.buffer appendBytes:&byte length:1];
+	unsigned long long byteCount = ++self.byteCount;
+	NSUInteger bufferedLength = self.buffer.length;
+	
+	BOOL exclusive = self.descriptorsAreMutuallyExclusive;
+	BOOL needsResize = NO;
+	BOOL matched = NO;
+	for (ORSSerialPacketMatchState *state in [self.plan candidateStatesForByte:byte])
+	{
+		// Search the bytes received since the descriptor's last match, up to its search length
+		unsigned long long windowStart = MAX(state.windowStartIndex, self.consumedByteCount);
+		NSUInteger windowLength = (NSUInteger)MIN(byteCount - windowStart, (unsigned long long)MIN(state.searchLength, bufferedLength));
+		if (!windowLength) continue;
+		
+		NSData *packet = [state.descriptor packetMatchingAtEndOfBytes:[self.buffer lastBytes:windowLength] length:windowLength];
+		if (![packet length] && state.hasLastPacketByte && state.retryLength > state.searchLength) {
+			packet = [self packetMatchingLongerWindowForState:state windowStart:windowStart previousLength:windowLength needsResize:&needsResize];
+		}
+		if (![packet length]) continue;
+		
+		state.windowStartIndex = byteCount;
+		needsResize |= [self recordPacketOfLength:[packet length] forState:state];
+		handler(state.descriptor, packet);
+		matched = YES;
+		if (exclusive) break;
+	}
+	
+	// The packet consumed its bytes, so no other descriptor may use them
+	if (matched && exclusive) self.consumedByteCount = byteCount;
+	
+	if (matched && ++self.matchesSinceSort >= ORSSerialPacketMatcherSortInterval) [self sortStates];
+	if (needsResize) [self resizeBuffer];
+}
+
+- (void)discardPartialPackets
+{
+	self.consumedByteCount = self.byteCount;
+}
+
+- (ORSSerialPacketStatistics *)statisticsForPacketDescriptor:(ORSSerialPacketDescriptor *)descriptor
+{
+	return [[self stateForPacketDescriptor:descriptor] statistics];
+}
+
+#pragma mark - Private
+
+- (ORSSerialPacketMatchState *)stateForPacketDescriptor:(ORSSerialPacketDescriptor *)descriptor
+{
+	for (ORSSerialPacketMatchState *state in self.installedPlan.installedStates) {
+		if ([state.descriptor isEqual:descriptor]) return state;
+	}
+	return nil;
+}
+
+// Picks up descriptors installed or removed, and tuning turned on or off, since the last byte.
+// The installed plan is already compiled, so this only has to note where new descriptors start.
+- (void)adoptInstalledPlan
+{
+	ORSSerialPacketMatchPlan *installedPlan = self.installedPlan;
+	BOOL tuning = self.automaticallyTunesBufferLength;
+	if (installedPlan == self.adoptedInstalledPlan && tuning == self.adoptedTuning) return;
+	
+	if (installedPlan != self.adoptedInstalledPlan) {
+		BOOL hasMatches = NO;
+		for (ORSSerialPacketMatchState *state in installedPlan.states) {
+			hasMatches |= state.packetCount > 0;
+			if (state.adopted) continue;
+			state.adopted = YES;
+			state.firstByteIndex = self.byteCount;
+			state.windowStartIndex = self.byteCount;
+		}
+		self.plan = installedPlan;
+		self.adoptedInstalledPlan = installedPlan;
+		
+		// The installed plan is only ordered by priority. Restore hit rate order at the next match.
+		if (hasMatches) self.matchesSinceSort = ORSSerialPacketMatcherSortInterval;
+	}
+	
+	for (ORSSerialPacketMatchState *state in self.plan.states) {
+		[self updateSearchLengthForState:state tuning:tuning];
+	}
+	self.adoptedTuning = tuning;
+	
+	[self resizeBuffer];
+}
+
+// Highest priority first, then most matches per byte seen. The sort is stable
+// so descriptors that are otherwise equal keep the order they were added in.
+- (void)sortStates
+{
+	unsigned long long byteCount = self.byteCount;
+	NSArray *sorted = [self.plan.states sortedArrayWithOptions:NSSortStable usingComparator:^NSComparisonResult(ORSSerialPacketMatchState *state1, ORSSerialPacketMatchState *state2) {
+		NSInteger priority1 = state1.descriptor.priority, priority2 = state2.descriptor.priority;
+		if (priority1 != priority2) return priority1 > priority2 ? NSOrderedAscending : NSOrderedDescending;
+		
+		unsigned long long bytesSeen1 = byteCount - state1.firstByteIndex, bytesSeen2 = byteCount - state2.firstByteIndex;
+		double hitRate1 = bytesSeen1 ? (double)state1.packetCount / bytesSeen1 : 0;
+		double hitRate2 = bytesSeen2 ? (double)state2.packetCount / bytesSeen2 : 0;
+		if (hitRate1 == hitRate2) return NSOrderedSame;
+		return hitRate1 > hitRate2 ? NSOrderedAscending : NSOrderedDescending;
+	}];
+	if (![sorted isEqualToArray:self.plan.states]) {
+		self.plan = [[ORSSerialPacketMatchPlan alloc] initWithInstalledStates:self.plan.installedStates evaluationOrder:sorted];
+	}
+	self.matchesSinceSort = 0;
+}
+
+// Called when a descriptor's last byte arrives, but its tuned search length doesn't hold a
+// packet. The packet may be longer than those seen so far, so search back as far as the room
+// kept for it. If that room is full and still doesn't hold a packet, grow it for next time.
+- (NSData *)packetMatchingLongerWindowForState:(ORSSerialPacketMatchState *)state
+								   windowStart:(unsigned long long)windowStart
+								previousLength:(NSUInteger)previousLength
+								   needsResize:(BOOL *)needsResize
+{
+	NSUInteger retryLength = state.retryLength;
+	NSUInteger windowLength = (NSUInteger)MIN(self.byteCount - windowStart, (unsigned long long)MIN(retryLength, self.buffer.length));
+	NSData *packet = nil;
+	if (windowLength > previousLength) {
+		packet = [state.descriptor packetMatchingAtEndOfBytes:[self.buffer lastBytes:windowLength] length:windowLength];
+	}
+	if ([packet length] || windowLength < retryLength) return packet;
+	
+	NSUInteger maximumLength = state.descriptor.maximumPacketLength;
+	state.retryLength = retryLength > maximumLength / ORSSerialPacketMatcherRetryLengthFactor ? maximumLength : retryLength * ORSSerialPacketMatcherRetryLengthFactor;
+	*needsResize |= state.retryLength != retryLength;
+	return nil;
+}
+
+// Returns YES if the state's search length changed
+- (BOOL)recordPacketOfLength:(NSUInteger)length forState:(ORSSerialPacketMatchState *)state
+{
+	state.minimumPacketLength = state.packetCount ? MIN(state.minimumPacketLength, length) : length;
+	state.maximumPacketLength = MAX(state.maximumPacketLength, length);
+	state.totalPacketLength += length;
+	state.packetCount++;
+	
+	if (!self.adoptedTuning) return NO;
+	return [self updateSearchLengthForState:state tuning:YES];
+}
+
+// Returns YES if the state's search length changed. Resets the room kept for longer packets.
+- (BOOL)updateSearchLengthForState:(ORSSerialPacketMatchState *)state tuning:(BOOL)tuning
+{
+	NSUInteger searchLength = state.descriptor.maximumPacketLength;
+	if (tuning && state.packetCount >= ORSSerialPacketMatcherTuningSampleCount) {
+		searchLength = [state statistics].recommendedMaximumPacketLength;
+	}
+	if (searchLength == state.searchLength) return NO;
+	
+	// Descriptors with a fixed last byte keep room for longer packets, searched when that byte arrives
+	state.searchLength = searchLength;
+	state.retryLength = searchLength;
+	if (state.hasLastPacketByte) {
+		NSUInteger maximumLength = state.descriptor.maximumPacketLength;
+		state.retryLength = searchLength > maximumLength / ORSSerialPacketMatcherRetryLengthFactor ? maximumLength : searchLength * ORSSerialPacketMatcherRetryLengthFactor;
+	}
+	return YES;
+}
+
+- (void)resizeBuffer
+{
+	NSUInteger length = self.plan.maximumPacketLength;
+	if (self.adoptedTuning) {
+		length = 0;
+		for (ORSSerialPacketMatchState *state in self.plan.states) {
+			length = MAX(length, state.retryLength);
+		}
+	}
+	if (length == self.buffer.maximumLength) return;
+	
+	// Keep any bytes that descriptors are still waiting on
+	ORSSerialBuffer *buffer = [[ORSSerialBuffer alloc] initWithMaximumLength:length];
+	NSUInteger keptLength = MIN(length, self.buffer.length);
+	if (keptLength) [buffer appendBytes:[self.buffer lastBytes:keptLength] length:keptLength];
+	self.buffer = buffer;
+}
+
+#pragma mark - Properties
+
+- (NSArray *)packetDescriptors
+{
+	return [self.installedPlan.installedStates valueForKey:@"descriptor"];
+}
+
+- (NSUInteger)bufferLength { return self.buffer.maximumLength; }
+
+- (NSUInteger)memoryFootprint
+{
+	NSUInteger footprint = malloc_size((__bridge const void *)self) + self.buffer.memoryFootprint;
+	NSSet *plans = [NSSet setWithObjects:self.installedPlan, self.adoptedInstalledPlan, self.plan, nil];
+	for (ORSSerialPacketMatchPlan *plan in plans) footprint += malloc_size((__bridge const void *)plan);
+	for (ORSSerialPacketMatchState *state in self.installedPlan.installedStates) {
+		footprint += malloc_size((__bridge const void *)state);
+	}
+	return footprint;
+}
+
+@end
@@ -0,0 +1,71 @@
+//
+//  ORSSerialPacketStatistics.m
+//  ORSSerialPort
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 Open Reel Software. All rights reserved.
+//
+//	Permission is hereby granted, free of charge, to any person obtaining a
+//	copy of this software and associated documentation files (the
+//	"Software"), to deal in the Software without restriction, including
+//	without limitation the rights to use, copy, modify, merge, publish,
+//	distribute, sublicense, and/or sell copies of the Software, and to
+//	permit persons to whom the Software is furnished to do so, subject to
+//	the following conditions:
+//
+//	The above copyright notice and this permission notice shall be included
+//	in all copies or substantial portions of the Software.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+//	OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//	CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//	TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//	SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#import "ORSSerial/ORSSerialPacketStatistics.h"
+#import "ORSSerial/ORSSerialPacketDescriptor.h"
+#import "ORSSerialPacketMatcher.h"
+
+// Recommended lengths leave room for packets 50% longer than the longest seen, and at least this many bytes more.
+static const NSUInteger ORSSerialPacketStatisticsMinimumHeadroom = 8;
+
+@implementation ORSSerialPacketStatistics
+
+- (instancetype)initWithPacketDescriptor:(ORSSerialPacketDescriptor *)descriptor
+							 packetCount:(NSUInteger)packetCount
+					 minimumPacketLength:(NSUInteger)minimumLength
+					 maximumPacketLength:(NSUInteger)maximumLength
+					   totalPacketLength:(unsigned long long)totalLength
+{
+	self = [super init];
+	if (self) {
+		_packetDescriptor = descriptor;
+		_packetCount = packetCount;
+		_minimumPacketLength = minimumLength;
+		_maximumPacketLength = maximumLength;
+		_averagePacketLength = packetCount ? (double)totalLength / (double)packetCount : 0;
+	}
+	return self;
+}
+
+- (NSString *)description
+{
+	return [NSString stringWithFormat:@"%@ packets: %lu min: %lu max: %lu average: %.1f recommended maximum: %lu", [super description],
+			(unsigned long)self.packetCount, (unsigned long)self.minimumPacketLength, (unsigned long)self.maximumPacketLength,
+			self.averagePacketLength, (unsigned long)self.recommendedMaximumPacketLength];
+}
+
+- (NSUInteger)recommendedMaximumPacketLength
+{
+	NSUInteger declaredLength = self.packetDescriptor.maximumPacketLength;
+	if (!self.packetCount) return declaredLength;
+	
+	NSUInteger observed = self.maximumPacketLength;
+	NSUInteger headroom = MAX(observed / 2, ORSSerialPacketStatisticsMinimumHeadroom);
+	NSUInteger recommended = observed > NSUIntegerMax - headroom ? NSUIntegerMax : observed + headroom;
+	return MIN(recommended, declaredLength);
+}
+
+@end
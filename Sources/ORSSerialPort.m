@@ -26,12 +26,25 @@
 
 #import "ORSSerial/ORSSerialPort.h"
 #import "ORSSerial/ORSSerialRequest.h"
+#import "ORSSerial/ORSSerialPortMetadata.h"
 #import "ORSSerialBuffer.h"
+#import "ORSSerialPacketMatcher.h"
+#import "ORSSerialErrorMarkParser.h"
+#import "ORSSerialPortCounters.h"
+#import "ORSSerialPortMonitor.h"
+#import "ORSSerialTransmitPacer.h"
+#import "ORSSerialEchoCanceller.h"
+#import "ORSSerialBaudRateProbe.h"
+#import "ORSSerialPortDiscovery.h"
+#import "ORSSerialFrameCodec.h"
+#import "ORSSerialPortTracing.h"
+#import "ORSSerialErrorLog.h"
 #import <IOKit/serial/IOSerialKeys.h>
 #import <IOKit/serial/ioss.h>
 #import <sys/param.h>
 #import <sys/filio.h>
 #import <sys/ioctl.h>
+#import <malloc/malloc.h>
 
 #if !__has_feature(objc_arc)
 #error ORSSerialPort.m must be compiled with ARC. Either turn on ARC for the project or set the -fobjc-arc flag for ORSSerialPort.m in the Build Phases for this target
@@ -40,63 +53,103 @@
 #if OS_OBJECT_USE_OBJC && __has_feature(objc_arc)
 #define ORS_GCD_RELEASE(x)
 #define ORS_GCD_RETAIN(x)
+#define ORS_GCD_MALLOC_SIZE(x) ORSSerialPortMallocSize((__bridge const void *)(x))
 #else
 #define ORS_GCD_RELEASE(x) if (x) { dispatch_release(x); }
 #define ORS_GCD_RETAIN(x) if (x) { dispatch_retain(x); }
+#define ORS_GCD_MALLOC_SIZE(x) ORSSerialPortMallocSize((const void *)(x))
 #endif
 
-#ifdef LOG_SERIAL_PORT_ERRORS
-#define LOG_SERIAL_PORT_ERROR(fmt, ...) NSLog(fmt, ## __VA_ARGS__)
-#else
-#define LOG_SERIAL_PORT_ERROR(fmt, ...)
-#endif
+// Objects that weren't allocated with malloc, like constant strings, count as 0
+static NSUInteger ORSSerialPortMallocSize(const void *pointer) { return pointer ? malloc_size(pointer) : 0; }
+
 
 static __strong NSMutableArray *allSerialPorts;
+static __strong NSMutableDictionary *registryEntryIDsByPath; // Callout and dialin paths of every device seen
 
 @interface ORSSerialPort ()
 {
 	struct termios originalPortAttributes;
+	ORSSerialPortCounters counters; // Only used on requestHandlingQueue
+	ORSSerialFrameDecoder *frameDecoder; // Only used on requestHandlingQueue. Created when first needed.
+	ORSSerialFrameReferences *sentFrameReferences; // Only used on requestHandlingQueue. Created when first needed.
 }
 
 @property (copy, readwrite) NSString *path;
 @property (readwrite) io_object_t IOKitDevice;
 @property int fileDescriptor;
 @property (copy, readwrite) NSString *name;
+@property (strong, readwrite) ORSSerialPortMetadata *metadata;
 
 @property (strong) ORSSerialBuffer *requestResponseReceiveBuffer;
 
-// Packet descriptors
-@property (nonatomic, strong) NSMapTable *packetDescriptorsAndBuffers;
+// Packet descriptors. Created when descriptors or matching options are first used, under @synchronized(self),
+// and read without the lock, so atomic.
+@property (atomic, strong) ORSSerialPacketMatcher *packetMatcher;
+
+// Error marking. Only used on requestHandlingQueue. Created when first needed.
+@property (nonatomic, strong) ORSSerialErrorMarkParser *errorMarkParser;
+
+// Local echo suppression. Created the first time suppressesLocalEcho is turned on.
+@property (atomic, strong) ORSSerialEchoCanceller *echoCanceller;
+
+// Baud rate detection. Receives all data while set.
+@property (atomic, strong) ORSSerialBaudRateProbe *baudRateProbe;
+
+// Receive backlog and transmit queue monitoring
+@property (nonatomic) BOOL receiveBacklogExceeded; // Only used on requestHandlingQueue
+@property (nonatomic) NSTimeInterval lastMonitorSampleTime; // Only used on the monitor's queue
 
-// Request handling
+// Adaptive modem line polling, when conserving idle wakeups
+@property (atomic) NSTimeInterval modemLinePollInterval;
+@property (nonatomic) NSTimeInterval lastModemLinePollTime; // Only used on the monitor's queue
+
+// Request handling. Collections are created when the first request is sent, and only used on requestHandlingQueue.
 @property (nonatomic, strong) NSMutableArray *requestsQueue;
 @property (nonatomic, strong, readwrite) ORSSerialRequest *pendingRequest;
+@property (nonatomic, strong) NSMutableDictionary *requestResponseHandlers; // Keyed by request UUIDString
 
 @property (nonatomic, readwrite) BOOL CTS;
 @property (nonatomic, readwrite) BOOL DSR;
 @property (nonatomic, readwrite) BOOL DCD;
 
+// Transmit pacing and RS-485 direction control. Created the first time either is used, like packetMatcher.
+@property (atomic, strong) ORSSerialTransmitPacer *transmitPacer;
+@property (atomic) BOOL RS485TransmitterEnabled; // RTS is asserted and received bytes are local echo
+
+// Completion handlers passed to -openWithBackgroundCompletionHandler: and -closeWithBackgroundCompletionHandler:,
+// called once the port has really been opened or closed. Guarded by @synchronized(self), and created when first needed.
+@property (nonatomic, strong) NSMutableArray *openCompletionHandlers;
+@property (nonatomic, strong) NSMutableArray *closeCompletionHandlers;
+@property (nonatomic) BOOL opening; // Guarded by @synchronized(self)
+@property (nonatomic) BOOL closing; // Guarded by @synchronized(self)
+
 #if OS_OBJECT_USE_OBJC
 @property (nonatomic, strong) dispatch_source_t readPollSource;
 @property (nonatomic, strong) dispatch_source_t pinPollTimer;
 @property (nonatomic, strong) dispatch_source_t pendingRequestTimeoutTimer;
 @property (nonatomic, strong) dispatch_queue_t requestHandlingQueue;
+@property (nonatomic, strong) dispatch_queue_t transmitCompletionQueue; // Waits in tcdrain() for sent data. Created when first used.
 #else
 @property (nonatomic) dispatch_source_t readPollSource;
 @property (nonatomic) dispatch_source_t pinPollTimer;
 @property (nonatomic) dispatch_source_t pendingRequestTimeoutTimer;
 @property (nonatomic) dispatch_queue_t requestHandlingQueue;
+@property (nonatomic) dispatch_queue_t transmitCompletionQueue;
 #endif
 
 @end
 
 @implementation ORSSerialPort
 
+@synthesize transmitCompletionQueue = _transmitCompletionQueue;
+
 + (void)initialize
 {
 	static dispatch_once_t once;
 	dispatch_once(&once, ^{
 		allSerialPorts = [[NSMutableArray alloc] init];
+		registryEntryIDsByPath = [[NSMutableDictionary alloc] init];
 	});
 }
 
@@ -176,21 +229,26 @@ static __strong NSMutableArray *allSerialPorts;
 	{
 		self.ioKitDevice = device;
 		self.path = bsdPath;
-		self.name = [[self class] modemNameFromDevice:device];
-		self.requestHandlingQueue = dispatch_queue_create("com.openreelsoftware.ORSSerialPort.requestHandlingQueue", 0);
-		self.packetDescriptorsAndBuffers = [NSMapTable strongToStrongObjectsMapTable];
-		self.requestsQueue = [NSMutableArray array];
-		self.baudRate = @B19200;
-		self.allowsNonStandardBaudRates = NO;
-		self.numberOfStopBits = 1;
-        self.numberOfDataBits = 8;
-		self.parity = ORSSerialPortParityNone;
-		self.shouldEchoReceivedData = NO;
-		self.usesRTSCTSFlowControl = NO;
-		self.usesDTRDSRFlowControl = NO;
-		self.usesDCDOutputFlowControl = NO;
-		self.RTS = NO;
-		self.DTR = NO;
+		self.metadata = [[ORSSerialPortMetadata alloc] initWithDevice:device];
+		self.name = self.metadata.name ?: [[self class] modemNameFromDevice:device];
+		[[self class] cacheRegistryEntryIDOfDevice:device calloutPath:bsdPath dialinPath:[[self class] bsdDialinPathFromDevice:device]];
+		[self setDefaultProperties];
+	}
+	
+	[[self class] addSerialPort:self];
+	
+	return self;
+}
+
+- (instancetype)initWithDevicelessPath:(NSString *)devicePath
+{
+	self = [super init];
+	
+	if (self != nil)
+	{
+		self.path = devicePath;
+		self.name = [devicePath lastPathComponent];
+		[self setDefaultProperties];
 	}
 	
 	[[self class] addSerialPort:self];
@@ -198,6 +256,24 @@ static __strong NSMutableArray *allSerialPorts;
 	return self;
 }
 
+- (void)setDefaultProperties
+{
+	self.requestHandlingQueue = dispatch_queue_create("com.openreelsoftware.ORSSerialPort.requestHandlingQueue", 0);
+	self.baudRate = @B19200;
+	self.allowsNonStandardBaudRates = NO;
+	self.numberOfStopBits = 1;
+	self.numberOfDataBits = 8;
+	self.parity = ORSSerialPortParityNone;
+	self.shouldEchoReceivedData = NO;
+	self.usesRTSCTSFlowControl = NO;
+	self.usesDTRDSRFlowControl = NO;
+	self.usesDCDOutputFlowControl = NO;
+	self.usesXONXOFFFlowControl = NO;
+	self.receiveBacklogWarningThreshold = 1024;
+	self.RTS = NO;
+	self.DTR = NO;
+}
+
 - (instancetype)init
 {
 	NSAssert(0, @"ORSSerialPort must be init'd using -initWithPath:");
@@ -220,12 +296,17 @@ static __strong NSMutableArray *allSerialPorts;
 		ORS_GCD_RELEASE(_pinPollTimer);
 	}
 	
+	if (frameDecoder) free(frameDecoder->references);
+	free(frameDecoder);
+	free(sentFrameReferences);
+	
 	if (_pendingRequestTimeoutTimer) {
 		dispatch_source_cancel(_pendingRequestTimeoutTimer);
 		ORS_GCD_RELEASE(_pendingRequestTimeoutTimer);
 	}
 	
 	self.requestHandlingQueue = nil;
+	self.transmitCompletionQueue = nil;
 }
 
 - (NSString *)description
@@ -252,17 +333,94 @@ static __strong NSMutableArray *allSerialPorts;
 
 - (void)open;
 {
-	if (self.isOpen) return;
+	@synchronized(self) {
+		if (self.isOpen || self.opening) return;
+		self.opening = YES;
+	}
+	[self finishOpening];
+}
+
+- (void)openWithCompletionHandler:(void(^)(NSError *error))handler
+{
+	[self openWithBackgroundCompletionHandler:^(NSError *error) {
+		if (handler) dispatch_async(dispatch_get_main_queue(), ^{ handler(error); });
+	}];
+}
+
+- (void)openWithBackgroundCompletionHandler:(void(^)(NSError *error))handler
+{
+	// If the port is already being opened, handler waits for that to finish instead of being told it's open
+	BOOL alreadyOpen = NO;
+	BOOL startOpening = NO;
+	@synchronized(self) {
+		if (!self.opening && self.isOpen) {
+			alreadyOpen = YES;
+		} else {
+			if (handler) {
+				if (!self.openCompletionHandlers) self.openCompletionHandlers = [NSMutableArray array];
+				[self.openCompletionHandlers addObject:[handler copy]];
+			}
+			startOpening = !self.opening;
+			self.opening = YES;
+		}
+	}
+	if (alreadyOpen) {
+		if (handler) handler(nil);
+		return;
+	}
+	if (!startOpening) return;
+	dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{ [self finishOpening]; });
+}
+
+// Opens the port, then calls the completion handlers queued while it was being opened. Must only be
+// called after setting opening. Only the flag is guarded, so the system calls don't block other users of the lock.
+- (void)finishOpening
+{
+	NSError *error = [self reallyOpenPort] ? nil : [self posixError];
+	if (error) [self notifyDelegateOfError:error waitingUntilDone:NO];
 	
+	NSArray *completionHandlers = nil;
+	@synchronized(self) {
+		self.opening = NO;
+		completionHandlers = [self.openCompletionHandlers copy];
+		[self.openCompletionHandlers removeAllObjects];
+	}
+	for (void(^handler)(NSError *) in completionHandlers) handler(error);
+}
+
++ (BOOL)automaticallyNotifiesObserversOfFileDescriptor { return NO; }
+
+// Sets fileDescriptor, and so isOpen, right away, so the port can be used from the calling thread. KVO
+// observers (e.g. bindings) are notified on the main queue, without waiting for it. Observers notified
+// later see the new value as both the old and new value.
+- (void)publishFileDescriptor:(int)descriptor
+{
+	BOOL isMainThread = [NSThread isMainThread];
+	if (isMainThread) [self willChangeValueForKey:@"fileDescriptor"];
+	@synchronized(self) {
+		self.fileDescriptor = descriptor;
+	}
+	if (isMainThread) {
+		[self didChangeValueForKey:@"fileDescriptor"];
+		return;
+	}
+	dispatch_async(dispatch_get_main_queue(), ^{
+		[self willChangeValueForKey:@"fileDescriptor"];
+		[self didChangeValueForKey:@"fileDescriptor"];
+	});
+}
+
+// Returns NO, leaving errno set, if the port couldn't be opened
+- (BOOL)reallyOpenPort
+{
 	dispatch_queue_t mainQueue = dispatch_get_main_queue();
 
 	int descriptor=0;
 	descriptor = open([self.path cStringUsingEncoding:NSASCIIStringEncoding], O_RDWR | O_NOCTTY | O_EXLOCK | O_NONBLOCK);
 	if (descriptor < 1)
 	{
-		// Error
-		[self notifyDelegateOfPosixError];
-		return;
+		ORS_LOG_SERIAL_PORT_ERROR(ORSSerialErrorLogOperationOpen, self.path, errno);
+		return NO;
 	}
 	
 	// Now that the device is open, clear the O_NONBLOCK flag so subsequent I/O will block.
@@ -270,10 +428,14 @@ static __strong NSMutableArray *allSerialPorts;
 	
 	if (fcntl(descriptor, F_SETFL, 0) == -1)
 	{
-		LOG_SERIAL_PORT_ERROR(@"Error clearing O_NONBLOCK %@ - %s(%d).\n", self.path, strerror(errno), errno);
+		ORS_LOG_SERIAL_PORT_ERROR(ORSSerialErrorLogOperationConfigure, self.path, errno);
 	}
 	
-	self.fileDescriptor = descriptor;
+	[self publishFileDescriptor:descriptor];
+	dispatch_async(self.requestHandlingQueue, ^{
+		[self.errorMarkParser reset];
+		[self resetFraming];
+	});
 	
 
 	// Port opened successfully, set options
@@ -298,8 +460,10 @@ static __strong NSMutableArray *allSerialPorts;
 		// Data is available
 		char buf[1024];
 		long lengthRead = read(localPortFD, buf, sizeof(buf));
+		ORS_TRACE_EVENT(self, self, "Read", "%ld bytes", lengthRead);
 		if (lengthRead>0)
 		{
+			[self speedUpModemLinePolling];
 			NSData *readData = [NSData dataWithBytes:buf length:lengthRead];
 			if (readData != nil) [self receiveData:readData];
 		}
@@ -308,7 +472,17 @@ static __strong NSMutableArray *allSerialPorts;
 	dispatch_resume(readPollSource);
 	self.readPollSource = readPollSource;
 	
-	// Start another poller to check status of CTS and DSR
+	// Poll CTS, DSR and DCD, from the shared monitor if conserving idle wakeups, or a dedicated timer otherwise
+	self.modemLinePollInterval = ORSSerialPortMinimumModemLinePollInterval;
+	if (!self.conservesIdleWakeups) [self startPinPollTimer];
+	
+	[self updateMonitoring];
+	
+	return YES;
+}
+
+- (void)startPinPollTimer
+{
 	dispatch_queue_t pollQueue = dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0);
 	dispatch_source_t timer = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, pollQueue);
 	dispatch_source_set_timer(timer, dispatch_time(DISPATCH_TIME_NOW, 0), 10*NSEC_PER_MSEC, 5*NSEC_PER_MSEC);
@@ -317,45 +491,103 @@ static __strong NSMutableArray *allSerialPorts;
 			dispatch_async(pollQueue, ^{ dispatch_source_cancel(timer); });
 			return;
 		}
-		
-		int32_t modemLines=0;
-		int result = ioctl(self.fileDescriptor, TIOCMGET, &modemLines);
-		if (result < 0)
-		{
-			[self notifyDelegateOfPosixErrorWaitingUntilDone:(errno == ENXIO)];
-			if (errno == ENXIO)
-			{
-				[self cleanupAfterSystemRemoval];
-			}
-			return;
-		}
-		
-		BOOL CTSPin = (modemLines & TIOCM_CTS) != 0;
-		BOOL DSRPin = (modemLines & TIOCM_DSR) != 0;
-		BOOL DCDPin = (modemLines & TIOCM_CAR) != 0;
-		
-		if (CTSPin != self.CTS)
-			dispatch_sync(mainQueue, ^{self.CTS = CTSPin;});
-		if (DSRPin != self.DSR)
-			dispatch_sync(mainQueue, ^{self.DSR = DSRPin;});
-		if (DCDPin != self.DCD)
-			dispatch_sync(mainQueue, ^{self.DCD = DCDPin;});
+		[self pollModemLines];
 	});
 	self.pinPollTimer = timer;
 	dispatch_resume(self.pinPollTimer);
 	ORS_GCD_RELEASE(timer);
 }
 
+// Reads CTS, DSR and DCD, updating their properties on the main queue. Returns YES if any of them changed.
+- (BOOL)pollModemLines
+{
+	int32_t modemLines=0;
+	int result = ioctl(self.fileDescriptor, TIOCMGET, &modemLines);
+	if (result < 0)
+	{
+		ORS_LOG_SERIAL_PORT_ERROR(ORSSerialErrorLogOperationModemLines, self.path, errno);
+		[self notifyDelegateOfPosixErrorWaitingUntilDone:(errno == ENXIO)];
+		if (errno == ENXIO)
+		{
+			[self cleanupAfterSystemRemoval];
+		}
+		return NO;
+	}
+	
+	BOOL CTSPin = (modemLines & TIOCM_CTS) != 0;
+	BOOL DSRPin = (modemLines & TIOCM_DSR) != 0;
+	BOOL DCDPin = (modemLines & TIOCM_CAR) != 0;
+	
+	BOOL changed = NO;
+	if (CTSPin != self.CTS) {
+		changed = YES;
+		ORS_TRACE_COUNTER(self, "CTS", CTSPin);
+	}
+	if (DSRPin != self.DSR) {
+		changed = YES;
+		ORS_TRACE_COUNTER(self, "DSR", DSRPin);
+	}
+	if (DCDPin != self.DCD) {
+		changed = YES;
+		ORS_TRACE_COUNTER(self, "DCD", DCDPin);
+	}
+	if (!changed) return NO;
+	
+	// Don't wait for the main queue. Polling for every port shares the monitor's queue when conserving
+	// idle wakeups. A later poll may see the old values and queue the same change, so only set what differs.
+	dispatch_async(dispatch_get_main_queue(), ^{
+		if (self.CTS != CTSPin) self.CTS = CTSPin;
+		if (self.DSR != DSRPin) self.DSR = DSRPin;
+		if (self.DCD != DCDPin) self.DCD = DCDPin;
+	});
+	return YES;
+}
+
 - (BOOL)close;
 {
-	if (!self.isOpen) return YES;
-	self.readPollSource = nil; // Cancel read dispatch source. Cancel handler will call -reallyClosePort
+	@synchronized(self) {
+		if (!self.isOpen || !self.readPollSource) return YES;
+		self.closing = YES;
+		self.readPollSource = nil; // Cancel read dispatch source. Cancel handler will call -reallyClosePort
+	}
 	return YES;
 }
 
+- (void)closeWithCompletionHandler:(void(^)(NSError *error))handler
+{
+	[self closeWithBackgroundCompletionHandler:^(NSError *error) {
+		if (handler) dispatch_async(dispatch_get_main_queue(), ^{ handler(error); });
+	}];
+}
+
+- (void)closeWithBackgroundCompletionHandler:(void(^)(NSError *error))handler
+{
+	BOOL finished = NO;
+	NSError *error = nil;
+	@synchronized(self) {
+		if (!self.isOpen) {
+			finished = YES;
+		} else if (!self.closing && !self.readPollSource) {
+			// Still being opened, or an earlier close failed. Either way there's no close to wait for.
+			finished = YES;
+			error = [self posixErrorWithCode:self.opening ? EBUSY : EIO];
+		} else if (handler) {
+			if (!self.closeCompletionHandlers) self.closeCompletionHandlers = [NSMutableArray array];
+			[self.closeCompletionHandlers addObject:[handler copy]];
+		}
+	}
+	if (finished) {
+		if (handler) handler(error);
+		return;
+	}
+	[self close];
+}
+
 - (void)reallyClosePort
 {
 	self.pinPollTimer = nil; // Stop polling CTS/DSR/DCD pins
+	[[ORSSerialPortMonitor sharedMonitor] removePort:self];
+	[self.transmitPacer cancelQueuedData];
 	
 	// The next tcsetattr() call can fail if the port is waiting to send data. This is likely to happen
 	// e.g. if flow control is on and the CTS line is low. So, turn off flow control before proceeding
@@ -364,28 +596,38 @@ static __strong NSMutableArray *allSerialPorts;
 	options.c_cflag &= ~CRTSCTS; // RTS/CTS Flow Control
 	options.c_cflag &= ~(CDTR_IFLOW | CDSR_OFLOW); // DTR/DSR Flow Control
 	options.c_cflag &= ~CCAR_OFLOW; // DCD Flow Control
+	options.c_iflag &= ~(IXON | IXOFF); // XON/XOFF Flow Control
 	tcsetattr(self.fileDescriptor, TCSANOW, &options);
+	tcflow(self.fileDescriptor, TCOON); // Resume output in case the other end sent XOFF
 	
 	// Set port back the way it was before we used it
 	tcsetattr(self.fileDescriptor, TCSADRAIN, &originalPortAttributes);
 	
+	NSError *error = nil;
 	if (close(self.fileDescriptor))
 	{
-		LOG_SERIAL_PORT_ERROR(@"Error closing serial port with file descriptor %i:%i", self.fileDescriptor, errno);
-		[self notifyDelegateOfPosixError];
-		return;
+		ORS_LOG_SERIAL_PORT_ERROR(ORSSerialErrorLogOperationClose, self.path, errno);
+		error = [self posixError];
+		[self notifyDelegateOfError:error waitingUntilDone:NO];
 	}
-	
-	self.fileDescriptor = 0;
-	
-	if ([self.delegate respondsToSelector:@selector(serialPortWasClosed:)])
+	else
 	{
-		[(id)self.delegate performSelectorOnMainThread:@selector(serialPortWasClosed:) withObject:self waitUntilDone:YES];
-		dispatch_async(self.requestHandlingQueue, ^{
-			self.requestsQueue = [NSMutableArray array]; // Cancel all queued requests
-			self.pendingRequest = nil; // Discard pending request
-		});
+		[self publishFileDescriptor:0];
+		
+		if ([self.delegate respondsToSelector:@selector(serialPortWasClosed:)])
+		{
+			[(id)self.delegate performSelectorOnMainThread:@selector(serialPortWasClosed:) withObject:self waitUntilDone:YES];
+		}
+		dispatch_async(self.requestHandlingQueue, ^{ [self discardRequestsAfterClosing]; });
 	}
+	
+	NSArray *completionHandlers = nil;
+	@synchronized(self) {
+		self.closing = NO;
+		completionHandlers = [self.closeCompletionHandlers copy];
+		[self.closeCompletionHandlers removeAllObjects];
+	}
+	for (void(^handler)(NSError *) in completionHandlers) handler(error);
 }
 
 - (void)cleanup;
@@ -405,33 +647,310 @@ static __strong NSMutableArray *allSerialPorts;
 
 - (BOOL)sendData:(NSData *)data;
 {
+	return [self sendData:data completionHandler:nil];
+}
+
+- (BOOL)sendData:(NSData *)data transmitCompletionHandler:(void(^)(NSDate *transmitDate, NSError *error))handler
+{
+	void(^waitForTransmission)(BOOL) = nil;
+	if (handler) {
+		waitForTransmission = ^(BOOL success){
+			if (!success) {
+				// Queued data is discarded when the port closes
+				BOOL cancelled = NO;
+				@synchronized(self) { cancelled = self.closing || !self.isOpen; }
+				NSError *error = [self posixErrorWithCode:cancelled ? ECANCELED : EIO];
+				dispatch_async(dispatch_get_main_queue(), ^{ handler(nil, error); });
+				return;
+			}
+			// tcdrain() blocks until the data has actually been transmitted, so wait on a separate queue
+			int descriptor = self.fileDescriptor;
+			dispatch_async(self.transmitCompletionQueue, ^{
+				NSError *error = nil;
+				if (tcdrain(descriptor) != 0)
+				{
+					ORS_LOG_SERIAL_PORT_ERROR(ORSSerialErrorLogOperationDrain, self.path, errno);
+					error = [self posixError];
+				}
+				NSDate *transmitDate = [NSDate date];
+				dispatch_async(dispatch_get_main_queue(), ^{ handler(error ? nil : transmitDate, error); });
+			});
+		};
+	}
+	return [self sendData:data completionHandler:waitForTransmission];
+}
+
+// handler is called once data has been written, with NO if writing failed, even if this method returns NO.
+// If data is written immediately, handler is called before this method returns.
+- (BOOL)sendData:(NSData *)data completionHandler:(void(^)(BOOL success))handler
+{
+	if (!self.isOpen) {
+		if (handler) handler(NO);
+		return NO;
+	}
+	if ([data length] == 0) {
+		if (handler) handler(YES);
+		return YES;
+	}
+	
+	if (self.usesCompressedFraming) data = [[self class] framedDataWithData:data];
+	return [self sendEncodedData:data completionHandler:handler];
+}
+
+// Must only be called on requestHandlingQueue
+- (BOOL)sendDataOfRequest:(ORSSerialRequest *)request
+{
+	NSData *data = request.dataToSend;
+	NSUInteger messageType = request.messageType;
+	if (!self.usesCompressedFraming ||
+		messageType == 0 || messageType > ORS_SERIAL_FRAME_MESSAGE_TYPE_COUNT ||
+		[data length] > ORS_SERIAL_FRAME_MAXIMUM_MESSAGE_LENGTH) {
+		return [self sendData:data];
+	}
 	if (!self.isOpen) return NO;
-	if ([data length] == 0) return YES;
 	
-	NSMutableData *writeBuffer = [data mutableCopy];
-	while ([writeBuffer length] > 0)
+	if (!sentFrameReferences) sentFrameReferences = calloc(1, sizeof(ORSSerialFrameReferences));
+	NSMutableData *frame = [NSMutableData dataWithLength:ORS_SERIAL_FRAME_MAXIMUM_LENGTH([data length] + 3)];
+	[frame setLength:ORSSerialFrameEncodeMessage([data bytes], [data length], (uint8_t)messageType, sentFrameReferences, [frame mutableBytes])];
+	return [self sendEncodedData:frame completionHandler:nil];
+}
+
+// Sends data that's already been framed, if usesCompressedFraming is on
+- (BOOL)sendEncodedData:(NSData *)data completionHandler:(void(^)(BOOL success))handler
+{
+	// Once data has been queued for pacing, keep queueing so it isn't overtaken
+	ORSSerialTransmitPacer *pacer = self.transmitPacer;
+	double rate = [self transmitPacingRate];
+	BOOL usesRS485DirectionControl = self.usesRS485DirectionControl;
+	if (rate > 0 || self.transmitFrameGap > 0 || usesRS485DirectionControl || pacer.queuedByteCount > 0)
 	{
-		long numBytesWritten = write(self.fileDescriptor, [writeBuffer bytes], [writeBuffer length]);
+		if (!pacer) pacer = [self createTransmitPacer];
+		pacer.bytesPerSecond = rate;
+		pacer.interFrameGap = self.transmitFrameGap;
+		[self configureRS485DirectionControlOfTransmitPacer:pacer enabled:usesRS485DirectionControl];
+		[pacer enqueueData:data completionHandler:handler];
+		ORS_TRACE_COUNTER(self, "Transmit Queue", pacer.queuedByteCount);
+		return YES;
+	}
+	
+	BOOL success = [self writeBytes:[data bytes] length:[data length]];
+	if (handler) handler(success);
+	return success;
+}
+
++ (NSData *)framedDataWithData:(NSData *)data
+{
+	const uint8_t *bytes = [data bytes];
+	NSUInteger length = [data length];
+	NSUInteger frameCount = (length + ORS_SERIAL_FRAME_MAXIMUM_PAYLOAD_LENGTH - 1) / ORS_SERIAL_FRAME_MAXIMUM_PAYLOAD_LENGTH;
+	NSMutableData *result = [NSMutableData dataWithLength:ORS_SERIAL_FRAME_MAXIMUM_LENGTH(length) + frameCount * ORS_SERIAL_FRAME_MAXIMUM_LENGTH(0)];
+	uint8_t *frame = [result mutableBytes];
+	for (NSUInteger offset=0; offset<length; offset += ORS_SERIAL_FRAME_MAXIMUM_PAYLOAD_LENGTH) {
+		frame += ORSSerialFrameEncode(bytes + offset, MIN(length - offset, ORS_SERIAL_FRAME_MAXIMUM_PAYLOAD_LENGTH), frame);
+	}
+	[result setLength:frame - (uint8_t *)[result mutableBytes]];
+	return result;
+}
+
+- (BOOL)writeBytes:(const void *)bytes length:(NSUInteger)length
+{
+	// Expect echo before writing, so it can't be received first
+	BOOL suppressesLocalEcho = self.suppressesLocalEcho;
+	if (suppressesLocalEcho) {
+		[self.echoCanceller expectEchoOfBytes:bytes length:length transmissionTime:length / [self lineBytesPerSecond]];
+	}
+	
+	NSUInteger remaining = length;
+	while (remaining > 0)
+	{
+		ORS_TRACE_INTERVAL_BEGIN(self, self, "Write", "%lu bytes", (unsigned long)remaining);
+		long numBytesWritten = write(self.fileDescriptor, bytes, remaining);
+		ORS_TRACE_INTERVAL_END(self, self, "Write", "%ld bytes written", numBytesWritten);
 		if (numBytesWritten < 0)
 		{
-			LOG_SERIAL_PORT_ERROR(@"Error writing to serial port:%d", errno);
+			ORS_LOG_SERIAL_PORT_ERROR(ORSSerialErrorLogOperationWrite, self.path, errno);
 			[self notifyDelegateOfPosixError];
+			if (suppressesLocalEcho) [self.echoCanceller reset]; // Don't know how much was written
 			return NO;
 		}
-		else if (numBytesWritten > 0)
+		bytes = (const uint8_t *)bytes + numBytesWritten;
+		remaining -= numBytesWritten;
+	}
+	
+	[self speedUpModemLinePolling];
+	dispatch_async(self.requestHandlingQueue, ^{ self->counters.sentByteCount += length; });
+	ORSSerialTransmitPacer *pacer = self.transmitPacer;
+	if (pacer) ORS_TRACE_COUNTER(self, "Transmit Queue", pacer.queuedByteCount);
+	
+	return YES;
+}
+
+- (ORSSerialTransmitPacer *)createTransmitPacer
+{
+	@synchronized(self) {
+		if (!self.transmitPacer) {
+			__weak typeof(self) weakSelf = self;
+			self.transmitPacer = [[ORSSerialTransmitPacer alloc] initWithWriter:^BOOL(const uint8_t *bytes, NSUInteger length) {
+				ORSSerialPort *strongSelf = weakSelf;
+				if (!strongSelf.isOpen) return NO;
+				return [strongSelf writeBytes:bytes length:length];
+			}];
+		}
+		return self.transmitPacer;
+	}
+}
+
+- (void)configureRS485DirectionControlOfTransmitPacer:(ORSSerialTransmitPacer *)pacer enabled:(BOOL)enabled
+{
+	pacer.turnaroundLeadTime = self.RS485DelayBeforeSend;
+	pacer.turnaroundTrailTime = self.RS485DelayAfterSend;
+	if (!enabled) {
+		pacer.turnaroundHandler = nil;
+		pacer.drainHandler = nil;
+		return;
+	}
+	if (pacer.turnaroundHandler) return;
+	
+	__weak typeof(self) weakSelf = self;
+	pacer.turnaroundHandler = ^(BOOL transmitterEnabled) {
+		[weakSelf enableRS485Transmitter:transmitterEnabled];
+	};
+	pacer.drainHandler = ^{
+		ORSSerialPort *strongSelf = weakSelf;
+		if (strongSelf.isOpen) tcdrain(strongSelf.fileDescriptor);
+	};
+}
+
+// Asserts RTS to drive the bus, or deasserts it to receive, using a single ioctl()
+- (void)enableRS485Transmitter:(BOOL)enabled
+{
+	if (enabled) self.RS485TransmitterEnabled = YES;
+	
+	if (self.isOpen)
+	{
+		int bits = TIOCM_RTS;
+		if (ioctl(self.fileDescriptor, enabled ? TIOCMBIS : TIOCMBIC, &bits) < 0 &&
+			errno != ENOTTY && errno != EINVAL && errno != ENODEV) // Devices without an RTS line, e.g. pseudo terminals
 		{
-			[writeBuffer replaceBytesInRange:NSMakeRange(0, numBytesWritten) withBytes:NULL length:0];
+			ORS_LOG_SERIAL_PORT_ERROR(ORSSerialErrorLogOperationModemLines, self.path, errno);
+			[self notifyDelegateOfPosixError];
+		}
+		
+		// Anything received while the bus was driven, and not read yet, is local echo
+		if (!enabled && !self.suppressesLocalEcho) tcflush(self.fileDescriptor, TCIFLUSH);
+	}
+	
+	if (!enabled) self.RS485TransmitterEnabled = NO;
+}
+
+// Bytes per second to limit transmission to, or 0 for no limit
+- (double)transmitPacingRate
+{
+	double rate = self.maximumTransmitRate;
+	double fraction = self.maximumTransmitRateFractionOfBaudRate;
+	if (fraction > 0) {
+		double baudRateLimit = [self lineBytesPerSecond] * fraction;
+		rate = rate > 0 ? MIN(rate, baudRateLimit) : baudRateLimit;
+	}
+	return rate;
+}
+
+// The number of bytes per second the line can carry with the current settings
+- (double)lineBytesPerSecond
+{
+	// Start bit, data bits, parity bit and stop bits
+	NSUInteger bitsPerCharacter = 1 + self.numberOfDataBits + (self.parity != ORSSerialPortParityNone ? 1 : 0) + self.numberOfStopBits;
+	return MAX([self.baudRate doubleValue], 1.0) / bitsPerCharacter;
+}
+
+- (void)detectBaudRateFromCandidates:(NSArray *)baudRates
+						probeRequest:(ORSSerialRequest *)request
+				   completionHandler:(void(^)(NSNumber *baudRate, NSError *error))handler
+{
+	NSError *error = nil;
+	ORSSerialBaudRateProbe *probe = [[ORSSerialBaudRateProbe alloc] initWithBaudRates:baudRates request:request];
+	@synchronized(self) {
+		if (!self.isOpen) {
+			error = [NSError errorWithDomain:NSPOSIXErrorDomain code:EBADF userInfo:@{NSLocalizedDescriptionKey: @(strerror(EBADF)), NSFilePathErrorKey: self.path}];
+		} else if (self.baudRateProbe) {
+			error = [NSError errorWithDomain:NSPOSIXErrorDomain code:EBUSY userInfo:@{NSLocalizedDescriptionKey: @(strerror(EBUSY)), NSFilePathErrorKey: self.path}];
+		} else {
+			self.baudRateProbe = probe;
 		}
 	}
+	if (error) {
+		if (handler) dispatch_async(dispatch_get_main_queue(), ^{ handler(nil, error); });
+		return;
+	}
 	
+	__weak typeof(self) weakSelf = self;
+	probe.configureHandler = ^BOOL(NSNumber *baudRate) {
+		return [weakSelf configureProbeBaudRate:baudRate];
+	};
+	probe.sendHandler = ^BOOL(NSData *data) {
+		ORSSerialPort *strongSelf = weakSelf;
+		if (!strongSelf.isOpen) return NO;
+		// Not framed, but paced and sent with RS-485 direction control like any other data
+		return [strongSelf sendEncodedData:data completionHandler:nil];
+	};
+	probe.completionHandler = ^(NSNumber *baudRate, NSError *error) {
+		dispatch_async(dispatch_get_main_queue(), ^{
+			ORSSerialPort *strongSelf = weakSelf;
+			strongSelf.baudRateProbe = nil;
+			if (baudRate) strongSelf.baudRate = baudRate;
+			[strongSelf setPortOptions]; // Restore everything the probe changed
+			if (handler) handler(baudRate, error);
+		});
+	};
+	[probe start];
+}
+
+// Changes only the baud rate, with error marking on so the probe can count framing errors.
+// Much cheaper than -setPortOptions, which reconfigures everything.
+- (BOOL)configureProbeBaudRate:(NSNumber *)baudRate
+{
+	if (!self.isOpen) {
+		errno = EBADF;
+		return NO;
+	}
+	
+	struct termios options;
+	if (tcgetattr(self.fileDescriptor, &options) != 0) return NO;
+	options.c_iflag |= (INPCK | PARMRK);
+	options.c_iflag &= ~(IGNPAR | IGNBRK | BRKINT | ISTRIP);
+	cfsetspeed(&options, [baudRate unsignedLongValue]);
+	if (tcsetattr(self.fileDescriptor, TCSANOW, &options) != 0) {
+		if (!self.allowsNonStandardBaudRates) return NO;
+		speed_t speed = [baudRate unsignedLongValue];
+		if (ioctl(self.fileDescriptor, IOSSIOSPEED, &speed, 1) != 0) return NO;
+	}
+	
+	// Discard anything sent or received at the previous rate
+	tcflush(self.fileDescriptor, TCIOFLUSH);
 	return YES;
 }
 
 - (BOOL)sendRequest:(ORSSerialRequest *)request
 {
+	ORS_TRACE_INTERVAL_BEGIN(self, request, "Request", "%lu bytes", (unsigned long)[request.dataToSend length]);
+	__block BOOL success = NO;
+	dispatch_sync(self.requestHandlingQueue, ^{
+		success = [self reallySendRequest:request];
+	});
+	return success;
+}
+
+- (BOOL)sendRequest:(ORSSerialRequest *)request responseHandler:(void(^)(NSData *response))handler
+{
+	ORS_TRACE_INTERVAL_BEGIN(self, request, "Request", "%lu bytes", (unsigned long)[request.dataToSend length]);
 	__block BOOL success = NO;
 	dispatch_sync(self.requestHandlingQueue, ^{
+		if (handler) {
+			if (!self.requestResponseHandlers) self.requestResponseHandlers = [NSMutableDictionary dictionary];
+			self.requestResponseHandlers[request.UUIDString] = [handler copy];
+		}
 		success = [self reallySendRequest:request];
+		if (!success) [self.requestResponseHandlers removeObjectForKey:request.UUIDString];
 	});
 	return success;
 }
@@ -443,6 +962,7 @@ static __strong NSMutableArray *allSerialPorts;
 		if (request == self.pendingRequest) return;
 		NSInteger requestIndex = [self.requestsQueue indexOfObject:request];
 		if (requestIndex == NSNotFound) return;
+		ORS_TRACE_INTERVAL_END(self, request, "Request", "cancelled");
 		[self removeObjectFromRequestsQueueAtIndex:requestIndex];
 	});
 }
@@ -450,27 +970,122 @@ static __strong NSMutableArray *allSerialPorts;
 - (void)cancelAllQueuedRequests
 {
 	dispatch_async(self.requestHandlingQueue, ^{
-		self.requestsQueue = [NSMutableArray array];
+		[self traceCancellationOfQueuedRequests];
+		self.requestsQueue = nil;
 	});
 }
 
+// Must only be called on requestHandlingQueue
+- (void)discardRequestsAfterClosing
+{
+	[self traceCancellationOfQueuedRequests];
+	self.requestsQueue = nil; // Cancel all queued requests
+	self.pendingRequestTimeoutTimer = nil;
+	if (self.pendingRequest) ORS_TRACE_INTERVAL_END(self, self.pendingRequest, "Request", "cancelled");
+	self.pendingRequest = nil; // Discard pending request
+	
+	// Requests with a response handler get nil, just as they do when they time out
+	NSArray *responseHandlers = [self.requestResponseHandlers allValues];
+	[self.requestResponseHandlers removeAllObjects];
+	if (![responseHandlers count]) return;
+	dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+		for (void(^responseHandler)(NSData *) in responseHandlers) responseHandler(nil);
+	});
+}
+
+// Must only be called on requestHandlingQueue
+- (void)traceCancellationOfQueuedRequests
+{
+	for (ORSSerialRequest *request in self.requestsQueue) {
+		ORS_TRACE_INTERVAL_END(self, request, "Request", "cancelled");
+	}
+	ORS_TRACE_COUNTER(self, "Request Queue", 0);
+}
+
 - (void)startListeningForPacketsMatchingDescriptor:(ORSSerialPacketDescriptor *)descriptor;
 {
-	if ([self.packetDescriptorsAndBuffers objectForKey:descriptor]) return; // Already listening
+	if (!descriptor) return;
+	[self startListeningForPacketsMatchingDescriptors:@[descriptor]];
+}
+
+- (void)stopListeningForPacketsMatchingDescriptor:(ORSSerialPacketDescriptor *)descriptor;
+{
+	if (!descriptor) return;
+	[self stopListeningForPacketsMatchingDescriptors:@[descriptor]];
+}
+
+- (void)startListeningForPacketsMatchingDescriptors:(NSArray *)descriptors
+{
+	NSIndexSet *newIndexes = [descriptors indexesOfObjectsPassingTest:^BOOL(ORSSerialPacketDescriptor *descriptor, NSUInteger idx, BOOL *stop) {
+		return ![self.packetMatcher containsPacketDescriptor:descriptor];
+	}];
+	if (![newIndexes count]) return; // Already listening
+	
+	// The matcher publishes a new set of descriptors atomically, so there's no need to wait for
+	// data already being processed on requestHandlingQueue.
+	[self willChangeValueForKey:@"packetDescriptors"];
+	[[self createPacketMatcherIfNeeded] addPacketDescriptors:[descriptors objectsAtIndexes:newIndexes]];
+	[self didChangeValueForKey:@"packetDescriptors"];
+}
+
+- (void)stopListeningForPacketsMatchingDescriptors:(NSArray *)descriptors
+{
+	if (![descriptors count]) return;
 	
-	[self willChangeValueForKey:@"packetDescriptorsAndBuffers"];
+	[self willChangeValueForKey:@"packetDescriptors"];
+	[self.packetMatcher removePacketDescriptors:descriptors];
+	[self didChangeValueForKey:@"packetDescriptors"];
+}
+
+- (ORSSerialPortStatistics *)statistics
+{
+	__block ORSSerialPortStatistics *statistics = nil;
+	dispatch_sync(self.requestHandlingQueue, ^{ statistics = [[ORSSerialPortStatistics alloc] initWithCounters:self->counters]; });
+	return statistics;
+}
+
+- (NSUInteger)memoryFootprint
+{
+	__block NSUInteger footprint = 0;
 	dispatch_sync(self.requestHandlingQueue, ^{
-		ORSSerialBuffer *buffer = [[ORSSerialBuffer alloc] initWithMaximumLength:descriptor.maximumPacketLength];
-		[self.packetDescriptorsAndBuffers setObject:buffer forKey:descriptor];
+		footprint += ORSSerialPortMallocSize((__bridge const void *)self);
+		footprint += ORSSerialPortMallocSize((__bridge const void *)self.metadata);
+		footprint += ORS_GCD_MALLOC_SIZE(self.requestHandlingQueue);
+		
+		// Subsystems that are only created when first used
+		footprint += self.packetMatcher.memoryFootprint;
+		footprint += self.requestResponseReceiveBuffer.memoryFootprint;
+		footprint += self.echoCanceller.memoryFootprint;
+		footprint += ORSSerialPortMallocSize((__bridge const void *)self.errorMarkParser);
+		footprint += ORSSerialPortMallocSize((__bridge const void *)self.transmitPacer);
+		footprint += ORSSerialPortMallocSize((__bridge const void *)self.baudRateProbe);
+		footprint += ORSSerialPortMallocSize(self->frameDecoder);
+		if (self->frameDecoder) footprint += ORSSerialPortMallocSize(self->frameDecoder->references);
+		footprint += ORSSerialPortMallocSize(self->sentFrameReferences);
+		
+		// Requests, counting a pointer per collection entry for collections' storage
+		footprint += ORSSerialPortMallocSize((__bridge const void *)self.requestsQueue);
+		for (ORSSerialRequest *request in self.requestsQueue) {
+			footprint += sizeof(id) + ORSSerialPortMallocSize((__bridge const void *)request) + [request.dataToSend length];
+		}
+		footprint += ORSSerialPortMallocSize((__bridge const void *)self.pendingRequest);
+		footprint += ORSSerialPortMallocSize((__bridge const void *)self.requestResponseHandlers);
+		footprint += [self.requestResponseHandlers count] * 2 * sizeof(id);
+		
+		// Dispatch objects, without creating any
+		footprint += ORS_GCD_MALLOC_SIZE(self->_transmitCompletionQueue);
+		footprint += ORS_GCD_MALLOC_SIZE(self.readPollSource);
+		footprint += ORS_GCD_MALLOC_SIZE(self.pinPollTimer);
+		footprint += ORS_GCD_MALLOC_SIZE(self.pendingRequestTimeoutTimer);
 	});
-	[self didChangeValueForKey:@"packetDescriptorsAndBuffers"];
+	return footprint;
 }
 
-- (void)stopListeningForPacketsMatchingDescriptor:(ORSSerialPacketDescriptor *)descriptor;
+- (ORSSerialPacketStatistics *)statisticsForPacketDescriptor:(ORSSerialPacketDescriptor *)descriptor
 {
-	[self willChangeValueForKey:@"packetDescriptorsAndBuffers"];
-	dispatch_sync(self.requestHandlingQueue, ^{ [self.packetDescriptorsAndBuffers removeObjectForKey:descriptor]; });
-	[self didChangeValueForKey:@"packetDescriptorsAndBuffers"];
+	__block ORSSerialPacketStatistics *statistics = nil;
+	dispatch_sync(self.requestHandlingQueue, ^{ statistics = [self.packetMatcher statisticsForPacketDescriptor:descriptor]; });
+	return statistics;
 }
 
 #pragma mark - Private Methods
@@ -493,7 +1108,8 @@ static __strong NSMutableArray *allSerialPorts;
 			self.pendingRequestTimeoutTimer = timer;
 			dispatch_resume(self.pendingRequestTimeoutTimer);
 		}
-		BOOL success = [self sendData:request.dataToSend];
+		ORS_TRACE_EVENT(self, self, "Request Sent", "%lu bytes", (unsigned long)[request.dataToSend length]);
+		BOOL success = [self sendDataOfRequest:request];
 		// Immediately send next request if this one doesn't require a response
 		if (success) [self checkResponseToPendingRequestAndContinueIfValidWithReceivedByte:nil];
 		return success;
@@ -520,6 +1136,14 @@ static __strong NSMutableArray *allSerialPorts;
 	self.pendingRequestTimeoutTimer = nil;
 	
 	ORSSerialRequest *request = self.pendingRequest;
+	ORS_TRACE_INTERVAL_END(self, request, "Request", "timed out");
+	
+	void(^responseHandler)(NSData *) = [self takeResponseHandlerForRequest:request];
+	if (responseHandler) {
+		dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{ responseHandler(nil); });
+		[self sendNextRequest];
+		return;
+	}
 	
 	if (![self.delegate respondsToSelector:@selector(serialPort:requestDidTimeout:)])
 	{
@@ -527,8 +1151,10 @@ static __strong NSMutableArray *allSerialPorts;
 		return;
 	}
 	
+	ORS_TRACE_INTERVAL_BEGIN(self, request, "Delegate Dispatch", "requestDidTimeout");
 	dispatch_async(dispatch_get_main_queue(), ^{
 		[self.delegate serialPort:self requestDidTimeout:request];
+		ORS_TRACE_INTERVAL_END(self, request, "Delegate Dispatch", "returned");
 		dispatch_async(self.requestHandlingQueue, ^{
 			[self sendNextRequest];
 		});
@@ -543,69 +1169,317 @@ static __strong NSMutableArray *allSerialPorts;
 	ORSSerialPacketDescriptor *packetDescriptor = self.pendingRequest.responseDescriptor;
 	
 	if (!byte) {
-		if (!packetDescriptor) [self sendNextRequest];
+		if (!packetDescriptor) {
+			ORS_TRACE_INTERVAL_END(self, self.pendingRequest, "Request", "sent, no response expected");
+			void(^responseHandler)(NSData *) = [self takeResponseHandlerForRequest:self.pendingRequest];
+			if (responseHandler) dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{ responseHandler([NSData data]); });
+			[self sendNextRequest];
+		}
 		return;
 	}
 	
 	[self.requestResponseReceiveBuffer appendData:byte];
-	NSData *responseData = [packetDescriptor packetMatchingAtEndOfBuffer:self.requestResponseReceiveBuffer.data];
+	NSData *responseData = [packetDescriptor packetMatchingAtEndOfSerialBuffer:self.requestResponseReceiveBuffer];
 	if (!responseData) return;
 	
 	self.pendingRequestTimeoutTimer = nil;
 	ORSSerialRequest *request = self.pendingRequest;
+	ORS_TRACE_INTERVAL_END(self, request, "Request", "response of %lu bytes", (unsigned long)[responseData length]);
+	
+	void(^responseHandler)(NSData *) = [self takeResponseHandlerForRequest:request];
+	if (responseHandler) {
+		dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{ responseHandler(responseData); });
+		[self sendNextRequest];
+		return;
+	}
 	
+	ORS_TRACE_INTERVAL_BEGIN(self, responseData, "Delegate Dispatch", "didReceiveResponse");
 	dispatch_async(dispatch_get_main_queue(), ^{
 		if ([responseData length] &&
 			[self.delegate respondsToSelector:@selector(serialPort:didReceiveResponse:toRequest:)])
 		{
 			[self.delegate serialPort:self didReceiveResponse:responseData toRequest:request];
 		}
+		ORS_TRACE_INTERVAL_END(self, responseData, "Delegate Dispatch", "returned");
 	});
 	
 	[self sendNextRequest];
 }
 
+// Must only be called on requestHandlingQueue
+- (void(^)(NSData *))takeResponseHandlerForRequest:(ORSSerialRequest *)request
+{
+	if (!request) return nil;
+	void(^handler)(NSData *) = self.requestResponseHandlers[request.UUIDString];
+	[self.requestResponseHandlers removeObjectForKey:request.UUIDString];
+	return handler;
+}
+
 #pragma mark Port Read/Write
 
 - (void)receiveData:(NSData *)data;
 {
-	dispatch_async(dispatch_get_main_queue(), ^{
-		if ([self.delegate respondsToSelector:@selector(serialPort:didReceiveData:)])
-		{
-			[self.delegate serialPort:self didReceiveData:data];
-		}
-	});
+	// On a half-duplex bus, bytes received while transmitting are local echo. If
+	// suppressesLocalEcho is on, it's checked against what was sent instead.
+	BOOL suppressesLocalEcho = self.suppressesLocalEcho;
+	if (self.RS485TransmitterEnabled && !suppressesLocalEcho) return;
+	
+	ORSSerialBaudRateProbe *baudRateProbe = self.baudRateProbe;
+	if (baudRateProbe) {
+		[baudRateProbe receiveData:data];
+		return;
+	}
+	
+	BOOL marksReceiveErrors = self.marksReceiveErrors;
+	BOOL usesCompressedFraming = self.usesCompressedFraming;
+	if (!marksReceiveErrors && !suppressesLocalEcho && !usesCompressedFraming) {
+		ORS_TRACE_INTERVAL_BEGIN(self, data, "Delegate Dispatch", "didReceiveData");
+		dispatch_async(dispatch_get_main_queue(), ^{
+			if ([self.delegate respondsToSelector:@selector(serialPort:didReceiveData:)])
+			{
+				[self.delegate serialPort:self didReceiveData:data];
+			}
+			ORS_TRACE_INTERVAL_END(self, data, "Delegate Dispatch", "returned");
+		});
+	}
 	
 	dispatch_async(self.requestHandlingQueue, ^{
-		const void *bytes = [data bytes];
-		for (NSUInteger i=0; i<[data length]; i++) {
+		NSData *receivedData = data;
+		NSIndexSet *errorIndexes = nil;
+		NSIndexSet *breakIndexes = nil;
+		if (marksReceiveErrors) {
+			if (!self.errorMarkParser) self.errorMarkParser = [[ORSSerialErrorMarkParser alloc] init];
+			receivedData = [self.errorMarkParser dataByParsingData:data errorIndexes:&errorIndexes breakIndexes:&breakIndexes];
+			self->counters.receiveErrorCount += [errorIndexes count];
+			self->counters.breakCount += [breakIndexes count];
+		}
+		if (suppressesLocalEcho) {
+			receivedData = [self dataBySuppressingEchoInData:receivedData errorIndexes:&errorIndexes breakIndexes:&breakIndexes];
+		}
+		if (usesCompressedFraming) {
+			// Corrupt bytes fail their frame's CRC, so indexes aren't needed after decoding
+			receivedData = [self dataByDecodingFramesInData:receivedData];
+			errorIndexes = nil;
+			breakIndexes = nil;
+		}
+		if (marksReceiveErrors || suppressesLocalEcho || usesCompressedFraming) {
+			[self notifyDelegateOfReceivedData:receivedData errorIndexes:errorIndexes breakIndexes:breakIndexes];
+		}
+		self->counters.receivedByteCount += [receivedData length];
+		
+		// Complete packet received, so notify delegate
+		ORSSerialPacketMatchHandler packetHandler = ^(ORSSerialPacketDescriptor *descriptor, NSData *completePacket) {
+			ORS_TRACE_EVENT(self, descriptor, "Packet Match", "%lu bytes", (unsigned long)[completePacket length]);
+			ORS_TRACE_INTERVAL_BEGIN(self, completePacket, "Delegate Dispatch", "didReceivePacket");
+			dispatch_async(dispatch_get_main_queue(), ^{
+				if ([self.delegate respondsToSelector:@selector(serialPort:didReceivePacket:matchingDescriptor:)])
+				{
+					[self.delegate serialPort:self didReceivePacket:completePacket matchingDescriptor:descriptor];
+				}
+				ORS_TRACE_INTERVAL_END(self, completePacket, "Delegate Dispatch", "returned");
+			});
+		};
+		
+		const uint8_t *bytes = [receivedData bytes];
+		NSUInteger length = [receivedData length];
+		BOOL hasErrors = errorIndexes || breakIndexes;
+		for (NSUInteger i=0; i<length; i++) {
+			
+			// A packet can't span a break or include a byte received with an error
+			if (hasErrors) {
+				if ([breakIndexes containsIndex:i]) [self discardPartiallyReceivedPackets];
+				if ([errorIndexes containsIndex:i]) {
+					[self discardPartiallyReceivedPackets];
+					continue;
+				}
+			}
 			
 			NSData *byte = [NSData dataWithBytesNoCopy:(void *)(bytes+i) length:1 freeWhenDone:NO];
 			
 			// Check for packets we're listening for
-			for (ORSSerialPacketDescriptor *descriptor in self.packetDescriptorsAndBuffers)
-			{
-				// Append byte to buffer
-				ORSSerialBuffer *buffer = [self.packetDescriptorsAndBuffers objectForKey:descriptor];
-				[buffer appendData:byte];
-				
-				// Check for complete packet
-				NSData *completePacket = [descriptor packetMatchingAtEndOfBuffer:buffer.data];
-				if (![completePacket length]) continue;
-				
-				// Complete packet received, so notify delegate then clear buffer
-				dispatch_async(dispatch_get_main_queue(), ^{
-					if ([self.delegate respondsToSelector:@selector(serialPort:didReceivePacket:matchingDescriptor:)])
-					{
-						[self.delegate serialPort:self didReceivePacket:completePacket matchingDescriptor:descriptor];
-					}
-				});
-				[buffer clearBuffer];
-			}
+			[self.packetMatcher appendByte:bytes[i] matchHandler:packetHandler];
 			
 			// Also check for response to pending request
 			[self checkResponseToPendingRequestAndContinueIfValidWithReceivedByte:byte];
 		}
+		if ([breakIndexes containsIndex:length]) [self discardPartiallyReceivedPackets];
+	});
+}
+
+// Must only be called on requestHandlingQueue
+- (void)discardPartiallyReceivedPackets
+{
+	[self.packetMatcher discardPartialPackets];
+	[self.requestResponseReceiveBuffer clearBuffer];
+}
+
+// Must only be called on requestHandlingQueue. Removes echo from the start of data,
+// and adjusts the error and break indexes to match.
+- (NSData *)dataBySuppressingEchoInData:(NSData *)data errorIndexes:(NSIndexSet **)errorIndexes breakIndexes:(NSIndexSet **)breakIndexes
+{
+	NSUInteger mismatchCount = 0, missingByteCount = 0;
+	NSUInteger echoLength = [self.echoCanceller lengthOfEchoAtStartOfBytes:[data bytes]
+																	length:[data length]
+															 mismatchCount:&mismatchCount
+														  missingByteCount:&missingByteCount];
+	counters.echoedByteCount += echoLength;
+	counters.echoMismatchCount += mismatchCount;
+	counters.missingEchoByteCount += missingByteCount;
+	if (echoLength == 0) return data;
+	
+	NSIndexSet *(^removeEcho)(NSIndexSet *) = ^NSIndexSet *(NSIndexSet *indexes) {
+		if (!indexes) return nil;
+		NSMutableIndexSet *result = [indexes mutableCopy];
+		[result removeIndexesInRange:NSMakeRange(0, echoLength)];
+		[result shiftIndexesStartingAtIndex:echoLength by:-(NSInteger)echoLength];
+		return [result count] ? result : nil;
+	};
+	*errorIndexes = removeEcho(*errorIndexes);
+	*breakIndexes = removeEcho(*breakIndexes);
+	return [data subdataWithRange:NSMakeRange(echoLength, [data length] - echoLength)];
+}
+
+typedef struct {
+	__unsafe_unretained NSMutableData *payloads;
+	__unsafe_unretained NSMutableIndexSet *messageTypesNeedingResync;
+	ORSSerialFrameReferences *sentFrameReferences;
+} ORSSerialPortFrameDecodingContext;
+
+static void ORSSerialPortHandleFrameEvent(ORSSerialFrameEvent event, uint8_t messageType, const uint8_t *payload, size_t length, void *context)
+{
+	ORSSerialPortFrameDecodingContext *decodingContext = context;
+	switch (event) {
+		case ORSSerialFrameEventPayload:
+			[decodingContext->payloads appendBytes:payload length:length];
+			break;
+		case ORSSerialFrameEventResyncRequested:
+			if (decodingContext->sentFrameReferences) ORSSerialFrameReferencesReset(decodingContext->sentFrameReferences, messageType);
+			break;
+		case ORSSerialFrameEventResyncNeeded:
+			[decodingContext->messageTypesNeedingResync addIndex:messageType];
+			break;
+	}
+}
+
+// Must only be called on requestHandlingQueue. Returns the payloads of the frames completed by data.
+- (NSData *)dataByDecodingFramesInData:(NSData *)data
+{
+	if (!frameDecoder) {
+		frameDecoder = calloc(1, sizeof(ORSSerialFrameDecoder));
+		frameDecoder->references = calloc(1, sizeof(ORSSerialFrameReferences));
+	}
+	
+	NSMutableData *payloads = [NSMutableData data];
+	NSMutableIndexSet *messageTypesNeedingResync = [NSMutableIndexSet indexSet];
+	ORSSerialPortFrameDecodingContext context = { payloads, messageTypesNeedingResync, sentFrameReferences };
+	unsigned long discardedFrameCount = frameDecoder->discardedFrameCount;
+	ORSSerialFrameDecoderPushBytes(frameDecoder, [data bytes], [data length], ORSSerialPortHandleFrameEvent, &context);
+	counters.discardedFrameCount += frameDecoder->discardedFrameCount - discardedFrameCount;
+	
+	[messageTypesNeedingResync enumerateIndexesUsingBlock:^(NSUInteger messageType, BOOL *stop) {
+		[self sendResyncFrameForMessageType:messageType];
+	}];
+	return payloads;
+}
+
+// Asks the peer to send the next message of messageType whole, or of every type if 0
+- (void)sendResyncFrameForMessageType:(NSUInteger)messageType
+{
+	NSMutableData *frame = [NSMutableData dataWithLength:ORS_SERIAL_FRAME_MAXIMUM_LENGTH(1)];
+	[frame setLength:ORSSerialFrameEncodeResync((uint8_t)messageType, [frame mutableBytes])];
+	if (self.isOpen) [self sendEncodedData:frame completionHandler:nil];
+}
+
+// Must only be called on requestHandlingQueue
+- (void)resetFraming
+{
+	if (frameDecoder) {
+		ORSSerialFrameDecoderReset(frameDecoder);
+		ORSSerialFrameReferencesReset(frameDecoder->references, 0);
+	}
+	if (sentFrameReferences) ORSSerialFrameReferencesReset(sentFrameReferences, 0);
+}
+
+- (void)resynchronizeDeltaEncoding
+{
+	dispatch_async(self.requestHandlingQueue, ^{
+		if (self->frameDecoder) ORSSerialFrameReferencesReset(self->frameDecoder->references, 0);
+		if (self->sentFrameReferences) ORSSerialFrameReferencesReset(self->sentFrameReferences, 0);
+		[self sendResyncFrameForMessageType:0];
+	});
+}
+
+- (void)notifyDelegateOfReceivedData:(NSData *)data errorIndexes:(NSIndexSet *)errorIndexes breakIndexes:(NSIndexSet *)breakIndexes
+{
+	ORS_TRACE_INTERVAL_BEGIN(self, data, "Delegate Dispatch", "didReceiveData");
+	dispatch_async(dispatch_get_main_queue(), ^{
+		if ([data length] && [self.delegate respondsToSelector:@selector(serialPort:didReceiveData:)])
+		{
+			[self.delegate serialPort:self didReceiveData:data];
+		}
+		
+		if ((errorIndexes || breakIndexes) &&
+			[self.delegate respondsToSelector:@selector(serialPort:didReceiveData:withErrorsAtIndexes:breaksAtIndexes:)])
+		{
+			[self.delegate serialPort:self didReceiveData:data withErrorsAtIndexes:errorIndexes ?: [NSIndexSet indexSet] breaksAtIndexes:breakIndexes ?: [NSIndexSet indexSet]];
+		}
+		ORS_TRACE_INTERVAL_END(self, data, "Delegate Dispatch", "returned");
+	});
+}
+
+#pragma mark Monitoring
+
+// Called periodically by ORSSerialPortMonitor while monitorsReceiveBacklog or monitorsTransmitQueue is YES
+- (void)monitorDidFire
+{
+	int descriptor = self.fileDescriptor;
+	if (descriptor < 1) return;
+	
+	// The shared timer fires as often as the most demanding port needs, so only do what's due.
+	// Allow for the timer's phase not lining up with this port's schedule.
+	NSTimeInterval now = [NSDate timeIntervalSinceReferenceDate];
+	if (self.conservesIdleWakeups) {
+		NSTimeInterval interval = self.modemLinePollInterval;
+		if (now - self.lastModemLinePollTime >= interval * 0.75) {
+			self.lastModemLinePollTime = now;
+			BOOL changed = [self pollModemLines];
+			self.modemLinePollInterval = changed ? ORSSerialPortMinimumModemLinePollInterval : MIN(interval * 2, ORSSerialPortMaximumModemLinePollInterval);
+		}
+	}
+	
+	if (!self.monitorsTransmitQueue && !self.monitorsReceiveBacklog) return;
+	if (now - self.lastMonitorSampleTime < ORSSerialPortMonitorInterval * 0.75) return;
+	self.lastMonitorSampleTime = now;
+	
+	if (self.monitorsTransmitQueue) {
+		NSUInteger queueLength = self.transmitQueueLength;
+		dispatch_async(self.requestHandlingQueue, ^{
+			self->counters.transmitQueueLength = queueLength;
+			self->counters.maximumTransmitQueueLength = MAX(self->counters.maximumTransmitQueueLength, queueLength);
+		});
+	}
+	
+	int backlog = 0;
+	if (!self.monitorsReceiveBacklog || ioctl(descriptor, FIONREAD, &backlog) < 0) return;
+	
+	dispatch_async(self.requestHandlingQueue, ^{
+		NSUInteger byteCount = (NSUInteger)MAX(backlog, 0);
+		self->counters.receiveBacklog = byteCount;
+		self->counters.maximumReceiveBacklog = MAX(self->counters.maximumReceiveBacklog, byteCount);
+		
+		// Only warn when the backlog first rises above the threshold
+		BOOL exceeded = byteCount >= self.receiveBacklogWarningThreshold;
+		if (exceeded == self.receiveBacklogExceeded) return;
+		self.receiveBacklogExceeded = exceeded;
+		if (!exceeded) return;
+		
+		self->counters.receiveBacklogWarningCount++;
+		dispatch_async(dispatch_get_main_queue(), ^{
+			if ([self.delegate respondsToSelector:@selector(serialPort:receiveBacklogDidExceedThreshold:)])
+			{
+				[self.delegate serialPort:self receiveBacklogDidExceedThreshold:byteCount];
+			}
+		});
 	});
 }
 
@@ -664,12 +1538,21 @@ static __strong NSMutableArray *allSerialPorts;
 	options.c_cflag = [self usesRTSCTSFlowControl] ? options.c_cflag | CRTSCTS : options.c_cflag & ~CRTSCTS; // RTS/CTS Flow Control
 	options.c_cflag = [self usesDTRDSRFlowControl] ? options.c_cflag | (CDTR_IFLOW | CDSR_OFLOW) : options.c_cflag & ~(CDTR_IFLOW | CDSR_OFLOW); // DTR/DSR Flow Control
 	options.c_cflag = [self usesDCDOutputFlowControl] ? options.c_cflag | CCAR_OFLOW : options.c_cflag & ~CCAR_OFLOW; // DCD Flow Control
+	options.c_iflag = [self usesXONXOFFFlowControl] ? options.c_iflag | (IXON | IXOFF) : options.c_iflag & ~(IXON | IXOFF | IXANY); // XON/XOFF Flow Control
+	options.c_cc[VSTART] = 0x11; // XON (DC1)
+	options.c_cc[VSTOP] = 0x13; // XOFF (DC3)
 	
 	options.c_cflag |= HUPCL; // Turn on hangup on close
 	options.c_cflag |= CLOCAL; // Set local mode on
 	options.c_cflag |= CREAD; // Enable receiver
 	options.c_lflag &= ~(ICANON /*| ECHO*/ | ISIG); // Turn off canonical mode and signals
 	
+	// Mark bytes received with parity or framing errors, and breaks, in the data. See -receiveData:
+	if ([self marksReceiveErrors]) {
+		options.c_iflag |= (INPCK | PARMRK);
+		options.c_iflag &= ~(IGNPAR | IGNBRK | BRKINT | ISTRIP);
+	}
+	
 	// Set baud rate
 	cfsetspeed(&options, [[self baudRate] unsignedLongValue]);
 	
@@ -682,6 +1565,7 @@ static __strong NSMutableArray *allSerialPorts;
 		}
 		if (result != 0) {
 			// Notify delegate of port error stored in errno
+			ORS_LOG_SERIAL_PORT_ERROR(ORSSerialErrorLogOperationConfigure, self.path, errno);
 			[self notifyDelegateOfPosixError];
 		}
 	}
@@ -691,6 +1575,23 @@ static __strong NSMutableArray *allSerialPorts;
 {
 	if ([bsdPath length] < 1) return 0;
 	
+	// Look the device up directly if its path was seen before
+	NSNumber *registryEntryID = nil;
+	@synchronized(registryEntryIDsByPath) {
+		registryEntryID = registryEntryIDsByPath[bsdPath];
+	}
+	if (registryEntryID) {
+		io_object_t device = IOServiceGetMatchingService(kIOMasterPortDefault, IORegistryEntryIDMatching([registryEntryID unsignedLongLongValue]));
+		if (device) {
+			if ([bsdPath isEqualToString:[self bsdCalloutPathFromDevice:device]] ||
+				[bsdPath isEqualToString:[self bsdDialinPathFromDevice:device]]) return device;
+			IOObjectRelease(device);
+		}
+		@synchronized(registryEntryIDsByPath) {
+			[registryEntryIDsByPath removeObjectForKey:bsdPath]; // Device was removed
+		}
+	}
+	
 	CFMutableDictionaryRef matchingDict = NULL;
 	
 	matchingDict = IOServiceMatching(kIOSerialBSDServiceValue);
@@ -709,6 +1610,7 @@ static __strong NSMutableArray *allSerialPorts;
 	{
 		NSString *calloutPath = [self bsdCalloutPathFromDevice:eachPort];
 		NSString *dialinPath = [self bsdDialinPathFromDevice:eachPort];
+		[self cacheRegistryEntryIDOfDevice:eachPort calloutPath:calloutPath dialinPath:dialinPath];
 		if ([bsdPath isEqualToString:calloutPath] ||
 			[bsdPath isEqualToString:dialinPath])
 		{
@@ -722,6 +1624,16 @@ static __strong NSMutableArray *allSerialPorts;
 	return result;
 }
 
++ (void)cacheRegistryEntryIDOfDevice:(io_object_t)device calloutPath:(NSString *)calloutPath dialinPath:(NSString *)dialinPath
+{
+	uint64_t entryID = 0;
+	if (IORegistryEntryGetRegistryEntryID(device, &entryID) != KERN_SUCCESS) return;
+	@synchronized(registryEntryIDsByPath) {
+		if (calloutPath) registryEntryIDsByPath[calloutPath] = @(entryID);
+		if (dialinPath) registryEntryIDsByPath[dialinPath] = @(entryID);
+	}
+}
+
 + (NSString *)stringPropertyOf:(io_object_t)aDevice forIOSerialKey:(NSString *)key;
 {
 	CFStringRef string = (CFStringRef)IORegistryEntryCreateCFProperty(aDevice,
@@ -770,13 +1682,27 @@ static __strong NSMutableArray *allSerialPorts;
 
 - (void)notifyDelegateOfPosixErrorWaitingUntilDone:(BOOL)shouldWait;
 {
-	if (![self.delegate respondsToSelector:@selector(serialPort:didEncounterError:)]) return;
-	
-	NSDictionary *errDict = @{NSLocalizedDescriptionKey: @(strerror(errno)),
+	[self notifyDelegateOfError:[self posixError] waitingUntilDone:shouldWait];
+}
+
+// Returns an error for the current value of errno
+- (NSError *)posixError
+{
+	return [self posixErrorWithCode:errno];
+}
+
+- (NSError *)posixErrorWithCode:(int)code
+{
+	NSDictionary *errDict = @{NSLocalizedDescriptionKey: @(strerror(code)),
 							  NSFilePathErrorKey: self.path};
-	NSError *error = [NSError errorWithDomain:NSPOSIXErrorDomain
-										 code:errno
-									 userInfo:errDict];
+	return [NSError errorWithDomain:NSPOSIXErrorDomain
+							   code:code
+						   userInfo:errDict];
+}
+
+- (void)notifyDelegateOfError:(NSError *)error waitingUntilDone:(BOOL)shouldWait
+{
+	if (![self.delegate respondsToSelector:@selector(serialPort:didEncounterError:)]) return;
 	
 	void (^notifyBlock)(void) = ^{
 		[self.delegate serialPort:self didEncounterError:error];
@@ -785,7 +1711,9 @@ static __strong NSMutableArray *allSerialPorts;
 	if ([NSThread isMainThread]) {
 		notifyBlock();
 	} else if (shouldWait) {
+		ORS_TRACE_INTERVAL_BEGIN(self, self, "Main Queue Sync", "didEncounterError");
 		dispatch_sync(dispatch_get_main_queue(), notifyBlock);
+		ORS_TRACE_INTERVAL_END(self, self, "Main Queue Sync", "didEncounterError");
 	} else {
 		dispatch_async(dispatch_get_main_queue(), notifyBlock);
 	}
@@ -812,28 +1740,46 @@ static __strong NSMutableArray *allSerialPorts;
 
 - (void)insertObject:(ORSSerialRequest *)request inRequestsQueueAtIndex:(NSUInteger)index
 {
+	if (!self.requestsQueue) self.requestsQueue = [NSMutableArray array];
 	[self.requestsQueue insertObject:request atIndex:index];
+	ORS_TRACE_COUNTER(self, "Request Queue", [self.requestsQueue count]);
 }
 
 - (void)removeObjectFromRequestsQueueAtIndex:(NSUInteger)index
 {
 	[self.requestsQueue removeObjectAtIndex:index];
+	ORS_TRACE_COUNTER(self, "Request Queue", [self.requestsQueue count]);
 }
 
 - (NSArray *)queuedRequests
 {
-	return [self.requestsQueue copy];
+	return [self.requestsQueue copy] ?: @[];
 }
 
-+ (NSSet *)keyPathsForValuesAffectingPacketDescriptors
+- (NSArray *)packetDescriptors
 {
-	return [NSSet setWithObject:@"packetDescriptorsAndBuffers"];
+	return self.packetMatcher.packetDescriptors ?: @[];
 }
 
-- (NSArray *)packetDescriptors
+// The matcher is read without locking on requestHandlingQueue, which is safe because it's never replaced once set
+- (ORSSerialPacketMatcher *)createPacketMatcherIfNeeded
 {
-	NSArray *result = NSAllMapTableKeys(self.packetDescriptorsAndBuffers);
-	return result ?: @[];
+	@synchronized(self) {
+		if (!self.packetMatcher) self.packetMatcher = [[ORSSerialPacketMatcher alloc] init];
+		return self.packetMatcher;
+	}
+}
+
+- (BOOL)automaticallyTunesPacketBufferLengths { return self.packetMatcher.automaticallyTunesBufferLength; }
+- (void)setAutomaticallyTunesPacketBufferLengths:(BOOL)flag
+{
+	if (flag || self.packetMatcher) [self createPacketMatcherIfNeeded].automaticallyTunesBufferLength = flag;
+}
+
+- (BOOL)packetDescriptorsAreMutuallyExclusive { return self.packetMatcher.descriptorsAreMutuallyExclusive; }
+- (void)setPacketDescriptorsAreMutuallyExclusive:(BOOL)flag
+{
+	if (flag || self.packetMatcher) [self createPacketMatcherIfNeeded].descriptorsAreMutuallyExclusive = flag;
 }
 
 - (BOOL)isOpen { return self.fileDescriptor != 0; }
@@ -875,6 +1821,77 @@ static __strong NSMutableArray *allSerialPorts;
     }
 }
 
+- (void)setMonitorsReceiveBacklog:(BOOL)flag
+{
+	if (flag == _monitorsReceiveBacklog) return;
+	_monitorsReceiveBacklog = flag;
+	[self updateMonitoring];
+}
+
+- (void)setMonitorsTransmitQueue:(BOOL)flag
+{
+	if (flag == _monitorsTransmitQueue) return;
+	_monitorsTransmitQueue = flag;
+	[self updateMonitoring];
+}
+
+- (void)updateMonitoring
+{
+	ORSSerialPortMonitor *monitor = [ORSSerialPortMonitor sharedMonitor];
+	if (self.isOpen && (self.monitorsReceiveBacklog || self.monitorsTransmitQueue || self.conservesIdleWakeups)) {
+		[monitor addPort:self];
+	} else {
+		[monitor removePort:self];
+	}
+}
+
+- (void)setConservesIdleWakeups:(BOOL)flag
+{
+	if (flag == _conservesIdleWakeups) return;
+	_conservesIdleWakeups = flag;
+	if (!self.isOpen) return;
+	
+	self.modemLinePollInterval = ORSSerialPortMinimumModemLinePollInterval;
+	self.pinPollTimer = nil;
+	if (!flag) [self startPinPollTimer];
+	[self updateMonitoring];
+}
+
+- (NSTimeInterval)monitorInterval
+{
+	NSTimeInterval interval = DBL_MAX;
+	if (self.monitorsReceiveBacklog || self.monitorsTransmitQueue) interval = ORSSerialPortMonitorInterval;
+	if (self.conservesIdleWakeups) interval = MIN(interval, self.modemLinePollInterval);
+	return interval;
+}
+
+// Modem lines usually change around the time data moves, so poll them quickly again
+- (void)speedUpModemLinePolling
+{
+	if (!self.conservesIdleWakeups || self.modemLinePollInterval <= ORSSerialPortMinimumModemLinePollInterval) return;
+	self.modemLinePollInterval = ORSSerialPortMinimumModemLinePollInterval;
+	[[ORSSerialPortMonitor sharedMonitor] portMonitorIntervalDidChange:self];
+}
+
+- (NSUInteger)transmitQueueLength
+{
+	int descriptor = self.fileDescriptor;
+	if (descriptor < 1) return 0;
+	
+	int length = 0;
+	if (ioctl(descriptor, TIOCOUTQ, &length) < 0) return 0;
+	return (NSUInteger)MAX(length, 0);
+}
+
+- (void)setMarksReceiveErrors:(BOOL)flag
+{
+	if (flag != _marksReceiveErrors)
+	{
+		_marksReceiveErrors = flag;
+		[self setPortOptions];
+	}
+}
+
 - (void)setShouldEchoReceivedData:(BOOL)flag
 {
 	if (flag != _shouldEchoReceivedData)
@@ -916,6 +1933,15 @@ static __strong NSMutableArray *allSerialPorts;
 	}
 }
 
+- (void)setUsesXONXOFFFlowControl:(BOOL)flag
+{
+	if (flag != _usesXONXOFFFlowControl)
+	{
+		_usesXONXOFFFlowControl = flag;
+		[self setPortOptions];
+	}
+}
+
 - (void)setUsesDTRDSRFlowControl:(BOOL)flag
 {
 	if (flag != _usesDTRDSRFlowControl)
@@ -951,17 +1977,50 @@ static __strong NSMutableArray *allSerialPorts;
 {
 	if (![self isOpen]) return;
 
+	// In RS-485 mode, RTS is only asserted while transmitting
+	BOOL RTS = self.usesRS485DirectionControl ? self.RS485TransmitterEnabled : self.RTS;
+	
 	int bits;
 	ioctl( self.fileDescriptor, TIOCMGET, &bits ) ;
-	bits = self.RTS ? bits | TIOCM_RTS : bits & ~TIOCM_RTS;
+	bits = RTS ? bits | TIOCM_RTS : bits & ~TIOCM_RTS;
 	bits = self.DTR ? bits | TIOCM_DTR : bits & ~TIOCM_DTR;
+	ORS_TRACE_COUNTER(self, "RTS", RTS);
+	ORS_TRACE_COUNTER(self, "DTR", self.DTR);
 	if (ioctl( self.fileDescriptor, TIOCMSET, &bits ) < 0)
 	{
-		LOG_SERIAL_PORT_ERROR(@"Error in %s", __PRETTY_FUNCTION__);
+		ORS_LOG_SERIAL_PORT_ERROR(ORSSerialErrorLogOperationModemLines, self.path, errno);
 		[self notifyDelegateOfPosixError];
 	}
 }
 
+- (void)setSuppressesLocalEcho:(BOOL)flag
+{
+	if (flag != _suppressesLocalEcho)
+	{
+		if (flag && !self.echoCanceller) self.echoCanceller = [[ORSSerialEchoCanceller alloc] init];
+		_suppressesLocalEcho = flag;
+		[self.echoCanceller reset];
+	}
+}
+
+- (void)setUsesCompressedFraming:(BOOL)flag
+{
+	if (flag != _usesCompressedFraming)
+	{
+		_usesCompressedFraming = flag;
+		dispatch_async(self.requestHandlingQueue, ^{ [self resetFraming]; });
+	}
+}
+
+- (void)setUsesRS485DirectionControl:(BOOL)flag
+{
+	if (flag != _usesRS485DirectionControl)
+	{
+		_usesRS485DirectionControl = flag;
+		[self updateModemLines];
+	}
+}
+
 - (void)setRTS:(BOOL)flag
 {
 	if (flag != _RTS)
@@ -1033,4 +2092,24 @@ static __strong NSMutableArray *allSerialPorts;
 	}
 }
 
+- (dispatch_queue_t)transmitCompletionQueue
+{
+	@synchronized(self) {
+		if (!_transmitCompletionQueue) {
+			_transmitCompletionQueue = dispatch_queue_create("com.openreelsoftware.ORSSerialPort.transmitCompletionQueue", 0);
+		}
+		return _transmitCompletionQueue;
+	}
+}
+
+- (void)setTransmitCompletionQueue:(dispatch_queue_t)transmitCompletionQueue
+{
+	if (transmitCompletionQueue != _transmitCompletionQueue)
+	{
+		ORS_GCD_RELEASE(_transmitCompletionQueue);
+		ORS_GCD_RETAIN(transmitCompletionQueue);
+		_transmitCompletionQueue = transmitCompletionQueue;
+	}
+}
+
 @end
@@ -0,0 +1,38 @@
+//
+//  ORSSerialPortCounters.h
+//  ORSSerialPort
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 Open Reel Software. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+#ifdef SWIFTPM
+#import "ORSSerial/ORSSerialPortStatistics.h"
+#else
+#import <ORSSerial/ORSSerialPortStatistics.h>
+#endif
+
+// Running totals kept by ORSSerialPort on its requestHandlingQueue
+typedef struct {
+	unsigned long long receivedByteCount;
+	unsigned long long receiveErrorCount;
+	unsigned long long breakCount;
+	unsigned long long receiveBacklogWarningCount;
+	NSUInteger receiveBacklog;
+	NSUInteger maximumReceiveBacklog;
+	unsigned long long sentByteCount;
+	NSUInteger transmitQueueLength;
+	NSUInteger maximumTransmitQueueLength;
+	unsigned long long echoedByteCount;
+	unsigned long long echoMismatchCount;
+	unsigned long long missingEchoByteCount;
+	unsigned long long discardedFrameCount;
+} ORSSerialPortCounters;
+
+@interface ORSSerialPortStatistics (ORSSerialPortCounters)
+
+- (instancetype)initWithCounters:(ORSSerialPortCounters)counters;
+
+@end
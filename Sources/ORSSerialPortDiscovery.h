@@ -0,0 +1,51 @@
+//
+//  ORSSerialPortDiscovery.h
+//  ORSSerialPort
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 Open Reel Software. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+#ifdef SWIFTPM
+#import "ORSSerial/ORSSerialPort.h"
+#import "ORSSerial/ORSSerialPortMetadata.h"
+#else
+#import <ORSSerial/ORSSerialPort.h>
+#import <ORSSerial/ORSSerialPortMetadata.h>
+#endif
+
+@interface ORSSerialPort (ORSSerialPortDiscovery)
+
+/**
+ *  Creates a port for a device that isn't in the I/O Registry, such as the slave side of a
+ *  pseudo terminal. The port has no IOKitDevice or metadata.
+ */
+- (instancetype)initWithDevicelessPath:(NSString *)devicePath;
+
+/**
+ *  Like -sendRequest:, but the response is passed to handler, on a background queue, instead
+ *  of to the delegate. If the request times out, or the port is closed first, handler is called with nil.
+ */
+- (BOOL)sendRequest:(ORSSerialRequest *)request responseHandler:(void(^)(NSData *response))handler;
+
+/**
+ *  Like -openWithCompletionHandler: and -closeWithCompletionHandler:, but handler is called
+ *  on a background queue as soon as opening or closing has finished, instead of on the main
+ *  queue. It may be called before these methods return.
+ */
+- (void)openWithBackgroundCompletionHandler:(void(^)(NSError *error))handler;
+- (void)closeWithBackgroundCompletionHandler:(void(^)(NSError *error))handler;
+
+@end
+
+@interface ORSSerialPortMetadata (ORSSerialPortDiscovery)
+
+// Metadata with only the properties matching rules compare, for ports not in the I/O Registry
+- (instancetype)initWithVendorID:(NSNumber *)vendorID
+					   productID:(NSNumber *)productID
+					serialNumber:(NSString *)serialNumber
+					  locationID:(NSNumber *)locationID;
+
+@end
@@ -30,6 +30,10 @@
 
 #import "ORSSerial/ORSSerialPortManager.h"
 #import "ORSSerial/ORSSerialPort.h"
+#import "ORSSerial/ORSSerialRequest.h"
+#import "ORSSerial/ORSSerialPortMatchingRule.h"
+#import "ORSSerialPortDiscovery.h"
+#import "ORSSerialErrorLog.h"
 
 #ifdef ORSSERIAL_FRAMEWORK
 // To enable sleep/wake notifications, etc.
@@ -37,32 +41,48 @@
 #endif
 
 #import <IOKit/IOKitLib.h>
+#import <IOKit/IOMessage.h>
+#import <IOKit/pwr_mgt/IOPMLib.h>
 #import <IOKit/serial/IOSerialKeys.h>
 
-#ifdef LOG_SERIAL_PORT_ERRORS
-#define LOG_SERIAL_PORT_ERROR(fmt, ...) NSLog(fmt, ##__VA_ARGS__)
-#else
-#define LOG_SERIAL_PORT_ERROR(fmt, ...)
-#endif
-
 NSString * const ORSSerialPortsWereConnectedNotification = @"ORSSerialPortWasConnectedNotification";
 NSString * const ORSSerialPortsWereDisconnectedNotification = @"ORSSerialPortWasDisconnectedNotification";
 
 NSString * const ORSConnectedSerialPortsKey = @"ORSConnectedSerialPortsKey";
 NSString * const ORSDisconnectedSerialPortsKey = @"ORSDisconnectedSerialPortsKey";
 
+static const NSUInteger ORSSerialPortManagerDefaultMaximumConcurrentPortOperations = 8;
+
+typedef void(^ORSSerialPortOperation)(ORSSerialPort *port, void(^completion)(NSError *error));
+
 void ORSSerialPortManagerPortsPublishedNotificationCallback(void *refCon, io_iterator_t iterator);
 void ORSSerialPortManagerPortsTerminatedNotificationCallback(void *refCon, io_iterator_t iterator);
+void ORSSerialPortManagerSystemPowerCallback(void *refCon, io_service_t service, natural_t messageType, void *messageArgument);
 
 @interface ORSSerialPortManager ()
 
 @property (nonatomic, copy, readwrite) NSArray *availablePorts;
 @property (nonatomic, strong) NSMutableArray *portsToReopenAfterSleep;
+// Sleep/wake bookkeeping, only used on the main queue. A wake that arrives while ports are still
+// being closed for sleep waits for closing to finish.
+@property (nonatomic) NSUInteger sleepClosesInProgress;
+@property (nonatomic, strong) NSMutableArray *wakeReopensWaitingForSleepClose;
 @property (nonatomic, strong) id terminationObserver;
 
 @property (nonatomic) io_iterator_t portPublishedNotificationIterator;
 @property (nonatomic) io_iterator_t portTerminatedNotificationIterator;
 
+@property (nonatomic, readwrite) NSTimeInterval lastWakeRecoveryTime;
+
+// Port matching. Guarded by @synchronized(matchingRulesByName).
+@property (nonatomic, strong) NSMutableDictionary *matchingRulesByName;
+@property (nonatomic, strong) NSMutableDictionary *portsByMatchingRuleName;
+
+// Used for sleep/wake notifications when AppKit isn't available
+@property (nonatomic) io_connect_t systemPowerConnection;
+@property (nonatomic) io_object_t systemPowerNotifier;
+@property (nonatomic) IONotificationPortRef systemPowerNotificationPort;
+
 @end
 
 static ORSSerialPortManager *sharedInstance = nil;
@@ -82,6 +102,10 @@ static ORSSerialPortManager *sharedInstance = nil;
 	if (self != nil)
 	{
 		self.portsToReopenAfterSleep = [NSMutableArray array];
+		self.wakeReopensWaitingForSleepClose = [NSMutableArray array];
+		self.matchingRulesByName = [NSMutableDictionary dictionary];
+		self.portsByMatchingRuleName = [NSMutableDictionary dictionary];
+		self.maximumConcurrentPortOperations = ORSSerialPortManagerDefaultMaximumConcurrentPortOperations;
 		
 		[self retrieveAvailablePortsAndRegisterForChangeNotifications];
 		[self registerForNotifications];
@@ -117,6 +141,10 @@ static ORSSerialPortManager *sharedInstance = nil;
 	NSNotificationCenter *wsnc = [[NSWorkspace sharedWorkspace] notificationCenter];
 	[wsnc removeObserver:self];
 	if (self.terminationObserver) [nc removeObserver:self.terminationObserver];
+#else
+	if (_systemPowerNotifier) IODeregisterForSystemPower(&_systemPowerNotifier);
+	if (_systemPowerConnection) IOServiceClose(_systemPowerConnection);
+	if (_systemPowerNotificationPort) IONotificationPortDestroy(_systemPowerNotificationPort);
 #endif
 	// Stop IOKit notifications for ports being added/removed
 	IOObjectRelease(_portPublishedNotificationIterator);
@@ -144,42 +172,259 @@ static ORSSerialPortManager *sharedInstance = nil;
 	[wsnc addObserver:self selector:@selector(systemWillSleep:) name:NSWorkspaceWillSleepNotification object:NULL];
 	[wsnc addObserver:self selector:@selector(systemDidWake:) name:NSWorkspaceDidWakeNotification object:NULL];
 #else
-	// If AppKit isn't available, as in a Foundation command-line tool, cleanup upon exit. Sleep/wake
-	// notifications don't seem to be available without NSWorkspace.
+	// If AppKit isn't available, as in a Foundation command-line tool, cleanup upon exit.
 	int result = atexit_b(terminationBlock);
 	if (result) NSLog(@"ORSSerialPort was unable to register its termination handler for serial port cleanup: %i", errno);
+	
+	// NSWorkspace isn't available either, so get sleep/wake notifications from IOKit power management
+	IONotificationPortRef notificationPort = NULL;
+	io_object_t notifier = 0;
+	io_connect_t connection = IORegisterForSystemPower((__bridge void *)self, &notificationPort, ORSSerialPortManagerSystemPowerCallback, &notifier);
+	if (connection == MACH_PORT_NULL) {
+		ORS_LOG_SERIAL_PORT_ERROR(ORSSerialErrorLogOperationPowerNotifications, nil, 0);
+		return;
+	}
+	CFRunLoopAddSource(CFRunLoopGetCurrent(), IONotificationPortGetRunLoopSource(notificationPort), kCFRunLoopDefaultMode);
+	self.systemPowerConnection = connection;
+	self.systemPowerNotifier = notifier;
+	self.systemPowerNotificationPort = notificationPort;
 #endif
 }
 
 #pragma mark - Public Methods
 
+- (void)openPorts:(NSArray *)ports completionHandler:(void(^)(NSArray *failedPorts))handler
+{
+	[self performOperation:^(ORSSerialPort *port, void(^completion)(NSError *)) {
+		[port openWithBackgroundCompletionHandler:completion];
+	} onPorts:ports completionHandler:handler];
+}
+
+- (void)closePorts:(NSArray *)ports completionHandler:(void(^)(NSArray *failedPorts))handler
+{
+	[self performOperation:^(ORSSerialPort *port, void(^completion)(NSError *)) {
+		[port closeWithBackgroundCompletionHandler:completion];
+	} onPorts:ports completionHandler:handler];
+}
+
+- (void)discoverDevicesOnPorts:(NSArray *)ports
+				  probeRequest:(ORSSerialRequest *)request
+					   timeout:(NSTimeInterval)timeout
+			 completionHandler:(void(^)(NSDictionary *responsesByPath))handler
+{
+	ports = [ports ?: self.availablePorts copy];
+	NSArray *closedPorts = [ports filteredArrayUsingPredicate:[NSPredicate predicateWithBlock:^BOOL(ORSSerialPort *port, NSDictionary *bindings) { return !port.isOpen; }]];
+	dispatch_time_t deadline = dispatch_time(DISPATCH_TIME_NOW, (int64_t)(timeout * NSEC_PER_SEC));
+	NSDate *deadlineDate = [NSDate dateWithTimeIntervalSinceNow:timeout];
+	
+	// All state below is only used on queue
+	dispatch_queue_t queue = dispatch_queue_create("com.openreelsoftware.ORSSerialPortManager.discoveryQueue", 0);
+	NSMutableDictionary *responsesByPath = [NSMutableDictionary dictionary];
+	__block BOOL finished = NO;
+	__block NSUInteger unfinishedProbeCount = 0;
+	
+	// Ports opened for discovery are closed again before handler is called
+	void(^finish)(void) = ^{
+		if (finished) return;
+		finished = YES;
+		NSDictionary *responses = [responsesByPath copy];
+		[self closePorts:closedPorts completionHandler:^(NSArray *failedPorts) {
+			if (handler) handler(responses);
+		}];
+	};
+	dispatch_after(deadline, queue, finish);
+	
+	[self openPorts:closedPorts completionHandler:^(NSArray *failedPorts) {
+		NSArray *openPorts = [ports filteredArrayUsingPredicate:[NSPredicate predicateWithBlock:^BOOL(ORSSerialPort *port, NSDictionary *bindings) { return port.isOpen; }]];
+		NSTimeInterval remainingTime = MAX([deadlineDate timeIntervalSinceNow], 0.001);
+		if (request.timeoutInterval > 0) remainingTime = MIN(remainingTime, request.timeoutInterval);
+		
+		dispatch_sync(queue, ^{ unfinishedProbeCount = [openPorts count]; });
+		if (![openPorts count]) dispatch_async(queue, finish);
+		
+		// Every port is probed at once, each with its own copy of request
+		for (ORSSerialPort *port in openPorts) {
+			NSString *path = port.path;
+			void(^probeDidFinish)(NSData *) = ^(NSData *response) {
+				dispatch_async(queue, ^{
+					if (finished) return;
+					if (response) responsesByPath[path] = response;
+					if (--unfinishedProbeCount == 0) finish();
+				});
+			};
+			ORSSerialRequest *portRequest = [ORSSerialRequest requestWithDataToSend:request.dataToSend
+																		   userInfo:request.userInfo
+																	timeoutInterval:remainingTime
+																 responseDescriptor:request.responseDescriptor
+																		messageType:request.messageType];
+			if (![port sendRequest:portRequest responseHandler:probeDidFinish]) probeDidFinish(nil);
+		}
+	}];
+}
+
 #pragma mark -
-#pragma Sleep/Wake Management
+#pragma Port Matching
 
-- (void)systemWillSleep:(NSNotification *)notification;
+- (void)addPortMatchingRule:(ORSSerialPortMatchingRule *)rule
 {
 	NSArray *ports = self.availablePorts;
-	for (ORSSerialPort *port in ports)
-	{
-		if (port.isOpen)
-		{
-			if ([port close]) [self.portsToReopenAfterSleep addObject:port];
+	@synchronized(self.matchingRulesByName) {
+		self.matchingRulesByName[rule.name] = rule;
+		[self.portsByMatchingRuleName removeObjectForKey:rule.name];
+		for (ORSSerialPort *port in ports) {
+			if (![rule matchesMetadata:port.metadata]) continue;
+			self.portsByMatchingRuleName[rule.name] = port;
+			break;
 		}
 	}
 }
 
-- (void)systemDidWake:(NSNotification *)notification;
+- (void)removePortMatchingRule:(ORSSerialPortMatchingRule *)rule
+{
+	@synchronized(self.matchingRulesByName) {
+		[self.matchingRulesByName removeObjectForKey:rule.name];
+		[self.portsByMatchingRuleName removeObjectForKey:rule.name];
+	}
+}
+
+- (ORSSerialPort *)portMatchingRuleNamed:(NSString *)name
+{
+	@synchronized(self.matchingRulesByName) {
+		return self.portsByMatchingRuleName[name];
+	}
+}
+
+#pragma mark -
+#pragma Sleep/Wake Management
+
+- (void)closePortsForSystemSleepWithCompletionHandler:(void(^)(void))handler
+{
+	NSArray *openPorts = [self.availablePorts filteredArrayUsingPredicate:[NSPredicate predicateWithBlock:^BOOL(ORSSerialPort *port, NSDictionary *bindings) { return port.isOpen; }]];
+	
+	// Remember the ports now, in case the system wakes before they've all closed
+	for (ORSSerialPort *port in openPorts) {
+		if (![self.portsToReopenAfterSleep containsObject:port]) [self.portsToReopenAfterSleep addObject:port];
+	}
+	
+	self.sleepClosesInProgress++;
+	[self closePorts:openPorts completionHandler:^(NSArray *failedPorts) {
+		[self.portsToReopenAfterSleep removeObjectsInArray:failedPorts]; // Still open
+		if (handler) handler();
+		
+		if (--self.sleepClosesInProgress) return;
+		NSArray *waitingReopens = [self.wakeReopensWaitingForSleepClose copy];
+		[self.wakeReopensWaitingForSleepClose removeAllObjects];
+		for (void(^reopen)(void) in waitingReopens) reopen();
+	}];
+}
+
+- (void)reopenPortsAfterSystemWakeWithCompletionHandler:(void(^)(void))handler
 {
+	if (self.sleepClosesInProgress) {
+		[self.wakeReopensWaitingForSleepClose addObject:[^{ [self reopenPortsAfterSystemWakeWithCompletionHandler:handler]; } copy]];
+		return;
+	}
+	
+	// Each port still has its settings and packet descriptors, and applies all of its
+	// settings at once when it is opened.
 	NSArray *portsToReopen = [self.portsToReopenAfterSleep copy];
-	for (ORSSerialPort *port in portsToReopen)
-	{
-		[port open];
-		[self.portsToReopenAfterSleep removeObject:port];
+	[self.portsToReopenAfterSleep removeAllObjects];
+	
+	NSDate *wakeDate = [NSDate date];
+	[self openPorts:portsToReopen completionHandler:^(NSArray *failedPorts) {
+		self.lastWakeRecoveryTime = -[wakeDate timeIntervalSinceNow];
+		if (handler) handler();
+	}];
+}
+
+- (void)systemWillSleep:(NSNotification *)notification;
+{
+	[self closePortsForSystemSleepWithCompletionHandler:nil];
+}
+
+- (void)systemDidWake:(NSNotification *)notification;
+{
+	[self reopenPortsAfterSystemWakeWithCompletionHandler:nil];
+}
+
+- (void)systemPowerStateWillChange:(natural_t)messageType argument:(void *)messageArgument
+{
+	io_connect_t connection = self.systemPowerConnection;
+	switch (messageType) {
+		case kIOMessageCanSystemSleep:
+			IOAllowPowerChange(connection, (long)messageArgument);
+			break;
+		case kIOMessageSystemWillSleep:
+			// Hold off sleep until ports are closed
+			[self closePortsForSystemSleepWithCompletionHandler:^{ IOAllowPowerChange(connection, (long)messageArgument); }];
+			break;
+		case kIOMessageSystemHasPoweredOn:
+			[self reopenPortsAfterSystemWakeWithCompletionHandler:nil];
+			break;
+		default:
+			break;
 	}
 }
 
 #pragma mark - Private Methods
 
+// Starts operation for each port, with no more than maximumConcurrentPortOperations unfinished at once.
+// Operations are started from a private queue, so the caller isn't blocked waiting for a free slot.
+// Each operation's completion is called on a background queue, so its slot is freed as soon as it finishes.
+- (void)performOperation:(ORSSerialPortOperation)operation onPorts:(NSArray *)ports completionHandler:(void(^)(NSArray *failedPorts))handler
+{
+	ports = [ports copy];
+	dispatch_semaphore_t slots = dispatch_semaphore_create(MAX(self.maximumConcurrentPortOperations, 1));
+	dispatch_group_t group = dispatch_group_create();
+	NSMutableArray *failedPorts = [NSMutableArray array];
+	
+	dispatch_queue_t queue = dispatch_queue_create("com.openreelsoftware.ORSSerialPortManager.portOperationQueue", 0);
+	dispatch_async(queue, ^{
+		for (ORSSerialPort *port in ports) {
+			dispatch_semaphore_wait(slots, DISPATCH_TIME_FOREVER);
+			dispatch_group_enter(group);
+			operation(port, ^(NSError *error) {
+				if (error) {
+					@synchronized(failedPorts) { [failedPorts addObject:port]; }
+				}
+				dispatch_semaphore_signal(slots);
+				dispatch_group_leave(group);
+			});
+		}
+		
+		dispatch_group_notify(group, dispatch_get_main_queue(), ^{
+			if (handler) handler([failedPorts copy]);
+		});
+	});
+}
+
+// Adds ports to the index of ports matching rules, for rules without a matching port already
+- (void)indexMatchingRulesForPorts:(NSArray *)ports
+{
+	@synchronized(self.matchingRulesByName) {
+		[self.matchingRulesByName enumerateKeysAndObjectsUsingBlock:^(NSString *name, ORSSerialPortMatchingRule *rule, BOOL *stop) {
+			if (self.portsByMatchingRuleName[name]) return;
+			for (ORSSerialPort *port in ports) {
+				if (![rule matchesMetadata:port.metadata]) continue;
+				self.portsByMatchingRuleName[name] = port;
+				break;
+			}
+		}];
+	}
+}
+
+// Removes ports from the index of ports matching rules, replacing them with another matching port if there is one
+- (void)removeMatchingRuleIndexesForPorts:(NSArray *)ports
+{
+	@synchronized(self.matchingRulesByName) {
+		NSArray *names = [self.portsByMatchingRuleName keysOfEntriesPassingTest:^BOOL(NSString *name, ORSSerialPort *port, BOOL *stop) {
+			return [ports containsObject:port];
+		}].allObjects;
+		[self.portsByMatchingRuleName removeObjectsForKeys:names];
+	}
+	[self indexMatchingRulesForPorts:self.availablePorts];
+}
+
 - (void)serialPortsWerePublished:(io_iterator_t)iterator;
 {
 	NSMutableArray *newlyConnectedPorts = [[NSMutableArray alloc] init];
@@ -192,6 +437,7 @@ static ORSSerialPortManager *sharedInstance = nil;
 	}
 	
 	[[self mutableArrayValueForKey:@"availablePorts"] addObjectsFromArray:newlyConnectedPorts];
+	[self indexMatchingRulesForPorts:newlyConnectedPorts];
 	
 	NSNotificationCenter *nc = [NSNotificationCenter defaultCenter];
 	NSDictionary *userInfo = @{ORSConnectedSerialPortsKey : newlyConnectedPorts};
@@ -211,6 +457,7 @@ static ORSSerialPortManager *sharedInstance = nil;
 	
 	[newlyDisconnectedPorts makeObjectsPerformSelector:@selector(cleanupAfterSystemRemoval)];
 	[[self mutableArrayValueForKey:@"availablePorts"] removeObjectsInArray:newlyDisconnectedPorts];
+	[self removeMatchingRuleIndexesForPorts:newlyDisconnectedPorts];
 	
 	NSNotificationCenter *nc = [NSNotificationCenter defaultCenter];
 	NSDictionary *userInfo = @{ORSDisconnectedSerialPortsKey : newlyDisconnectedPorts};
@@ -240,7 +487,7 @@ static ORSSerialPortManager *sharedInstance = nil;
 															&portIterator);
 	if (result)
 	{
-		LOG_SERIAL_PORT_ERROR(@"Error getting serialPort list:%i", result);
+		ORS_LOG_SERIAL_PORT_ERROR(ORSSerialErrorLogOperationPortDiscovery, nil, result);
 		if (portIterator) IOObjectRelease(portIterator);
 		CFRelease(matchingDict); // Above call to IOServiceAddMatchingNotification consumes one reference, but we added a retain for the below call
 		return;
@@ -273,7 +520,7 @@ static ORSSerialPortManager *sharedInstance = nil;
 											  &portIterator);
 	if (result)
 	{
-		LOG_SERIAL_PORT_ERROR(@"Error registering for serial port termination notification:%i.", result);
+		ORS_LOG_SERIAL_PORT_ERROR(ORSSerialErrorLogOperationPortDiscovery, nil, result);
 		if (portIterator) IOObjectRelease(portIterator);
 		return;
 	}
@@ -348,3 +595,14 @@ void ORSSerialPortManagerPortsTerminatedNotificationCallback(void *refCon, io_it
 	}
 	[manager serialPortsWereTerminated:iterator];
 }
+
+void ORSSerialPortManagerSystemPowerCallback(void *refCon, io_service_t service, natural_t messageType, void *messageArgument)
+{
+	ORSSerialPortManager *manager = (__bridge ORSSerialPortManager *)refCon;
+	if (![manager isKindOfClass:[ORSSerialPortManager class]])
+	{
+		NSLog(@"Unexpected context object %@ in %s. Context object should be an instance of ORSSerialPortManager", manager, __PRETTY_FUNCTION__);
+		return;
+	}
+	[manager systemPowerStateWillChange:messageType argument:messageArgument];
+}
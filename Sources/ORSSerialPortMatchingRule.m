@@ -0,0 +1,80 @@
+//
+//  ORSSerialPortMatchingRule.m
+//  ORSSerialPort
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 Open Reel Software. All rights reserved.
+//
+//	Permission is hereby granted, free of charge, to any person obtaining a
+//	copy of this software and associated documentation files (the
+//	"Software"), to deal in the Software without restriction, including
+//	without limitation the rights to use, copy, modify, merge, publish,
+//	distribute, sublicense, and/or sell copies of the Software, and to
+//	permit persons to whom the Software is furnished to do so, subject to
+//	the following conditions:
+//
+//	The above copyright notice and this permission notice shall be included
+//	in all copies or substantial portions of the Software.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+//	OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//	CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//	TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//	SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#import "ORSSerial/ORSSerialPortMatchingRule.h"
+#import "ORSSerial/ORSSerialPortMetadata.h"
+
+@implementation ORSSerialPortMatchingRule
+
++ (instancetype)ruleWithName:(NSString *)name
+					vendorID:(NSNumber *)vendorID
+				   productID:(NSNumber *)productID
+				serialNumber:(NSString *)serialNumber
+				  locationID:(NSNumber *)locationID
+{
+	return [[self alloc] initWithName:name vendorID:vendorID productID:productID serialNumber:serialNumber locationID:locationID];
+}
+
+- (instancetype)init NS_UNAVAILABLE
+{
+	[NSException raise:NSInternalInconsistencyException format:@"You must initialize %@ with -initWithName:vendorID:productID:serialNumber:locationID:", NSStringFromClass([self class])];
+	return nil;
+}
+
+- (instancetype)initWithName:(NSString *)name
+					vendorID:(NSNumber *)vendorID
+				   productID:(NSNumber *)productID
+				serialNumber:(NSString *)serialNumber
+				  locationID:(NSNumber *)locationID
+{
+	self = [super init];
+	if (self) {
+		_name = [name copy];
+		_vendorID = vendorID;
+		_productID = productID;
+		_serialNumber = [serialNumber copy];
+		_locationID = locationID;
+	}
+	return self;
+}
+
+- (BOOL)matchesMetadata:(ORSSerialPortMetadata *)metadata
+{
+	if (!metadata) return NO;
+	if (self.vendorID && ![self.vendorID isEqual:metadata.vendorID]) return NO;
+	if (self.productID && ![self.productID isEqual:metadata.productID]) return NO;
+	if (self.serialNumber && ![self.serialNumber isEqual:metadata.serialNumber]) return NO;
+	if (self.locationID && ![self.locationID isEqual:metadata.locationID]) return NO;
+	return YES;
+}
+
+- (NSString *)description
+{
+	return [NSString stringWithFormat:@"%@ %@ vendor ID: %@ product ID: %@ serial number: %@ location ID: %@", [super description],
+			self.name, self.vendorID, self.productID, self.serialNumber, self.locationID];
+}
+
+@end
@@ -0,0 +1,93 @@
+//
+//  ORSSerialPortMetadata.m
+//  ORSSerialPort
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 Open Reel Software. All rights reserved.
+//
+//	Permission is hereby granted, free of charge, to any person obtaining a
+//	copy of this software and associated documentation files (the
+//	"Software"), to deal in the Software without restriction, including
+//	without limitation the rights to use, copy, modify, merge, publish,
+//	distribute, sublicense, and/or sell copies of the Software, and to
+//	permit persons to whom the Software is furnished to do so, subject to
+//	the following conditions:
+//
+//	The above copyright notice and this permission notice shall be included
+//	in all copies or substantial portions of the Software.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+//	OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//	CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//	TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//	SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#import "ORSSerial/ORSSerialPortMetadata.h"
+#import "ORSSerialPortDiscovery.h"
+#import <IOKit/IOKitLib.h>
+#import <IOKit/serial/IOSerialKeys.h>
+
+@implementation ORSSerialPortMetadata
+
+- (instancetype)initWithDevice:(io_object_t)device
+{
+	// Ports without a real device, e.g. pseudo terminals, have no registry entry and so no metadata
+	uint64_t registryEntryID = 0;
+	if (!device || IORegistryEntryGetRegistryEntryID(device, &registryEntryID) != KERN_SUCCESS) return nil;
+	
+	self = [super init];
+	if (self) {
+		_name = [[self class] propertyOfDevice:device forKey:@kIOTTYDeviceKey searchingParents:NO];
+		_path = [[self class] propertyOfDevice:device forKey:@kIOCalloutDeviceKey searchingParents:NO];
+		
+		// USB properties are on the USB device, further up the registry
+		_vendorID = [[self class] propertyOfDevice:device forKey:@"idVendor" searchingParents:YES];
+		_productID = [[self class] propertyOfDevice:device forKey:@"idProduct" searchingParents:YES];
+		_serialNumber = [[self class] propertyOfDevice:device forKey:@"USB Serial Number" searchingParents:YES];
+		_locationID = [[self class] propertyOfDevice:device forKey:@"locationID" searchingParents:YES];
+		
+		io_registry_entry_t driver = 0;
+		if (IORegistryEntryGetParentEntry(device, kIOServicePlane, &driver) == KERN_SUCCESS) {
+			io_name_t className;
+			if (IOObjectGetClass(driver, className) == KERN_SUCCESS) _driverName = @(className);
+			IOObjectRelease(driver);
+		}
+		
+		_registryEntryID = registryEntryID;
+	}
+	return self;
+}
+
+- (instancetype)initWithVendorID:(NSNumber *)vendorID
+					   productID:(NSNumber *)productID
+					serialNumber:(NSString *)serialNumber
+					  locationID:(NSNumber *)locationID
+{
+	self = [super init];
+	if (self) {
+		_vendorID = vendorID;
+		_productID = productID;
+		_serialNumber = [serialNumber copy];
+		_locationID = locationID;
+	}
+	return self;
+}
+
+- (NSString *)description
+{
+	return [NSString stringWithFormat:@"%@ path: %@ vendor ID: %@ product ID: %@ serial number: %@ location ID: %@ driver: %@", [super description],
+			self.path, self.vendorID, self.productID, self.serialNumber, self.locationID, self.driverName];
+}
+
+#pragma mark - Private
+
++ (id)propertyOfDevice:(io_object_t)device forKey:(NSString *)key searchingParents:(BOOL)searchParents
+{
+	IOOptionBits options = searchParents ? (kIORegistryIterateRecursively | kIORegistryIterateParents) : 0;
+	CFTypeRef property = IORegistryEntrySearchCFProperty(device, kIOServicePlane, (__bridge CFStringRef)key, kCFAllocatorDefault, options);
+	return (__bridge_transfer id)property;
+}
+
+@end
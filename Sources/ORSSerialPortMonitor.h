@@ -0,0 +1,52 @@
+//
+//  ORSSerialPortMonitor.h
+//  ORSSerialPort
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 Open Reel Software. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+#ifdef SWIFTPM
+#import "ORSSerial/ORSSerialPort.h"
+#else
+#import <ORSSerial/ORSSerialPort.h>
+#endif
+
+// How often receive backlogs and transmit queue lengths are sampled
+static const NSTimeInterval ORSSerialPortMonitorInterval = 0.25;
+
+// Bounds for the adaptive modem line polling interval of ports that conserve idle wakeups
+static const NSTimeInterval ORSSerialPortMinimumModemLinePollInterval = 0.01;
+static const NSTimeInterval ORSSerialPortMaximumModemLinePollInterval = 0.5;
+
+/**
+ *  Periodically samples the state of open ports from a single shared timer, rather
+ *  than one timer per port. Ports are held weakly, and the timer only runs while at
+ *  least one port is being monitored. The timer fires at the shortest interval any
+ *  port asks for, with leeway of half the interval so the system can coalesce it
+ *  with other wakeups.
+ */
+@interface ORSSerialPortMonitor : NSObject
+
++ (ORSSerialPortMonitor *)sharedMonitor;
+
+- (void)addPort:(ORSSerialPort *)port;
+- (void)removePort:(ORSSerialPort *)port;
+
+// Call when a monitored port's monitorInterval gets shorter, so the timer fires soon enough
+- (void)portMonitorIntervalDidChange:(ORSSerialPort *)port;
+
+@end
+
+@interface ORSSerialPort (ORSSerialPortMonitor)
+
+// Called on the monitor's queue each time the shared timer fires. May be called more often
+// than monitorInterval when other ports need shorter intervals.
+- (void)monitorDidFire;
+
+// How often the port needs monitorDidFire to be called. Called on the monitor's queue.
+- (NSTimeInterval)monitorInterval;
+
+@end
@@ -0,0 +1,103 @@
+//
+//  ORSSerialPortMonitor.m
+//  ORSSerialPort
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 Open Reel Software. All rights reserved.
+//
+
+#import "ORSSerialPortMonitor.h"
+
+@interface ORSSerialPortMonitor ()
+
+@property (nonatomic, strong) NSHashTable *ports; // Only used on queue
+@property (nonatomic, strong) dispatch_queue_t queue;
+@property (nonatomic, strong) dispatch_source_t timer;
+@property (nonatomic) NSTimeInterval interval; // Only used on queue
+
+@end
+
+@implementation ORSSerialPortMonitor
+
++ (ORSSerialPortMonitor *)sharedMonitor
+{
+	static ORSSerialPortMonitor *sharedMonitor = nil;
+	static dispatch_once_t onceToken;
+	dispatch_once(&onceToken, ^{ sharedMonitor = [[self alloc] init]; });
+	return sharedMonitor;
+}
+
+- (instancetype)init
+{
+	self = [super init];
+	if (self) {
+		_ports = [NSHashTable weakObjectsHashTable];
+		_queue = dispatch_queue_create("com.openreelsoftware.ORSSerialPortMonitor", 0);
+	}
+	return self;
+}
+
+- (void)addPort:(ORSSerialPort *)port
+{
+	dispatch_async(self.queue, ^{
+		[self.ports addObject:port];
+		[self updateTimer];
+	});
+}
+
+- (void)removePort:(ORSSerialPort *)port
+{
+	dispatch_async(self.queue, ^{
+		[self.ports removeObject:port];
+		if ([self.ports count]) {
+			[self updateTimer];
+			return;
+		}
+		
+		if (self.timer) dispatch_source_cancel(self.timer);
+		self.timer = nil;
+	});
+}
+
+- (void)portMonitorIntervalDidChange:(ORSSerialPort *)port
+{
+	dispatch_async(self.queue, ^{
+		if ([self.ports containsObject:port]) [self updateTimer];
+	});
+}
+
+// Only called on queue
+- (void)updateTimer
+{
+	NSTimeInterval interval = DBL_MAX;
+	for (ORSSerialPort *port in self.ports) interval = MIN(interval, [port monitorInterval]);
+	if (interval == DBL_MAX) interval = ORSSerialPortMonitorInterval;
+	if (self.timer && interval == self.interval) return;
+	
+	if (!self.timer) {
+		dispatch_source_t timer = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, self.queue);
+		dispatch_source_set_event_handler(timer, ^{ [self timerDidFire]; });
+		dispatch_resume(timer);
+		self.timer = timer;
+	}
+	
+	uint64_t nanoseconds = (uint64_t)(interval * NSEC_PER_SEC);
+	dispatch_source_set_timer(self.timer, dispatch_time(DISPATCH_TIME_NOW, nanoseconds), nanoseconds, nanoseconds / 2);
+	self.interval = interval;
+}
+
+- (void)timerDidFire
+{
+	NSArray *ports = [self.ports allObjects];
+	if (![ports count]) {
+		// All ports were deallocated without being removed
+		dispatch_source_cancel(self.timer);
+		self.timer = nil;
+		return;
+	}
+	
+	for (ORSSerialPort *port in ports) [port monitorDidFire];
+	[self updateTimer];
+}
+
+@end
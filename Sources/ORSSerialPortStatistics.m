@@ -0,0 +1,81 @@
+//
+//  ORSSerialPortStatistics.m
+//  ORSSerialPort
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 Open Reel Software. All rights reserved.
+//
+//	Permission is hereby granted, free of charge, to any person obtaining a
+//	copy of this software and associated documentation files (the
+//	"Software"), to deal in the Software without restriction, including
+//	without limitation the rights to use, copy, modify, merge, publish,
+//	distribute, sublicense, and/or sell copies of the Software, and to
+//	permit persons to whom the Software is furnished to do so, subject to
+//	the following conditions:
+//
+//	The above copyright notice and this permission notice shall be included
+//	in all copies or substantial portions of the Software.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+//	OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//	CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//	TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//	SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#import "ORSSerial/ORSSerialPortStatistics.h"
+#import "ORSSerialPortCounters.h"
+
+@implementation ORSSerialPortStatistics
+
+- (instancetype)initWithCounters:(ORSSerialPortCounters)counters
+{
+	self = [super init];
+	if (self) {
+		_receivedByteCount = counters.receivedByteCount;
+		_receiveErrorCount = counters.receiveErrorCount;
+		_breakCount = counters.breakCount;
+		_receiveBacklogWarningCount = counters.receiveBacklogWarningCount;
+		_receiveBacklog = counters.receiveBacklog;
+		_maximumReceiveBacklog = counters.maximumReceiveBacklog;
+		_sentByteCount = counters.sentByteCount;
+		_transmitQueueLength = counters.transmitQueueLength;
+		_maximumTransmitQueueLength = counters.maximumTransmitQueueLength;
+		_echoedByteCount = counters.echoedByteCount;
+		_echoMismatchCount = counters.echoMismatchCount;
+		_missingEchoByteCount = counters.missingEchoByteCount;
+		_discardedFrameCount = counters.discardedFrameCount;
+	}
+	return self;
+}
+
+- (ORSSerialPortStatistics *)statisticsBySubtractingStatistics:(ORSSerialPortStatistics *)statistics
+{
+	ORSSerialPortCounters counters = {0};
+	counters.receivedByteCount = self.receivedByteCount - statistics.receivedByteCount;
+	counters.receiveErrorCount = self.receiveErrorCount - statistics.receiveErrorCount;
+	counters.breakCount = self.breakCount - statistics.breakCount;
+	counters.receiveBacklogWarningCount = self.receiveBacklogWarningCount - statistics.receiveBacklogWarningCount;
+	counters.receiveBacklog = self.receiveBacklog;
+	counters.maximumReceiveBacklog = self.maximumReceiveBacklog;
+	counters.sentByteCount = self.sentByteCount - statistics.sentByteCount;
+	counters.transmitQueueLength = self.transmitQueueLength;
+	counters.maximumTransmitQueueLength = self.maximumTransmitQueueLength;
+	counters.echoedByteCount = self.echoedByteCount - statistics.echoedByteCount;
+	counters.echoMismatchCount = self.echoMismatchCount - statistics.echoMismatchCount;
+	counters.missingEchoByteCount = self.missingEchoByteCount - statistics.missingEchoByteCount;
+	counters.discardedFrameCount = self.discardedFrameCount - statistics.discardedFrameCount;
+	return [[ORSSerialPortStatistics alloc] initWithCounters:counters];
+}
+
+- (NSString *)description
+{
+	return [NSString stringWithFormat:@"%@ received: %llu errors: %llu breaks: %llu backlog: %lu (max %lu, %llu warnings) sent: %llu queued: %lu (max %lu) echoed: %llu (%llu mismatched, %llu missing) discarded frames: %llu", [super description],
+			self.receivedByteCount, self.receiveErrorCount, self.breakCount,
+			(unsigned long)self.receiveBacklog, (unsigned long)self.maximumReceiveBacklog, self.receiveBacklogWarningCount,
+			self.sentByteCount, (unsigned long)self.transmitQueueLength, (unsigned long)self.maximumTransmitQueueLength,
+			self.echoedByteCount, self.echoMismatchCount, self.missingEchoByteCount, self.discardedFrameCount];
+}
+
+@end
@@ -0,0 +1,223 @@
+//
+//  ORSSerialPortTraceRecorder.m
+//  ORSSerialPort
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 Open Reel Software. All rights reserved.
+//
+//	Permission is hereby granted, free of charge, to any person obtaining a
+//	copy of this software and associated documentation files (the
+//	"Software"), to deal in the Software without restriction, including
+//	without limitation the rights to use, copy, modify, merge, publish,
+//	distribute, sublicense, and/or sell copies of the Software, and to
+//	permit persons to whom the Software is furnished to do so, subject to
+//	the following conditions:
+//
+//	The above copyright notice and this permission notice shall be included
+//	in all copies or substantial portions of the Software.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+//	OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//	CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//	TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//	SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#import "ORSSerial/ORSSerialPortTraceRecorder.h"
+#import "ORSSerial/ORSSerialPort.h"
+#import "ORSSerialPortTracing.h"
+#import <mach/mach_time.h>
+
+#ifndef ORS_SERIAL_PORT_DISABLE_TRACEPOINTS
+volatile BOOL ORSSerialPortTraceRecorderIsRecording = NO;
+#endif
+
+static const NSUInteger ORSSerialPortTraceRecorderDefaultMaximumEventCount = 1000000;
+
+static ORSSerialPortTraceRecorder *sharedInstance = nil;
+
+@interface ORSSerialPortTraceRecorder ()
+
+@property (nonatomic, strong) dispatch_queue_t recordingQueue;
+
+// Only used on recordingQueue
+@property (nonatomic, strong) NSMutableArray *events;
+@property (nonatomic, strong) NSMutableDictionary *processIDsByPortPath;
+@property (nonatomic, strong) NSMutableDictionary *threadIDsByObjectKey; // Keyed by process ID and object address
+@property (nonatomic) uint64_t startTime;
+@property (nonatomic, readwrite) NSUInteger droppedEventCount;
+
+@end
+
+@implementation ORSSerialPortTraceRecorder
+
+#pragma mark - Singleton Methods
+
++ (ORSSerialPortTraceRecorder *)sharedTraceRecorder
+{
+	static dispatch_once_t onceToken;
+	dispatch_once(&onceToken, ^{
+		sharedInstance = [[self alloc] init];
+	});
+	return sharedInstance;
+}
+
+- (instancetype)init
+{
+	self = [super init];
+	if (self) {
+		_recordingQueue = dispatch_queue_create("com.openreelsoftware.ORSSerialPortTraceRecorder.recordingQueue", 0);
+		_maximumEventCount = ORSSerialPortTraceRecorderDefaultMaximumEventCount;
+	}
+	return self;
+}
+
+#pragma mark - Public Methods
+
+- (void)startRecording
+{
+#ifndef ORS_SERIAL_PORT_DISABLE_TRACEPOINTS
+	dispatch_sync(self.recordingQueue, ^{
+		if (ORSSerialPortTraceRecorderIsRecording) return;
+		self.events = [NSMutableArray array];
+		self.processIDsByPortPath = [NSMutableDictionary dictionary];
+		self.threadIDsByObjectKey = [NSMutableDictionary dictionary];
+		self.droppedEventCount = 0;
+		self.startTime = mach_absolute_time();
+		ORSSerialPortTraceRecorderIsRecording = YES;
+	});
+#endif
+}
+
+- (NSData *)stopRecording
+{
+	__block NSArray *events = nil;
+	__block NSUInteger droppedEventCount = 0;
+	dispatch_sync(self.recordingQueue, ^{
+		if (!self.events) return;
+#ifndef ORS_SERIAL_PORT_DISABLE_TRACEPOINTS
+		ORSSerialPortTraceRecorderIsRecording = NO;
+#endif
+		events = self.events;
+		droppedEventCount = self.droppedEventCount;
+		self.events = nil;
+		self.processIDsByPortPath = nil;
+		self.threadIDsByObjectKey = nil;
+	});
+	if (!events) return nil;
+	
+	NSDictionary *trace = @{@"traceEvents": events,
+							@"displayTimeUnit": @"ms",
+							@"metadata": @{@"droppedEventCount": @(droppedEventCount)}};
+	return [NSJSONSerialization dataWithJSONObject:trace options:0 error:NULL];
+}
+
+- (BOOL)stopRecordingAndWriteToURL:(NSURL *)url error:(NSError **)error
+{
+	NSData *trace = [self stopRecording];
+	if (!trace) return NO;
+	return [trace writeToURL:url options:NSDataWritingAtomic error:error];
+}
+
+#pragma mark - Private Methods
+
+// Must only be called on recordingQueue
+- (NSNumber *)processIDForPortPath:(NSString *)path
+{
+	NSNumber *processID = self.processIDsByPortPath[path];
+	if (processID) return processID;
+	
+	processID = @([self.processIDsByPortPath count] + 1);
+	self.processIDsByPortPath[path] = processID;
+	[self.events addObject:@{@"name": @"process_name", @"ph": @"M", @"pid": processID, @"args": @{@"name": path}}];
+	return processID;
+}
+
+// Must only be called on recordingQueue. Each object's events are shown on their own row, named for the first of them.
+- (NSNumber *)threadIDForObjectAddress:(uintptr_t)address isPort:(BOOL)isPort processID:(NSNumber *)processID name:(NSString *)name
+{
+	NSString *key = [NSString stringWithFormat:@"%@ %lx", processID, (unsigned long)address];
+	NSNumber *threadID = self.threadIDsByObjectKey[key];
+	if (threadID) return threadID;
+	
+	threadID = @([self.threadIDsByObjectKey count] + 1);
+	self.threadIDsByObjectKey[key] = threadID;
+	NSString *threadName = isPort ? @"Port" : [NSString stringWithFormat:@"%@ %#lx", name, (unsigned long)address];
+	[self.events addObject:@{@"name": @"thread_name", @"ph": @"M", @"pid": processID, @"tid": threadID, @"args": @{@"name": threadName}}];
+	[self.events addObject:@{@"name": @"thread_sort_index", @"ph": @"M", @"pid": processID, @"tid": threadID, @"args": @{@"sort_index": threadID}}];
+	return threadID;
+}
+
+// Must only be called on recordingQueue
+- (void)recordEventWithPortPath:(NSString *)path
+						  phase:(ORSSerialPortTracePhase)phase
+				  objectAddress:(uintptr_t)address
+						 isPort:(BOOL)isPort
+						   name:(NSString *)name
+						message:(NSString *)message
+						  value:(long long)value
+					  timestamp:(uint64_t)timestamp
+{
+	if (!self.events || timestamp < self.startTime) return; // Not from the current recording
+	if ([self.events count] >= self.maximumEventCount) {
+		self.droppedEventCount++;
+		return;
+	}
+	
+	static mach_timebase_info_data_t timebase;
+	if (timebase.denom == 0) mach_timebase_info(&timebase);
+	double microseconds = (double)(timestamp - self.startTime) * timebase.numer / timebase.denom / 1000.0;
+	
+	NSNumber *processID = [self processIDForPortPath:path ?: @"Unknown Port"];
+	NSMutableDictionary *event = [@{@"name": name, @"ph": [NSString stringWithFormat:@"%c", phase], @"ts": @(microseconds), @"pid": processID} mutableCopy];
+	switch (phase) {
+		case ORSSerialPortTracePhaseEvent:
+			event[@"s"] = @"t";
+			event[@"tid"] = [self threadIDForObjectAddress:address isPort:isPort processID:processID name:name];
+			event[@"args"] = @{@"message": message ?: @""};
+			break;
+		case ORSSerialPortTracePhaseIntervalBegin:
+		case ORSSerialPortTracePhaseIntervalEnd:
+			event[@"cat"] = @"ORSSerialPort";
+			event[@"id"] = [NSString stringWithFormat:@"%#lx", (unsigned long)address];
+			event[@"tid"] = @0;
+			event[@"args"] = @{@"message": message ?: @""};
+			break;
+		case ORSSerialPortTracePhaseCounter:
+			event[@"args"] = @{name: @(value)};
+			break;
+	}
+	[self.events addObject:event];
+}
+
+#pragma mark - Properties
+
+- (BOOL)isRecording
+{
+#ifndef ORS_SERIAL_PORT_DISABLE_TRACEPOINTS
+	return ORSSerialPortTraceRecorderIsRecording;
+#else
+	return NO;
+#endif
+}
+
+@end
+
+#ifndef ORS_SERIAL_PORT_DISABLE_TRACEPOINTS
+
+void ORSSerialPortTraceRecorderRecord(ORSSerialPort *port, ORSSerialPortTracePhase phase, id object, NSString *name, NSString *message, long long value)
+{
+	// Take the time now, and only the object's address, so recording doesn't delay or keep objects alive
+	uint64_t timestamp = mach_absolute_time();
+	uintptr_t address = (uintptr_t)(__bridge void *)object;
+	BOOL isPort = (object == port);
+	NSString *path = port.path;
+	
+	ORSSerialPortTraceRecorder *recorder = [ORSSerialPortTraceRecorder sharedTraceRecorder];
+	dispatch_async(recorder.recordingQueue, ^{
+		[recorder recordEventWithPortPath:path phase:phase objectAddress:address isPort:isPort name:name message:message value:value timestamp:timestamp];
+	});
+}
+
+#endif
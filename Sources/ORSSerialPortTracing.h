@@ -0,0 +1,108 @@
+//
+//  ORSSerialPortTracing.h
+//  ORSSerialPort
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 Open Reel Software. All rights reserved.
+//
+
+// Tracepoints for the serial I/O pipeline, recorded with os_signpost so they show up in
+// Instruments' os_signpost instrument and in `log stream --signpost`, and by
+// ORSSerialPortTraceRecorder while it's recording. They cost a couple of checks when nothing
+// is recording. Define ORS_SERIAL_PORT_DISABLE_TRACEPOINTS to compile them out entirely.
+// Signposts are also compiled out with SDKs older than 10.14, and are skipped at runtime
+// on older systems.
+//
+// Events and intervals are identified by an object, so those for the same port, request or
+// packet descriptor are grouped together. name and format must be string literals.
+
+#import <Foundation/Foundation.h>
+
+@class ORSSerialPort;
+
+// Chrome trace event phases
+typedef NS_ENUM(char, ORSSerialPortTracePhase) {
+	ORSSerialPortTracePhaseEvent = 'i',
+	ORSSerialPortTracePhaseIntervalBegin = 'b',
+	ORSSerialPortTracePhaseIntervalEnd = 'e',
+	ORSSerialPortTracePhaseCounter = 'C',
+};
+
+#ifndef ORS_SERIAL_PORT_DISABLE_TRACEPOINTS
+
+extern volatile BOOL ORSSerialPortTraceRecorderIsRecording;
+
+// Implemented in ORSSerialPortTraceRecorder.m. Only call while ORSSerialPortTraceRecorderIsRecording is YES.
+void ORSSerialPortTraceRecorderRecord(ORSSerialPort *port, ORSSerialPortTracePhase phase, id object, NSString *name, NSString *message, long long value);
+
+#define ORS_TRACE_RECORD(port, phase, object, name, value, format, ...) \
+	do { \
+		if (ORSSerialPortTraceRecorderIsRecording) { \
+			ORSSerialPortTraceRecorderRecord(port, phase, object, @name, [NSString stringWithFormat:@format, ##__VA_ARGS__], value); \
+		} \
+	} while (0)
+
+#if __has_include(<os/signpost.h>)
+
+#import <os/signpost.h>
+
+API_AVAILABLE(macos(10.14))
+static inline os_log_t ORSSerialPortTraceLog(void)
+{
+	static os_log_t log;
+	static dispatch_once_t onceToken;
+	dispatch_once(&onceToken, ^{
+		log = os_log_create("com.openreelsoftware.ORSSerialPort", "Serial I/O");
+	});
+	return log;
+}
+
+#define ORS_TRACE_SIGNPOST(signpostFunction, object, name, format, ...) \
+	do { \
+		if (@available(macOS 10.14, *)) { \
+			os_log_t ors_trace_log = ORSSerialPortTraceLog(); \
+			if (os_signpost_enabled(ors_trace_log)) { \
+				signpostFunction(ors_trace_log, os_signpost_id_make_with_pointer(ors_trace_log, (__bridge const void *)(object)), name, format, ##__VA_ARGS__); \
+			} \
+		} \
+	} while (0)
+
+#else
+
+#define ORS_TRACE_SIGNPOST(signpostFunction, object, name, format, ...) do {} while (0)
+
+#endif
+
+#define ORS_TRACE_EVENT(port, object, name, format, ...) \
+	do { \
+		ORS_TRACE_SIGNPOST(os_signpost_event_emit, object, name, format, ##__VA_ARGS__); \
+		ORS_TRACE_RECORD(port, ORSSerialPortTracePhaseEvent, object, name, 0, format, ##__VA_ARGS__); \
+	} while (0)
+#define ORS_TRACE_INTERVAL_BEGIN(port, object, name, format, ...) \
+	do { \
+		ORS_TRACE_SIGNPOST(os_signpost_interval_begin, object, name, format, ##__VA_ARGS__); \
+		ORS_TRACE_RECORD(port, ORSSerialPortTracePhaseIntervalBegin, object, name, 0, format, ##__VA_ARGS__); \
+	} while (0)
+#define ORS_TRACE_INTERVAL_END(port, object, name, format, ...) \
+	do { \
+		ORS_TRACE_SIGNPOST(os_signpost_interval_end, object, name, format, ##__VA_ARGS__); \
+		ORS_TRACE_RECORD(port, ORSSerialPortTracePhaseIntervalEnd, object, name, 0, format, ##__VA_ARGS__); \
+	} while (0)
+// A value, like a queue length, that's graphed over time
+#define ORS_TRACE_COUNTER(port, name, value) \
+	do { \
+		long long ors_trace_value = (long long)(value); \
+		ORS_TRACE_SIGNPOST(os_signpost_event_emit, port, name, "%lld", ors_trace_value); \
+		if (ORSSerialPortTraceRecorderIsRecording) { \
+			ORSSerialPortTraceRecorderRecord(port, ORSSerialPortTracePhaseCounter, port, @name, nil, ors_trace_value); \
+		} \
+	} while (0)
+
+#else
+
+#define ORS_TRACE_EVENT(port, object, name, format, ...) do {} while (0)
+#define ORS_TRACE_INTERVAL_BEGIN(port, object, name, format, ...) do {} while (0)
+#define ORS_TRACE_INTERVAL_END(port, object, name, format, ...) do {} while (0)
+#define ORS_TRACE_COUNTER(port, name, value) do {} while (0)
+
+#endif
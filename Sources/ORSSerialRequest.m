@@ -34,6 +34,7 @@
 @property (nonatomic, readwrite) NSTimeInterval timeoutInterval;
 @property (nonatomic, strong) ORSSerialPacketDescriptor *responseDescriptor;
 @property (nonatomic, strong, readwrite) NSString *UUIDString;
+@property (nonatomic, readwrite) NSUInteger messageType;
 
 @end
 
@@ -47,10 +48,28 @@
 	return [[self alloc] initWithDataToSend:dataToSend userInfo:userInfo timeoutInterval:timeout responseDescriptor:responseDescriptor];
 }
 
++ (instancetype)requestWithDataToSend:(NSData *)dataToSend
+							 userInfo:(id)userInfo
+					  timeoutInterval:(NSTimeInterval)timeout
+					responseDescriptor:(ORSSerialPacketDescriptor *)responseDescriptor
+						  messageType:(NSUInteger)messageType
+{
+	return [[self alloc] initWithDataToSend:dataToSend userInfo:userInfo timeoutInterval:timeout responseDescriptor:responseDescriptor messageType:messageType];
+}
+
 - (instancetype)initWithDataToSend:(NSData *)dataToSend
 									userInfo:(id)userInfo
 							 timeoutInterval:(NSTimeInterval)timeout
 						  responseDescriptor:(ORSSerialPacketDescriptor *)responseDescriptor
+{
+	return [self initWithDataToSend:dataToSend userInfo:userInfo timeoutInterval:timeout responseDescriptor:responseDescriptor messageType:0];
+}
+
+- (instancetype)initWithDataToSend:(NSData *)dataToSend
+						  userInfo:(id)userInfo
+				   timeoutInterval:(NSTimeInterval)timeout
+				 responseDescriptor:(ORSSerialPacketDescriptor *)responseDescriptor
+					   messageType:(NSUInteger)messageType
 {
 	self = [super init];
 	if (self) {
@@ -58,6 +77,7 @@
 		_userInfo = userInfo;
 		_timeoutInterval = timeout;
 		_responseDescriptor = responseDescriptor;
+		_messageType = messageType;
 		CFUUIDRef uuid = CFUUIDCreate(kCFAllocatorDefault);
 		_UUIDString = CFBridgingRelease(CFUUIDCreateString(kCFAllocatorDefault, uuid));
 		CFRelease(uuid);
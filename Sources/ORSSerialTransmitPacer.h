@@ -0,0 +1,57 @@
+//
+//  ORSSerialTransmitPacer.h
+//  ORSSerialPort
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 Open Reel Software. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+// Tokens accumulate for at most this long, limiting the size of a burst after an idle period
+static const NSTimeInterval ORSSerialTransmitPacerBurstInterval = 0.01;
+
+// Writes bytes to the port. Returns NO if writing failed.
+typedef BOOL(^ORSSerialTransmitPacerWriter)(const uint8_t *bytes, NSUInteger length);
+
+// Enables (YES) or disables (NO) the transmitter of a half-duplex link
+typedef void(^ORSSerialTransmitPacerTurnaroundHandler)(BOOL transmitterEnabled);
+
+/**
+ *  Limits the rate at which queued data is written, using a token bucket.
+ *
+ *  Tokens accumulate at bytesPerSecond, up to a burst of ORSSerialTransmitPacerBurstInterval's
+ *  worth of bytes, and each byte written uses one. When there aren't enough tokens, or a frame
+ *  has to wait for interFrameGap after the previous one, writing resumes from a timer. No thread
+ *  ever sleeps waiting for tokens.
+ *
+ *  Each enqueued NSData is a frame. Frames are written in order, on the pacer's own serial queue.
+ *
+ *  For half-duplex links, set turnaroundHandler. It's called with YES turnaroundLeadTime before
+ *  the first byte of each frame is written. After the last byte, drainHandler is called to
+ *  wait for the frame to actually be transmitted, then turnaroundHandler is called with NO
+ *  turnaroundTrailTime later.
+ */
+@interface ORSSerialTransmitPacer : NSObject
+
+- (instancetype)initWithWriter:(ORSSerialTransmitPacerWriter)writer NS_DESIGNATED_INITIALIZER;
+
+/**
+ *  Queues data to be written. handler, if not nil, is called on the pacer's queue once the
+ *  last byte of data has been written, or writing it failed or was cancelled.
+ */
+- (void)enqueueData:(NSData *)data completionHandler:(void(^)(BOOL success))handler;
+
+// Discards all queued data, calling each frame's completion handler with NO
+- (void)cancelQueuedData;
+
+@property (atomic) double bytesPerSecond; // 0 for no rate limit
+@property (atomic) NSTimeInterval interFrameGap; // Minimum time between the last byte of one frame and the first of the next
+@property (atomic, readonly) NSUInteger queuedByteCount;
+
+@property (atomic, copy) ORSSerialTransmitPacerTurnaroundHandler turnaroundHandler;
+@property (atomic, copy) void(^drainHandler)(void); // Waits until written bytes have been transmitted
+@property (atomic) NSTimeInterval turnaroundLeadTime;
+@property (atomic) NSTimeInterval turnaroundTrailTime;
+
+@end
@@ -0,0 +1,199 @@
+//
+//  ORSSerialTransmitPacer.m
+//  ORSSerialPort
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 Open Reel Software. All rights reserved.
+//
+
+#import "ORSSerialTransmitPacer.h"
+
+@interface ORSSerialTransmitPacerFrame : NSObject
+
+@property (nonatomic, strong) NSData *data;
+@property (nonatomic) NSUInteger offset; // Number of bytes already written
+@property (nonatomic, copy) void(^completionHandler)(BOOL success);
+
+@end
+
+@implementation ORSSerialTransmitPacerFrame
+@end
+
+@interface ORSSerialTransmitPacer ()
+
+@property (nonatomic, copy) ORSSerialTransmitPacerWriter writer;
+
+// Only used on queue
+@property (nonatomic, strong) dispatch_queue_t queue;
+@property (nonatomic, strong) dispatch_source_t timer;
+@property (nonatomic, strong) NSMutableArray *frames;
+@property (nonatomic) double tokens;
+@property (nonatomic) NSTimeInterval lastRefillTime;
+@property (nonatomic) NSTimeInterval nextFrameTime; // Earliest time the next frame may start
+@property (nonatomic) BOOL transmitterEnabled;
+@property (nonatomic) NSTimeInterval transmitterReadyTime; // Earliest time a byte may be written after enabling the transmitter
+@property (nonatomic) BOOL transmitterReleasePending;
+@property (nonatomic) NSTimeInterval transmitterReleaseTime;
+
+@end
+
+@implementation ORSSerialTransmitPacer
+{
+	NSUInteger _queuedByteCount; // Guarded by @synchronized(self)
+}
+
+- (instancetype)init NS_UNAVAILABLE
+{
+	[NSException raise:NSInternalInconsistencyException format:@"You must initialize %@ with -initWithWriter:", NSStringFromClass([self class])];
+	return nil;
+}
+
+- (instancetype)initWithWriter:(ORSSerialTransmitPacerWriter)writer
+{
+	self = [super init];
+	if (self) {
+		_writer = [writer copy];
+		_frames = [NSMutableArray array];
+		_queue = dispatch_queue_create("com.openreelsoftware.ORSSerialTransmitPacer", 0);
+		_timer = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, _queue);
+		__weak typeof(self) weakSelf = self;
+		dispatch_source_set_event_handler(_timer, ^{ [weakSelf writeQueuedData]; });
+		dispatch_source_set_timer(_timer, DISPATCH_TIME_FOREVER, DISPATCH_TIME_FOREVER, 0);
+		dispatch_resume(_timer);
+		_lastRefillTime = [self currentTime];
+	}
+	return self;
+}
+
+- (void)dealloc
+{
+	dispatch_source_cancel(_timer);
+}
+
+- (void)enqueueData:(NSData *)data completionHandler:(void(^)(BOOL success))handler
+{
+	ORSSerialTransmitPacerFrame *frame = [[ORSSerialTransmitPacerFrame alloc] init];
+	frame.data = [data copy];
+	frame.completionHandler = handler;
+	[self adjustQueuedByteCountBy:(NSInteger)[frame.data length]];
+	dispatch_async(self.queue, ^{
+		[self.frames addObject:frame];
+		[self writeQueuedData];
+	});
+}
+
+- (void)cancelQueuedData
+{
+	dispatch_async(self.queue, ^{
+		NSArray *frames = [self.frames copy];
+		[self.frames removeAllObjects];
+		for (ORSSerialTransmitPacerFrame *frame in frames) {
+			[self adjustQueuedByteCountBy:-(NSInteger)([frame.data length] - frame.offset)];
+			if (frame.completionHandler) frame.completionHandler(NO);
+		}
+		[self releaseTransmitter];
+	});
+}
+
+#pragma mark - Properties
+
+- (NSUInteger)queuedByteCount
+{
+	@synchronized(self) { return _queuedByteCount; }
+}
+
+#pragma mark - Private
+
+- (void)adjustQueuedByteCountBy:(NSInteger)delta
+{
+	@synchronized(self) { _queuedByteCount += delta; }
+}
+
+- (NSTimeInterval)currentTime { return [[NSProcessInfo processInfo] systemUptime]; }
+
+// Writes as much queued data as the rate limit, inter-frame gap and transmitter
+// turnaround allow, then schedules the timer for when more can be written.
+- (void)writeQueuedData
+{
+	while (YES)
+	{
+		NSTimeInterval now = [self currentTime];
+		if (self.transmitterReleasePending) {
+			if (now < self.transmitterReleaseTime) {
+				[self scheduleTimerAfter:self.transmitterReleaseTime - now];
+				return;
+			}
+			[self releaseTransmitter];
+		}
+		if (![self.frames count]) return;
+		
+		ORSSerialTransmitPacerFrame *frame = self.frames[0];
+		if (frame.offset == 0) {
+			if (now < self.nextFrameTime) {
+				[self scheduleTimerAfter:self.nextFrameTime - now];
+				return;
+			}
+			
+			ORSSerialTransmitPacerTurnaroundHandler turnaroundHandler = self.turnaroundHandler;
+			if (turnaroundHandler && !self.transmitterEnabled) {
+				turnaroundHandler(YES);
+				self.transmitterEnabled = YES;
+				self.transmitterReadyTime = now + self.turnaroundLeadTime;
+			}
+			if (self.transmitterEnabled && now < self.transmitterReadyTime) {
+				[self scheduleTimerAfter:self.transmitterReadyTime - now];
+				return;
+			}
+		}
+		
+		NSUInteger remaining = [frame.data length] - frame.offset;
+		NSUInteger length = remaining;
+		double rate = self.bytesPerSecond;
+		if (rate > 0) {
+			double capacity = MAX(rate * ORSSerialTransmitPacerBurstInterval, 1.0);
+			self.tokens = MIN(capacity, self.tokens + rate * (now - self.lastRefillTime));
+			self.lastRefillTime = now;
+			
+			length = MIN(remaining, (NSUInteger)self.tokens);
+			if (length == 0) {
+				// Wait until there are enough tokens for a full burst (or the rest of the frame)
+				double needed = MIN((double)remaining, capacity) - self.tokens;
+				[self scheduleTimerAfter:needed / rate];
+				return;
+			}
+			self.tokens -= length;
+		}
+		
+		BOOL success = self.writer((const uint8_t *)[frame.data bytes] + frame.offset, length);
+		if (success) frame.offset += length;
+		[self adjustQueuedByteCountBy:-(NSInteger)(success ? length : remaining)];
+		if (success && frame.offset < [frame.data length]) continue;
+		
+		[self.frames removeObjectAtIndex:0];
+		if (self.transmitterEnabled) {
+			void(^drainHandler)(void) = self.drainHandler;
+			if (drainHandler) drainHandler();
+			self.transmitterReleasePending = YES;
+			self.transmitterReleaseTime = [self currentTime] + self.turnaroundTrailTime;
+		}
+		self.nextFrameTime = [self currentTime] + self.interFrameGap;
+		if (frame.completionHandler) frame.completionHandler(success);
+	}
+}
+
+- (void)releaseTransmitter
+{
+	self.transmitterReleasePending = NO;
+	if (!self.transmitterEnabled) return;
+	self.transmitterEnabled = NO;
+	ORSSerialTransmitPacerTurnaroundHandler turnaroundHandler = self.turnaroundHandler;
+	if (turnaroundHandler) turnaroundHandler(NO);
+}
+
+- (void)scheduleTimerAfter:(NSTimeInterval)interval
+{
+	dispatch_time_t start = dispatch_time(DISPATCH_TIME_NOW, (int64_t)(MAX(interval, 0) * NSEC_PER_SEC));
+	dispatch_source_set_timer(self.timer, start, DISPATCH_TIME_FOREVER, 0);
+}
+
+@end
@@ -27,4 +27,9 @@
 #import <ORSSerial/ORSSerialPort.h>
 #import <ORSSerial/ORSSerialPortManager.h>
 #import <ORSSerial/ORSSerialRequest.h>
-#import <ORSSerial/ORSSerialPacketDescriptor.h>
\ No newline at end of file
+#import <ORSSerial/ORSSerialPacketDescriptor.h>
+#import <ORSSerial/ORSSerialPacketStatistics.h>
+#import <ORSSerial/ORSSerialPortStatistics.h>
+#import <ORSSerial/ORSSerialPortMetadata.h>
+#import <ORSSerial/ORSSerialPortMatchingRule.h>
+#import <ORSSerial/ORSSerialPortTraceRecorder.h>
@@ -220,6 +220,21 @@ typedef BOOL(^ORSSerialPacketEvaluator)(NSData * __nullable inputData);
  */
 @property (nonatomic, readonly) NSUInteger maximumPacketLength;
 
+/**
+ *  The priority of the receiver relative to other packet descriptors installed on the
+ *  same port. The default is 0.
+ *
+ *  Descriptors with higher priorities are evaluated first, and so are matched first
+ *  when incoming data completes packets for more than one descriptor at once. This is
+ *  most useful when the port's packetDescriptorsAreMutuallyExclusive property is YES.
+ *  Among descriptors with the same priority, those that have matched packets more often
+ *  are evaluated first.
+ *
+ *  This property should be set before the receiver is passed to
+ *  -[ORSSerialPort startListeningForPacketsMatchingDescriptor:].
+ */
+@property (nonatomic) NSInteger priority;
+
 /**
  *  Arbitrary object (e.g. NSDictionary) used to store additional data
  *  about the packet descriptor.
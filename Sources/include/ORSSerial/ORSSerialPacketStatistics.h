@@ -0,0 +1,87 @@
+//
+//  ORSSerialPacketStatistics.h
+//  ORSSerialPort
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 Open Reel Software. All rights reserved.
+//
+//	Permission is hereby granted, free of charge, to any person obtaining a
+//	copy of this software and associated documentation files (the
+//	"Software"), to deal in the Software without restriction, including
+//	without limitation the rights to use, copy, modify, merge, publish,
+//	distribute, sublicense, and/or sell copies of the Software, and to
+//	permit persons to whom the Software is furnished to do so, subject to
+//	the following conditions:
+//
+//	The above copyright notice and this permission notice shall be included
+//	in all copies or substantial portions of the Software.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+//	OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//	CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//	TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//	SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#import <Foundation/Foundation.h>
+
+// Keep older versions of the compiler happy
+#ifndef NS_ASSUME_NONNULL_BEGIN
+#define NS_ASSUME_NONNULL_BEGIN
+#define NS_ASSUME_NONNULL_END
+#define nullable
+#define nonnullable
+#define __nullable
+#endif
+
+@class ORSSerialPacketDescriptor;
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ *  An ORSSerialPacketStatistics instance is a snapshot of the sizes of packets
+ *  an ORSSerialPort has received for one of its installed packet descriptors.
+ *
+ *  Use -[ORSSerialPort statisticsForPacketDescriptor:] to get statistics for
+ *  an installed descriptor. The recommendedMaximumPacketLength property can be used
+ *  to choose a maximumPacketLength that fits the traffic actually seen on the port,
+ *  rather than a worst-case guess.
+ */
+@interface ORSSerialPacketStatistics : NSObject
+
+/**
+ *  The packet descriptor the receiver describes.
+ */
+@property (nonatomic, strong, readonly) ORSSerialPacketDescriptor *packetDescriptor;
+
+/**
+ *  The number of packets matching packetDescriptor that have been received.
+ */
+@property (nonatomic, readonly) NSUInteger packetCount;
+
+/**
+ *  The length of the shortest packet received, or 0 if no packets have been received.
+ */
+@property (nonatomic, readonly) NSUInteger minimumPacketLength;
+
+/**
+ *  The length of the longest packet received, or 0 if no packets have been received.
+ */
+@property (nonatomic, readonly) NSUInteger maximumPacketLength;
+
+/**
+ *  The average length of received packets, or 0 if no packets have been received.
+ */
+@property (nonatomic, readonly) double averagePacketLength;
+
+/**
+ *  A maximum packet length large enough for the packets received so far, with some
+ *  headroom. Never larger than the descriptor's own maximumPacketLength, which is
+ *  returned if no packets have been received yet.
+ */
+@property (nonatomic, readonly) NSUInteger recommendedMaximumPacketLength;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -49,7 +49,10 @@
 	#endif
 #endif // #ifndef ORSArrayOf
 
-//#define LOG_SERIAL_PORT_ERRORS
+// Errors are logged to the unified log (subsystem com.openreelsoftware.ORSSerialPort, category Errors).
+// Uncomment to compile error logging out.
+//#define ORS_SERIAL_PORT_DISABLE_ERROR_LOG
+
 typedef NS_ENUM(NSUInteger, ORSSerialPortParity) {
 	ORSSerialPortParityNone = 0,
 	ORSSerialPortParityOdd,
@@ -60,6 +63,9 @@ typedef NS_ENUM(NSUInteger, ORSSerialPortParity) {
 
 @class ORSSerialRequest;
 @class ORSSerialPacketDescriptor;
+@class ORSSerialPacketStatistics;
+@class ORSSerialPortStatistics;
+@class ORSSerialPortMetadata;
 
 NS_ASSUME_NONNULL_BEGIN
 
@@ -222,6 +228,35 @@ NS_ASSUME_NONNULL_BEGIN
  */
 - (BOOL)close;
 
+/**
+ *  Opens the port represented by the receiver on a background queue, without blocking the caller.
+ *
+ *  The ORSSerialPortDelegate methods are called just as they are for `-open`. When opening has
+ *  finished, handler is called on the main queue, with nil if the port was opened successfully
+ *  (or was already open), or the error that occurred. If the port is already being opened, handler
+ *  is called once that finishes. Ports opened this way are opened in parallel.
+ *
+ *  @param handler A block called on the main queue when opening has finished. May be nil.
+ *
+ *  @see -[ORSSerialPortManager openPorts:completionHandler:]
+ */
+- (void)openWithCompletionHandler:(nullable void(^)(NSError * __nullable error))handler;
+
+/**
+ *  Closes the port represented by the receiver, without blocking the caller.
+ *
+ *  Restoring the port's original settings can take a while if it is waiting to send data. This method
+ *  returns immediately, and handler is called on the main queue, after `-serialPortWasClosed:`, once the
+ *  port has actually been closed. handler is passed nil if the port was closed successfully (or was
+ *  not open), or the error that occurred. If the port can't be closed right now, because it is still
+ *  being opened or an earlier attempt to close it failed, handler is passed an error right away.
+ *
+ *  @param handler A block called on the main queue when closing has finished. May be nil.
+ *
+ *  @see -[ORSSerialPortManager closePorts:completionHandler:]
+ */
+- (void)closeWithCompletionHandler:(nullable void(^)(NSError * __nullable error))handler;
+
 - (void)cleanup DEPRECATED_ATTRIBUTE; // Should never have been called in client code, anyway.
 
 /**
@@ -241,6 +276,9 @@ NS_ASSUME_NONNULL_BEGIN
  *
  *  This method attempts to send all data synchronously. That is, the method
  *  will not return until all passed in data has been sent, or an error has occurred.
+ *  The exception is when transmission is paced (see maximumTransmitRate) or
+ *  usesRS485DirectionControl is YES, in which case data is queued and this method
+ *  returns immediately.
  *
  *  If an error occurs, the ORSSerialPortDelegate method `-serialPort:didEncounterError:` will
  *  be called. The exception to this is if sending data fails because the port
@@ -258,6 +296,26 @@ NS_ASSUME_NONNULL_BEGIN
  */
 - (BOOL)sendData:(NSData *)data;
 
+/**
+ *  Sends data out through the serial port represented by the receiver, and calls handler
+ *  once it has actually been transmitted.
+ *
+ *  Data is sent exactly as it is by `-sendData:`, which only waits until the data has been
+ *  handed to the port's driver. Waiting for the driver to finish transmitting it (using tcdrain())
+ *  is done on a background queue. handler is called on the main queue with the time transmission
+ *  finished, which can be used to measure transmit latency or time half-duplex communication.
+ *  Note that if more data is sent before transmission finishes, handler may not be called until
+ *  that data has been transmitted too.
+ *
+ *  @param data    An `NSData` object containing the data to be sent.
+ *  @param handler A block called on the main queue once data has been transmitted, with the time that
+ *  happened, or with an error if the data couldn't be sent or waiting failed. The error's code is
+ *  ECANCELED if queued data was discarded because the port was closed.
+ *
+ *  @return YES if data was sent or queued, NO if an error occurred. handler is called either way.
+ */
+- (BOOL)sendData:(NSData *)data transmitCompletionHandler:(nullable void(^)(NSDate * __nullable transmitDate, NSError * __nullable error))handler;
+
 /**
  *  Sends the data in request, and begins watching for a valid response to the request,
  *  to be delivered to the delegate.
@@ -276,6 +334,29 @@ NS_ASSUME_NONNULL_BEGIN
  */
 - (BOOL)sendRequest:(ORSSerialRequest *)request;
 
+/**
+ *  Finds the baud rate a device connected to the port is using, by sending it request at
+ *  each rate in baudRates, in order, until a valid response is received.
+ *
+ *  Only the baud rate is changed between attempts, which is much faster than setting baudRate.
+ *  Parity and framing errors are counted while waiting for a response, and a rate at which most
+ *  received bytes have errors is given up on without waiting for request's timeoutInterval.
+ *  A timeoutInterval of 0 or less is treated as 0.5 seconds. If no rate gets a valid response,
+ *  the rate at which the most bytes were received without errors is used.
+ *
+ *  While detection is in progress, received data isn't delivered to the delegate, packet
+ *  descriptors or requests. Once it finishes, baudRate is set to the detected rate, and the
+ *  port's other settings are restored.
+ *
+ *  @param baudRates An array of `NSNumber`s containing the baud rates to try.
+ *  @param request   The request to send at each rate. Its responseDescriptor identifies a valid response.
+ *  @param handler   A block called on the main queue with the detected baud rate, or with an error
+ *  if the port isn't open, detection is already in progress, or no rate could be detected.
+ */
+- (void)detectBaudRateFromCandidates:(ORSArrayOf(NSNumber *) *)baudRates
+						probeRequest:(ORSSerialRequest *)request
+				   completionHandler:(nullable void(^)(NSNumber * __nullable baudRate, NSError * __nullable error))handler;
+
 /**
  *  Requests the cancellation of a queued (not yet sent) request. The request
  *  is removed from the requests queue and will not be sent.
@@ -311,6 +392,9 @@ NS_ASSUME_NONNULL_BEGIN
  *  When incoming data that constitutes a packet as described by descriptor is received,
  *  the delegate method -serialPort:didReceivePacket:matchingDescriptor: will be called.
  *
+ *  This method does not wait for incoming data that is already being processed. The descriptor
+ *  is used starting with the next received byte.
+ *
  *  @param descriptor An ORSerialPacketDescriptor instance describing the packets the receiver
  *  should listen for.
  *
@@ -333,6 +417,50 @@ NS_ASSUME_NONNULL_BEGIN
  */
 - (void)stopListeningForPacketsMatchingDescriptor:(ORSSerialPacketDescriptor *)descriptor;
 
+/**
+ *  Tells the receiver to begin listening for incoming packets matching any of the
+ *  specified descriptors.
+ *
+ *  This is equivalent to calling -startListeningForPacketsMatchingDescriptor: for each
+ *  descriptor, but the descriptors are installed together, and observers of packetDescriptors
+ *  are only notified once. This is the preferred way to install all the descriptors
+ *  for a protocol. Descriptors the receiver is already listening for are ignored.
+ *
+ *  @param descriptors An array of ORSSerialPacketDescriptor instances describing the packets the
+ *  receiver should listen for.
+ *
+ *  @see -stopListeningForPacketsMatchingDescriptors:
+ */
+- (void)startListeningForPacketsMatchingDescriptors:(ORSArrayOf(ORSSerialPacketDescriptor *) *)descriptors;
+
+/**
+ *  Tells the receiver to stop listening for incoming packets matching any of the
+ *  specified descriptors. Observers of packetDescriptors are only notified once.
+ *
+ *  @param descriptors An array of ORSSerialPacketDescriptor instances previously passed to
+ *  -startListeningForPacketsMatchingDescriptors: or -startListeningForPacketsMatchingDescriptor:
+ *
+ *  @see -startListeningForPacketsMatchingDescriptors:
+ */
+- (void)stopListeningForPacketsMatchingDescriptors:(ORSArrayOf(ORSSerialPacketDescriptor *) *)descriptors;
+
+/**
+ *  Returns statistics about the packets received so far that match descriptor.
+ *
+ *  The returned statistics' recommendedMaximumPacketLength can be used to choose
+ *  a maximumPacketLength for the descriptor based on the traffic actually seen
+ *  on the port.
+ *
+ *  @param descriptor An ORSSerialPacketDescriptor instance previously passed to
+ *  -startListeningForPacketsMatchingDescriptor:
+ *
+ *  @return An ORSSerialPacketStatistics instance, or nil if the receiver is not
+ *  listening for packets matching descriptor.
+ *
+ *  @see automaticallyTunesPacketBufferLengths
+ */
+- (nullable ORSSerialPacketStatistics *)statisticsForPacketDescriptor:(ORSSerialPacketDescriptor *)descriptor;
+
 /** ---------------------------------------------------------------------------------------
  * @name Delegate
  *  ---------------------------------------------------------------------------------------
@@ -381,6 +509,46 @@ NS_ASSUME_NONNULL_BEGIN
  */
 @property (nonatomic, strong, readonly) ORSArrayOf(ORSSerialPacketDescriptor *) *packetDescriptors;
 
+/**
+ *  Whether a packet matching one installed packet descriptor consumes the bytes it
+ *  is made of, so they can't also be part of packets for other descriptors. The
+ *  default is NO.
+ *
+ *  When this property is YES, descriptors are evaluated in order of their priority,
+ *  and evaluation stops at the first descriptor to match a packet. Bytes buffered
+ *  for all other descriptors are then discarded. Set this property to YES when
+ *  the installed descriptors describe distinct packets in the same protocol, so
+ *  that no more work than necessary is done for each received byte.
+ *
+ *  @see -[ORSSerialPacketDescriptor priority]
+ */
+@property (nonatomic) BOOL packetDescriptorsAreMutuallyExclusive;
+
+/**
+ *  Whether the port limits the number of bytes it buffers for each packet descriptor
+ *  based on the sizes of packets it has actually received. The default is NO.
+ *
+ *  Incoming bytes are buffered once for all installed packet descriptors, with enough
+ *  room for the descriptor with the largest maximumPacketLength. When this property
+ *  is YES, once a descriptor has matched a number of packets, only its statistics'
+ *  recommendedMaximumPacketLength bytes are searched and buffered for it. This reduces
+ *  both memory use and time spent searching for packets when descriptors' maximum packet
+ *  lengths are set much larger than the packets actually received.
+ *
+ *  Descriptors with a fixed suffix (or fixed packet data) also keep room for packets up
+ *  to twice as long, searched when their last byte arrives without a match. The room
+ *  doubles each time it turns out to be too small, and matching a longer packet raises
+ *  the length searched, so descriptors adapt if longer packets start arriving.
+ *
+ *  @note A packet longer than the room kept for it may not be recognized when this
+ *  property is YES, though later packets of the same length will be. For descriptors
+ *  without a fixed last byte, a packet much longer than any previously received may not
+ *  be recognized.
+ *
+ *  @see -statisticsForPacketDescriptor:
+ */
+@property (nonatomic) BOOL automaticallyTunesPacketBufferLengths;
+
 /** ---------------------------------------------------------------------------------------
  * @name Port Properties
  *  ---------------------------------------------------------------------------------------
@@ -408,6 +576,14 @@ NS_ASSUME_NONNULL_BEGIN
  */
 @property (copy, readonly) NSString *name;
 
+/**
+ *  Information about the device behind the port, such as its USB vendor and product IDs
+ *  and serial number. (read-only)
+ *
+ *  Read from IOKit once, when the port is created.
+ */
+@property (strong, readonly, nullable) ORSSerialPortMetadata *metadata;
+
 /** ---------------------------------------------------------------------------------------
  * @name Configuring the Serial Port
  *  ---------------------------------------------------------------------------------------
@@ -501,6 +677,218 @@ NS_ASSUME_NONNULL_BEGIN
  */
 @property (nonatomic) BOOL usesDCDOutputFlowControl;
 
+/**
+ *  A Boolean value indicating whether the serial port uses XON/XOFF (software) Flow Control.
+ *
+ *  When YES, transmission is paused as soon as an XOFF (0x13) byte is received, and resumed
+ *  when an XON (0x11) byte is received, and the port's driver sends XOFF and XON itself as its
+ *  receive buffer fills and empties. This is handled by the driver, so XON and XOFF bytes are
+ *  never delivered as received data. Only use this when the data sent in both directions
+ *  can't contain those bytes, e.g. text.
+ */
+@property (nonatomic) BOOL usesXONXOFFFlowControl;
+
+/**
+ *  A Boolean value indicating whether bytes received with parity or framing errors, and
+ *  break conditions, are detected. The default is NO, in which case errors aren't reported,
+ *  and bytes received with errors are delivered like any other.
+ *
+ *  When YES, the port's driver is asked to mark errors in the received data (using PARMRK and INPCK).
+ *  The marks are removed before data is passed to the delegate. A byte received with an error, and
+ *  any partially received packet or response before it or before a break, is discarded by
+ *  packet descriptors and requests. The delegate's
+ *  `-serialPort:didReceiveData:withErrorsAtIndexes:breaksAtIndexes:` method is called with the positions
+ *  of errors and breaks, and they are counted in statistics.
+ *
+ *  Note that a 0x00 byte received with an error can't be distinguished from a break, and is
+ *  reported as a break.
+ */
+@property (nonatomic) BOOL marksReceiveErrors;
+
+/**
+ *  A snapshot of counters kept by the port, such as the number of bytes received. (read-only)
+ *
+ *  Use -[ORSSerialPortStatistics statisticsBySubtractingStatistics:] to find out how
+ *  the counts have changed since an earlier snapshot.
+ */
+@property (nonatomic, strong, readonly) ORSSerialPortStatistics *statistics;
+
+/**
+ *  An estimate of the heap memory used by the port, in bytes. (read-only)
+ *
+ *  Includes packet matching buffers, queued requests, framing state, dispatch queues and
+ *  sources, and other subsystems the port has created. These are only created when first
+ *  needed, so a port that's never sent a request or installed a packet descriptor uses much
+ *  less. Doesn't include memory owned by the delegate or data waiting in the driver.
+ */
+@property (nonatomic, readonly) NSUInteger memoryFootprint;
+
+/**
+ *  A Boolean value indicating whether the number of received bytes waiting to be read is sampled
+ *  periodically while the port is open. The default is NO.
+ *
+ *  A growing backlog means data is being received faster than it is being processed, and
+ *  will eventually be lost when the driver's buffer overruns. Sampled backlogs are reported
+ *  in statistics. All monitored ports are sampled by a single shared timer.
+ *
+ *  @see receiveBacklogWarningThreshold
+ */
+@property (nonatomic) BOOL monitorsReceiveBacklog;
+
+/**
+ *  A Boolean value indicating whether the number of sent bytes waiting to be transmitted
+ *  is sampled periodically while the port is open. The default is NO.
+ *
+ *  Sampled lengths are reported in statistics. All monitored ports are sampled by a
+ *  single shared timer.
+ *
+ *  @see transmitQueueLength
+ */
+@property (nonatomic) BOOL monitorsTransmitQueue;
+
+/**
+ *  The number of sent bytes waiting in the port's driver to be transmitted. Always 0
+ *  if the port is closed. (read-only)
+ */
+@property (nonatomic, readonly) NSUInteger transmitQueueLength;
+
+/**
+ *  A Boolean value indicating whether the port minimizes timer wakeups while it's idle.
+ *  The default is NO.
+ *
+ *  By default, each open port polls its CTS, DSR and DCD lines every 10 ms from its own timer.
+ *  With many open ports this wakes the CPU thousands of times a second even if no data moves.
+ *  When this is YES, modem lines are polled from the single timer shared with receive backlog
+ *  and transmit queue monitoring, using generous timer leeway. Polling starts at 10 ms and
+ *  slows to twice a second while the lines don't change, and speeds back up as soon as
+ *  data is sent or received. Changes to the lines of an idle port may take up to half
+ *  a second to be reported.
+ */
+@property (nonatomic) BOOL conservesIdleWakeups;
+
+/**
+ *  When monitorsReceiveBacklog is YES, the delegate's `-serialPort:receiveBacklogDidExceedThreshold:`
+ *  method is called each time the sampled backlog rises to this many bytes or more. The default is 1024.
+ */
+@property (nonatomic) NSUInteger receiveBacklogWarningThreshold;
+
+/** ---------------------------------------------------------------------------------------
+ * @name Transmit Pacing
+ *  ---------------------------------------------------------------------------------------
+ */
+
+/**
+ *  The maximum rate, in bytes per second, at which sent data is written to the port.
+ *  The default is 0, which means no limit.
+ *
+ *  Pacing transmission keeps devices with small receive buffers and no flow control
+ *  from being overrun. When a limit or transmitFrameGap is set, -sendData: queues data and
+ *  returns immediately, and the data is written in order on a background queue as the
+ *  limit allows. Errors writing queued data are reported to the delegate.
+ *
+ *  @see maximumTransmitRateFractionOfBaudRate
+ */
+@property (nonatomic) double maximumTransmitRate;
+
+/**
+ *  Limits the rate at which sent data is written to a fraction of the rate the port's
+ *  baudRate, numberOfDataBits, parity and numberOfStopBits allow. For example, 0.9
+ *  leaves 10% of the line idle. The default is 0, which means no limit.
+ *
+ *  If maximumTransmitRate is also set, the lower of the two limits is used.
+ */
+@property (nonatomic) double maximumTransmitRateFractionOfBaudRate;
+
+/**
+ *  The minimum time, in seconds, between writing the last byte of the data passed to one
+ *  `-sendData:` call and the first byte passed to the next. The default is 0.
+ *
+ *  Use this for devices that delimit frames by idle time on the line, such as Modbus RTU.
+ */
+@property (nonatomic) NSTimeInterval transmitFrameGap;
+
+/** ---------------------------------------------------------------------------------------
+ * @name RS-485
+ *  ---------------------------------------------------------------------------------------
+ */
+
+/**
+ *  A Boolean value indicating whether the RTS pin is used to control the direction of
+ *  a half-duplex RS-485 transceiver. The default is NO.
+ *
+ *  When YES, RTS is low except while sending. Before sending the data passed to each `-sendData:`
+ *  call, RTS is raised and the port waits RS485DelayBeforeSend. Once the data has actually been
+ *  transmitted, the port waits RS485DelayAfterSend, then lowers RTS. Data is sent from a background
+ *  queue, so `-sendData:` returns immediately. The RTS property has no effect while this is YES.
+ *
+ *  Bytes received while RTS is raised are the port's own transmission echoed back by the
+ *  transceiver, and are discarded. If suppressesLocalEcho is also YES, they're instead
+ *  compared with the bytes sent, so collisions are counted.
+ *
+ *  Devices without an RTS line, like pseudo terminals, are still sent data, without direction control.
+ */
+@property (nonatomic) BOOL usesRS485DirectionControl;
+
+/**
+ *  Time, in seconds, to wait after raising RTS before sending data when usesRS485DirectionControl
+ *  is YES, giving the transceiver time to enable its driver. The default is 0.
+ */
+@property (nonatomic) NSTimeInterval RS485DelayBeforeSend;
+
+/**
+ *  Time, in seconds, to wait after data has been transmitted before lowering RTS when
+ *  usesRS485DirectionControl is YES. The default is 0.
+ */
+@property (nonatomic) NSTimeInterval RS485DelayAfterSend;
+
+/**
+ *  A Boolean value indicating whether the port's own transmission, echoed back on a
+ *  two-wire half-duplex link, is removed from received data. The default is NO.
+ *
+ *  When YES, sent bytes are recorded and compared against received bytes. Those received
+ *  while echo is expected are discarded before being passed to the delegate, packet
+ *  descriptors or requests. Echo bytes that don't match what was sent, and sent bytes whose
+ *  echo never arrives, are counted in statistics.
+ */
+@property (nonatomic) BOOL suppressesLocalEcho;
+
+/** ---------------------------------------------------------------------------------------
+ * @name Compressed Framing
+ *  ---------------------------------------------------------------------------------------
+ */
+
+/**
+ *  A Boolean value indicating whether sent and received data is wrapped in compressed,
+ *  CRC-checked frames. The default is NO.
+ *
+ *  Use this on slow links to a device that implements the same framing. Its reference
+ *  implementation, ORSSerialFrameCodec.c and ORSSerialFrameCodec.h, is portable C
+ *  that can be built into the device's firmware.
+ *
+ *  When YES, the data passed to `-sendData:` is split into frames of up to 1024 bytes, each
+ *  compressed unless that would make it larger. Received frames are checked and decompressed
+ *  before their payloads are passed to the delegate, packet descriptors and requests.
+ *  Bytes outside frames and frames that fail their CRC are discarded, and the latter are
+ *  counted in statistics. Errors and breaks are not reported for framed data.
+ *
+ *  Requests with a messageType are sent as the changes from the last request of the same
+ *  type, when that's smaller, and the device can respond the same way.
+ *
+ *  @see -[ORSSerialRequest messageType]
+ */
+@property (nonatomic) BOOL usesCompressedFraming;
+
+/**
+ *  Discards the data last sent and received of each message type, so the next request of each
+ *  type is sent whole, and asks the device to do the same.
+ *
+ *  Each end asks for a whole message when it can't apply changes, so delta encoding recovers
+ *  from lost frames and restarts on its own, but that costs a round trip. Call this method to skip
+ *  it when the device's state is known to be gone, for example after switching to a different
+ *  device on the same port.
+ */
+- (void)resynchronizeDeltaEncoding;
+
 /** ---------------------------------------------------------------------------------------
  * @name Other Port Pins
  *  ---------------------------------------------------------------------------------------
@@ -597,6 +985,19 @@ NS_ASSUME_NONNULL_BEGIN
  */
 - (void)serialPort:(ORSSerialPort *)serialPort didReceiveData:(NSData *)data;
 
+/**
+ *  Called when data is received with parity or framing errors, or a break is received, while
+ *  the port's `marksReceiveErrors` property is YES. Called after `-serialPort:didReceiveData:` for the
+ *  same data.
+ *
+ *  @param serialPort   The `ORSSerialPort` instance representing the port that received `data`.
+ *  @param data         An `NSData` instance containing the data received, as passed to `-serialPort:didReceiveData:`.
+ *  @param errorIndexes The indexes in `data` of bytes received with errors. May be empty.
+ *  @param breakIndexes The indexes in `data` at which breaks were received. A break at index i was
+ *  received before the byte at index i, and may be equal to the length of `data`. May be empty.
+ */
+- (void)serialPort:(ORSSerialPort *)serialPort didReceiveData:(NSData *)data withErrorsAtIndexes:(NSIndexSet *)errorIndexes breaksAtIndexes:(NSIndexSet *)breakIndexes;
+
 /**
  *  Called when a valid, complete packet matching a descriptor installed with 
  *  -startListeningForPacketsMatchingDescriptor: is received.
@@ -647,6 +1048,18 @@ NS_ASSUME_NONNULL_BEGIN
  */
 - (void)serialPort:(ORSSerialPort *)serialPort didEncounterError:(NSError *)error;
 
+/**
+ *  Called when the number of received bytes waiting to be read rises to the port's
+ *  `receiveBacklogWarningThreshold` or above, while `monitorsReceiveBacklog` is YES. Not
+ *  called again until the backlog has dropped below the threshold.
+ *
+ *  This means the app isn't keeping up with incoming data, and data may soon be lost.
+ *
+ *  @param serialPort The `ORSSerialPort` instance representing the port.
+ *  @param byteCount  The number of received bytes waiting to be read.
+ */
+- (void)serialPort:(ORSSerialPort *)serialPort receiveBacklogDidExceedThreshold:(NSUInteger)byteCount;
+
 /**
  *  Called when a serial port is successfully opened.
  *
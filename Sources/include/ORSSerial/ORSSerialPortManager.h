@@ -47,6 +47,14 @@
 	#endif
 #endif // #ifndef ORSArrayOf
 
+#ifndef ORSDictionaryOf
+	#if __has_feature(objc_generics)
+		#define ORSDictionaryOf(KEYTYPE, VALUETYPE) NSDictionary<KEYTYPE, VALUETYPE>
+	#else
+		#define ORSDictionaryOf(KEYTYPE, VALUETYPE) NSDictionary
+	#endif
+#endif // #ifndef ORSDictionaryOf
+
 NS_ASSUME_NONNULL_BEGIN
 
 /// Posted when a serial port is connected to the system
@@ -61,6 +69,8 @@ extern NSString * const ORSConnectedSerialPortsKey;
 extern NSString * const ORSDisconnectedSerialPortsKey;
 
 @class ORSSerialPort;
+@class ORSSerialRequest;
+@class ORSSerialPortMatchingRule;
 
 /**
  *  `ORSSerialPortManager` is a singleton class (one instance per
@@ -111,9 +121,15 @@ extern NSString * const ORSDisconnectedSerialPortsKey;
  *  `ORSSerialPortManager`'s close-on-sleep, reopen-on-wake functionality is
  *  automatic. The only thing necessary to enable it is to make sure that
  *  the singleton instance of `ORSSerialPortManager` has been created by
- *  calling `+sharedSerialPortManager` at least once. Note that this
- *  behavior is only available in Cocoa apps, and is disabled when
- *  ORSSerialPort is used in a command-line only app.
+ *  calling `+sharedSerialPortManager` at least once. In Cocoa apps, NSWorkspace's
+ *  sleep and wake notifications are used. In command-line apps, IOKit power
+ *  management notifications are used instead, and system sleep is delayed until
+ *  open ports have been closed. In both cases, the run loop of the thread the
+ *  manager was created on must be running.
+ *
+ *  Ports are closed and reopened in parallel. If your app gets sleep and wake
+ *  events some other way, it can call `-closePortsForSystemSleepWithCompletionHandler:`
+ *  and `-reopenPortsAfterSystemWakeWithCompletionHandler:` itself.
  */
 @interface ORSSerialPortManager : NSObject
 
@@ -135,6 +151,112 @@ extern NSString * const ORSDisconnectedSerialPortsKey;
  */
 @property (nonatomic, copy, readonly) ORSArrayOf(ORSSerialPort *) *availablePorts;
 
+/**
+ *  Opens each of ports, without blocking the caller.
+ *
+ *  Up to maximumConcurrentPortOperations ports are opened in parallel. Each port's delegate
+ *  is notified as it would be by `-[ORSSerialPort openWithCompletionHandler:]`. When all ports
+ *  have been opened, handler is called on the main queue with the ports that failed to open.
+ *
+ *  @param ports   An array of ORSSerialPort instances to open.
+ *  @param handler A block called on the main queue once all ports have been opened. May be nil.
+ */
+- (void)openPorts:(ORSArrayOf(ORSSerialPort *) *)ports completionHandler:(nullable void(^)(ORSArrayOf(ORSSerialPort *) *failedPorts))handler;
+
+/**
+ *  Closes each of ports, without blocking the caller.
+ *
+ *  Up to maximumConcurrentPortOperations ports are closed in parallel. When all ports
+ *  have been closed, handler is called on the main queue with the ports that failed to close.
+ *
+ *  @param ports   An array of ORSSerialPort instances to close.
+ *  @param handler A block called on the main queue once all ports have been closed. May be nil.
+ */
+- (void)closePorts:(ORSArrayOf(ORSSerialPort *) *)ports completionHandler:(nullable void(^)(ORSArrayOf(ORSSerialPort *) *failedPorts))handler;
+
+/**
+ *  Finds out which devices are connected to ports, by sending request on all of them at once.
+ *
+ *  Closed ports are opened, up to maximumConcurrentPortOperations at a time, and closed again
+ *  when discovery finishes. request is sent on each port using the port's current settings. Each
+ *  port waits for a response until request's timeoutInterval elapses, or until timeout has elapsed
+ *  since discovery started, whichever is sooner. Ports with no response by then are left out of the
+ *  result. Responses are not passed to the ports' delegates.
+ *
+ *  @param ports   An array of ORSSerialPort instances to probe, or nil to probe all of availablePorts.
+ *  @param request A request whose response identifies the device. Its responseDescriptor should be set.
+ *  @param timeout The maximum time, in seconds, discovery may take before handler is called.
+ *  @param handler A block called on the main queue with each response received, keyed by the path of
+ *  the port it was received on.
+ */
+- (void)discoverDevicesOnPorts:(nullable ORSArrayOf(ORSSerialPort *) *)ports
+				  probeRequest:(ORSSerialRequest *)request
+					   timeout:(NSTimeInterval)timeout
+			 completionHandler:(void(^)(ORSDictionaryOf(NSString *, NSData *) *responsesByPath))handler;
+
+/**
+ *  Adds a rule identifying a device, so the port it's connected to can be found with
+ *  -portMatchingRuleNamed:. Replaces any rule with the same name.
+ *
+ *  The manager keeps track of the port matching each rule as ports are connected and
+ *  disconnected, so looking up a port by rule name doesn't require checking every port.
+ *
+ *  @param rule An ORSSerialPortMatchingRule instance.
+ */
+- (void)addPortMatchingRule:(ORSSerialPortMatchingRule *)rule;
+
+/**
+ *  Removes a rule added with -addPortMatchingRule:.
+ *
+ *  @param rule The rule to remove.
+ */
+- (void)removePortMatchingRule:(ORSSerialPortMatchingRule *)rule;
+
+/**
+ *  Returns the available port matching the rule with the given name.
+ *
+ *  @param name The name of a rule added with -addPortMatchingRule:.
+ *
+ *  @return The port matching the rule, or nil if no available port matches it.
+ *  If more than one port matches, one of them is returned.
+ */
+- (nullable ORSSerialPort *)portMatchingRuleNamed:(NSString *)name;
+
+/**
+ *  Closes all open ports in availablePorts, and remembers them so they can be reopened
+ *  by -reopenPortsAfterSystemWakeWithCompletionHandler:.
+ *
+ *  This is called automatically when the system is about to sleep. It only needs to be
+ *  called directly by apps that get sleep notifications from another source.
+ *
+ *  @param handler A block called on the main queue once all ports have been closed. May be nil.
+ */
+- (void)closePortsForSystemSleepWithCompletionHandler:(nullable void(^)(void))handler;
+
+/**
+ *  Reopens the ports closed by -closePortsForSystemSleepWithCompletionHandler:. Each port is opened
+ *  with the same settings and packet descriptors it had before it was closed. If those ports are
+ *  still being closed, they are reopened once closing has finished.
+ *
+ *  This is called automatically when the system wakes from sleep. It only needs to be
+ *  called directly by apps that get wake notifications from another source.
+ *
+ *  @param handler A block called on the main queue once all ports have been reopened. May be nil.
+ */
+- (void)reopenPortsAfterSystemWakeWithCompletionHandler:(nullable void(^)(void))handler;
+
+/**
+ *  The time it took to reopen all ports after the system last woke from sleep, in seconds.
+ *  0 if ports haven't been reopened after sleep yet. This property is KVO compliant.
+ */
+@property (nonatomic, readonly) NSTimeInterval lastWakeRecoveryTime;
+
+/**
+ *  The maximum number of ports opened or closed at the same time by -openPorts:completionHandler:
+ *  and -closePorts:completionHandler:. The default is 8.
+ */
+@property (nonatomic) NSUInteger maximumConcurrentPortOperations;
+
 @end
 
 NS_ASSUME_NONNULL_END
\ No newline at end of file
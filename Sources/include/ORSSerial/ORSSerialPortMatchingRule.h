@@ -0,0 +1,126 @@
+//
+//  ORSSerialPortMatchingRule.h
+//  ORSSerialPort
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 Open Reel Software. All rights reserved.
+//
+//	Permission is hereby granted, free of charge, to any person obtaining a
+//	copy of this software and associated documentation files (the
+//	"Software"), to deal in the Software without restriction, including
+//	without limitation the rights to use, copy, modify, merge, publish,
+//	distribute, sublicense, and/or sell copies of the Software, and to
+//	permit persons to whom the Software is furnished to do so, subject to
+//	the following conditions:
+//
+//	The above copyright notice and this permission notice shall be included
+//	in all copies or substantial portions of the Software.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+//	OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//	CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//	TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//	SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#import <Foundation/Foundation.h>
+
+// Keep older versions of the compiler happy
+#ifndef NS_ASSUME_NONNULL_BEGIN
+#define NS_ASSUME_NONNULL_BEGIN
+#define NS_ASSUME_NONNULL_END
+#define nullable
+#define nonnullable
+#define __nullable
+#endif
+
+NS_ASSUME_NONNULL_BEGIN
+
+@class ORSSerialPortMetadata;
+
+/**
+ *  An ORSSerialPortMatchingRule identifies a particular device by properties that
+ *  stay the same when it's reconnected, unlike its port's path or name.
+ *
+ *  A rule matches a port if every property of the rule that isn't nil is equal to the
+ *  same property of the port's metadata. For example, a rule with only a vendor ID and
+ *  product ID matches any device of that model, while a rule with a location ID as well
+ *  matches only the one plugged into a particular USB port.
+ *
+ *  Add rules to ORSSerialPortManager with -[ORSSerialPortManager addPortMatchingRule:]
+ *  to look ports up by rule name.
+ */
+@interface ORSSerialPortMatchingRule : NSObject
+
+/**
+ *  Creates and initializes an ORSSerialPortMatchingRule instance.
+ *
+ *  @param name         A name for the rule, e.g. "GPS", used to look up the matching port.
+ *  @param vendorID     A USB vendor ID to match. May be nil.
+ *  @param productID    A USB product ID to match. May be nil.
+ *  @param serialNumber A USB serial number to match. May be nil.
+ *  @param locationID   A USB location ID, identifying a physical port, to match. May be nil.
+ *
+ *  @return An initialized ORSSerialPortMatchingRule instance.
+ */
++ (instancetype)ruleWithName:(NSString *)name
+					vendorID:(nullable NSNumber *)vendorID
+				   productID:(nullable NSNumber *)productID
+				serialNumber:(nullable NSString *)serialNumber
+				  locationID:(nullable NSNumber *)locationID;
+
+/**
+ *  Initializes an ORSSerialPortMatchingRule instance.
+ *
+ *  @param name         A name for the rule, e.g. "GPS", used to look up the matching port.
+ *  @param vendorID     A USB vendor ID to match. May be nil.
+ *  @param productID    A USB product ID to match. May be nil.
+ *  @param serialNumber A USB serial number to match. May be nil.
+ *  @param locationID   A USB location ID, identifying a physical port, to match. May be nil.
+ *
+ *  @return An initialized ORSSerialPortMatchingRule instance.
+ */
+- (instancetype)initWithName:(NSString *)name
+					vendorID:(nullable NSNumber *)vendorID
+				   productID:(nullable NSNumber *)productID
+				serialNumber:(nullable NSString *)serialNumber
+				  locationID:(nullable NSNumber *)locationID NS_DESIGNATED_INITIALIZER;
+
+/**
+ *  Returns YES if the port described by metadata matches the receiver.
+ *
+ *  @param metadata The metadata of a port.
+ *
+ *  @return YES if every non-nil property of the receiver matches metadata.
+ */
+- (BOOL)matchesMetadata:(nullable ORSSerialPortMetadata *)metadata;
+
+/**
+ *  The rule's name.
+ */
+@property (nonatomic, copy, readonly) NSString *name;
+
+/**
+ *  The USB vendor ID to match, or nil to match any.
+ */
+@property (nonatomic, strong, readonly, nullable) NSNumber *vendorID;
+
+/**
+ *  The USB product ID to match, or nil to match any.
+ */
+@property (nonatomic, strong, readonly, nullable) NSNumber *productID;
+
+/**
+ *  The USB serial number to match, or nil to match any.
+ */
+@property (nonatomic, copy, readonly, nullable) NSString *serialNumber;
+
+/**
+ *  The USB location ID to match, or nil to match any.
+ */
+@property (nonatomic, strong, readonly, nullable) NSNumber *locationID;
+
+@end
+
+NS_ASSUME_NONNULL_END
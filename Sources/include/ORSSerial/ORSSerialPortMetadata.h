@@ -0,0 +1,106 @@
+//
+//  ORSSerialPortMetadata.h
+//  ORSSerialPort
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 Open Reel Software. All rights reserved.
+//
+//	Permission is hereby granted, free of charge, to any person obtaining a
+//	copy of this software and associated documentation files (the
+//	"Software"), to deal in the Software without restriction, including
+//	without limitation the rights to use, copy, modify, merge, publish,
+//	distribute, sublicense, and/or sell copies of the Software, and to
+//	permit persons to whom the Software is furnished to do so, subject to
+//	the following conditions:
+//
+//	The above copyright notice and this permission notice shall be included
+//	in all copies or substantial portions of the Software.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+//	OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//	CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//	TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//	SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#import <Foundation/Foundation.h>
+#import <IOKit/IOTypes.h>
+
+// Keep older versions of the compiler happy
+#ifndef NS_ASSUME_NONNULL_BEGIN
+#define NS_ASSUME_NONNULL_BEGIN
+#define NS_ASSUME_NONNULL_END
+#define nullable
+#define nonnullable
+#define __nullable
+#endif
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ *  An ORSSerialPortMetadata instance describes the device behind a serial port,
+ *  as reported by IOKit.
+ *
+ *  All properties are read from the IOKit registry when the instance is created, so
+ *  reading them later doesn't require any further IOKit calls. Use
+ *  -[ORSSerialPort metadata] to get the metadata for a port, which is only created once.
+ *
+ *  USB properties are nil for ports that aren't USB devices, e.g. Bluetooth ports.
+ */
+@interface ORSSerialPortMetadata : NSObject
+
+/**
+ *  Reads metadata for an IOKit serial device.
+ *
+ *  @param device An IOKit serial BSD client object.
+ *
+ *  @return An initialized ORSSerialPortMetadata instance, or nil if device is 0 or isn't an IOKit registry entry.
+ */
+- (nullable instancetype)initWithDevice:(io_object_t)device;
+
+/**
+ *  The name of the port, e.g. "usbserial-A6004mQr".
+ */
+@property (nonatomic, copy, readonly, nullable) NSString *name;
+
+/**
+ *  The callout device path of the port, e.g. "/dev/cu.usbserial-A6004mQr".
+ */
+@property (nonatomic, copy, readonly, nullable) NSString *path;
+
+/**
+ *  The USB vendor ID of the device.
+ */
+@property (nonatomic, strong, readonly, nullable) NSNumber *vendorID;
+
+/**
+ *  The USB product ID of the device.
+ */
+@property (nonatomic, strong, readonly, nullable) NSNumber *productID;
+
+/**
+ *  The USB serial number string of the device.
+ */
+@property (nonatomic, copy, readonly, nullable) NSString *serialNumber;
+
+/**
+ *  The USB location ID of the device, which identifies the physical USB port (including any hubs)
+ *  the device is plugged into. It stays the same when the device is unplugged and plugged back in
+ *  to the same port.
+ */
+@property (nonatomic, strong, readonly, nullable) NSNumber *locationID;
+
+/**
+ *  The IOKit class name of the driver for the port, e.g. "AppleUSBFTDI".
+ */
+@property (nonatomic, copy, readonly, nullable) NSString *driverName;
+
+/**
+ *  The IOKit registry entry ID of the port, which uniquely identifies it until it's removed from the system.
+ */
+@property (nonatomic, readonly) uint64_t registryEntryID;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,121 @@
+//
+//  ORSSerialPortStatistics.h
+//  ORSSerialPort
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 Open Reel Software. All rights reserved.
+//
+//	Permission is hereby granted, free of charge, to any person obtaining a
+//	copy of this software and associated documentation files (the
+//	"Software"), to deal in the Software without restriction, including
+//	without limitation the rights to use, copy, modify, merge, publish,
+//	distribute, sublicense, and/or sell copies of the Software, and to
+//	permit persons to whom the Software is furnished to do so, subject to
+//	the following conditions:
+//
+//	The above copyright notice and this permission notice shall be included
+//	in all copies or substantial portions of the Software.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+//	OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//	CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//	TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//	SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#import <Foundation/Foundation.h>
+
+/**
+ *  An ORSSerialPortStatistics instance is a snapshot of counters kept by an
+ *  ORSSerialPort since it was created.
+ *
+ *  Use -[ORSSerialPort statistics] to get the current statistics for a port.
+ */
+@interface ORSSerialPortStatistics : NSObject
+
+/**
+ *  The number of bytes received. Error marks inserted by the driver when
+ *  `-[ORSSerialPort marksReceiveErrors]` is YES are not counted.
+ */
+@property (nonatomic, readonly) unsigned long long receivedByteCount;
+
+/**
+ *  The number of bytes received with a parity or framing error. Only counted
+ *  while `-[ORSSerialPort marksReceiveErrors]` is YES.
+ */
+@property (nonatomic, readonly) unsigned long long receiveErrorCount;
+
+/**
+ *  The number of break conditions received. Only counted while
+ *  `-[ORSSerialPort marksReceiveErrors]` is YES.
+ */
+@property (nonatomic, readonly) unsigned long long breakCount;
+
+/**
+ *  The number of received bytes waiting to be read when the port was last sampled.
+ *  Only sampled while `-[ORSSerialPort monitorsReceiveBacklog]` is YES.
+ */
+@property (nonatomic, readonly) NSUInteger receiveBacklog;
+
+/**
+ *  The largest receiveBacklog sampled so far.
+ */
+@property (nonatomic, readonly) NSUInteger maximumReceiveBacklog;
+
+/**
+ *  The number of times the receive backlog has risen above
+ *  `-[ORSSerialPort receiveBacklogWarningThreshold]`.
+ */
+@property (nonatomic, readonly) unsigned long long receiveBacklogWarningCount;
+
+/**
+ *  The number of bytes sent.
+ */
+@property (nonatomic, readonly) unsigned long long sentByteCount;
+
+/**
+ *  The number of sent bytes that had not yet been transmitted when the port was last sampled.
+ *  Only sampled while `-[ORSSerialPort monitorsTransmitQueue]` is YES.
+ */
+@property (nonatomic, readonly) NSUInteger transmitQueueLength;
+
+/**
+ *  The largest transmitQueueLength sampled so far.
+ */
+@property (nonatomic, readonly) NSUInteger maximumTransmitQueueLength;
+
+/**
+ *  The number of received bytes discarded as local echo of sent bytes. Only counted
+ *  while `-[ORSSerialPort suppressesLocalEcho]` is YES.
+ */
+@property (nonatomic, readonly) unsigned long long echoedByteCount;
+
+/**
+ *  The number of received echo bytes that didn't match the bytes sent, indicating
+ *  a collision or line noise.
+ */
+@property (nonatomic, readonly) unsigned long long echoMismatchCount;
+
+/**
+ *  The number of sent bytes whose echo was never received.
+ */
+@property (nonatomic, readonly) unsigned long long missingEchoByteCount;
+
+/**
+ *  The number of received frames discarded because their CRC, length or compressed
+ *  payload was invalid. Only counted while `-[ORSSerialPort usesCompressedFraming]` is YES.
+ */
+@property (nonatomic, readonly) unsigned long long discardedFrameCount;
+
+/**
+ *  Returns statistics containing the change in each count since statistics were taken.
+ *  Sampled lengths and their maximums are not counts, and are those of the receiver.
+ *
+ *  @param statistics Statistics for the same port, taken earlier than the receiver.
+ *
+ *  @return An ORSSerialPortStatistics instance containing the differences.
+ */
+- (ORSSerialPortStatistics *)statisticsBySubtractingStatistics:(ORSSerialPortStatistics *)statistics;
+
+@end
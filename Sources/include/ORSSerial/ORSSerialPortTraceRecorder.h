@@ -0,0 +1,111 @@
+//
+//  ORSSerialPortTraceRecorder.h
+//  ORSSerialPort
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 Open Reel Software. All rights reserved.
+//
+//	Permission is hereby granted, free of charge, to any person obtaining a
+//	copy of this software and associated documentation files (the
+//	"Software"), to deal in the Software without restriction, including
+//	without limitation the rights to use, copy, modify, merge, publish,
+//	distribute, sublicense, and/or sell copies of the Software, and to
+//	permit persons to whom the Software is furnished to do so, subject to
+//	the following conditions:
+//
+//	The above copyright notice and this permission notice shall be included
+//	in all copies or substantial portions of the Software.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+//	OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+//	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+//	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+//	CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+//	TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+//	SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#import <Foundation/Foundation.h>
+
+// Keep older versions of the compiler happy
+#ifndef NS_ASSUME_NONNULL_BEGIN
+#define NS_ASSUME_NONNULL_BEGIN
+#define NS_ASSUME_NONNULL_END
+#define nullable
+#define nonnullable
+#define __nullable
+#endif
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ *  ORSSerialPortTraceRecorder records the activity of every serial port to a timeline in the
+ *  Chrome trace event format, which can be opened in Perfetto (https://ui.perfetto.dev) or
+ *  chrome://tracing.
+ *
+ *  Each port gets its own track, showing:
+ *
+ *  - Received chunks of data, and requests being sent
+ *  - Packets matched, on a separate row for each packet descriptor
+ *  - Requests, from being queued until they get a response, time out or are cancelled
+ *  - Write system calls
+ *  - Delegate callbacks, from being dispatched to the main queue until the delegate method returns
+ *  - Waits for the main queue while updating modem line properties or reporting errors
+ *  - The length of the request queue and the transmit queue, and the state of each modem line
+ *
+ *  Nothing is recorded until -startRecording is called. Recording costs little, but keeps every
+ *  event in memory until it's stopped, so record for as long as needed and no longer.
+ *
+ *  Recording is not available if ORSSerialPort was built with ORS_SERIAL_PORT_DISABLE_TRACEPOINTS defined.
+ */
+@interface ORSSerialPortTraceRecorder : NSObject
+
+/**
+ *  Returns the shared (singleton) trace recorder.
+ *
+ *  @return The shared ORSSerialPortTraceRecorder instance.
+ */
++ (ORSSerialPortTraceRecorder *)sharedTraceRecorder;
+
+/**
+ *  Discards any previously recorded events, and starts recording. Does nothing if
+ *  already recording.
+ */
+- (void)startRecording;
+
+/**
+ *  Stops recording, and returns the recorded trace.
+ *
+ *  @return The trace, as JSON data in the Chrome trace event format, or nil if not recording.
+ */
+- (nullable NSData *)stopRecording;
+
+/**
+ *  Stops recording, and writes the recorded trace to a file.
+ *
+ *  @param url   A file URL to write the trace to, conventionally with a .json extension.
+ *  @param error If the trace couldn't be written, upon return contains an NSError describing the problem.
+ *
+ *  @return YES if the trace was written, NO if it couldn't be written or the receiver wasn't recording.
+ */
+- (BOOL)stopRecordingAndWriteToURL:(NSURL *)url error:(NSError **)error;
+
+/**
+ *  A Boolean value indicating whether events are being recorded.
+ */
+@property (nonatomic, readonly, getter=isRecording) BOOL recording;
+
+/**
+ *  The maximum number of events kept while recording. Later events are dropped, and
+ *  counted in droppedEventCount. The default is 1,000,000.
+ */
+@property (nonatomic) NSUInteger maximumEventCount;
+
+/**
+ *  The number of events dropped during the current or most recent recording because
+ *  maximumEventCount was reached.
+ */
+@property (nonatomic, readonly) NSUInteger droppedEventCount;
+
+@end
+
+NS_ASSUME_NONNULL_END
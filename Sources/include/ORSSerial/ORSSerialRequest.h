@@ -76,6 +76,27 @@ NS_ASSUME_NONNULL_BEGIN
 					  timeoutInterval:(NSTimeInterval)timeout
 					responseDescriptor:(nullable ORSSerialPacketDescriptor *)responseDescriptor;
 
+/**
+ *  Creates and initializes an ORSSerialRequest instance whose data is delta encoded
+ *  when sent on a port using compressed framing.
+ *
+ *  @param dataToSend			The data to be sent on the serial port.
+ *  @param userInfo				An arbitrary userInfo object.
+ *  @param timeout				The maximum amount of time in seconds to wait for a response. Pass -1.0 to wait indefinitely.
+ *  @param responseDescriptor	A packet descriptor used to evaluate whether received data constitutes a valid response to the request.
+ *  May be nil.
+ *  @param messageType			The message type, from 1 to 8, whose last sent data dataToSend is encoded against. 0 for none.
+ *
+ *  @return An initialized ORSSerialRequest instance.
+ *
+ *  @see messageType
+ */
++ (instancetype)requestWithDataToSend:(NSData *)dataToSend
+							 userInfo:(nullable id)userInfo
+					  timeoutInterval:(NSTimeInterval)timeout
+					responseDescriptor:(nullable ORSSerialPacketDescriptor *)responseDescriptor
+						  messageType:(NSUInteger)messageType;
+
 /**
  *  Initializes an ORSSerialRequest instance.
  *
@@ -93,6 +114,27 @@ NS_ASSUME_NONNULL_BEGIN
 				   timeoutInterval:(NSTimeInterval)timeout
 				 responseDescriptor:(nullable ORSSerialPacketDescriptor *)responseDescriptor;
 
+/**
+ *  Initializes an ORSSerialRequest instance whose data is delta encoded when sent on a
+ *  port using compressed framing.
+ *
+ *  @param dataToSend			The data to be sent on the serial port.
+ *  @param userInfo				An arbitrary userInfo object.
+ *  @param timeout				The maximum amount of time in seconds to wait for a response. Pass -1.0 to wait indefinitely.
+ *  @param responseDescriptor	A packet descriptor used to evaluate whether received data constitutes a valid response to the request.
+ *  May be nil.
+ *  @param messageType			The message type, from 1 to 8, whose last sent data dataToSend is encoded against. 0 for none.
+ *
+ *  @return An initialized ORSSerialRequest instance.
+ *
+ *  @see messageType
+ */
+- (instancetype)initWithDataToSend:(NSData *)dataToSend
+						  userInfo:(nullable id)userInfo
+				   timeoutInterval:(NSTimeInterval)timeout
+				 responseDescriptor:(nullable ORSSerialPacketDescriptor *)responseDescriptor
+					   messageType:(NSUInteger)messageType;
+
 /**
  *  Data to be sent on the serial port when the receiver is sent.
  */
@@ -121,6 +163,19 @@ NS_ASSUME_NONNULL_BEGIN
  */
 @property (nonatomic, strong, readonly) NSString *UUIDString;
 
+/**
+ *  The type of message the receiver's data is, from 1 to 8, or 0 (the default) if it has none.
+ *
+ *  When sent on a port whose usesCompressedFraming property is YES, a request's data is sent as
+ *  the changes from the last data sent with the same message type, if that's smaller. This suits
+ *  repetitive polling requests. The device must implement the same framing, and keeps the last
+ *  data received of each type to apply the changes to. If it can't, it asks for the next
+ *  request of that type to be sent whole. Responses can be encoded the same way.
+ *
+ *  @see -[ORSSerialPort usesCompressedFraming]
+ */
+@property (nonatomic, readonly) NSUInteger messageType;
+
 @end
 
 #pragma mark - Deprecated
@@ -0,0 +1,133 @@
+//
+//  ORSSerialBuffer_Tests.m
+//  ORSSerialPort
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 Open Reel Software. All rights reserved.
+//
+
+#import <Cocoa/Cocoa.h>
+#import <XCTest/XCTest.h>
+#import <ORSSerial/ORSSerial.h>
+#import "ORSSerialBuffer.h"
+
+#define ORSTStringToData_(x) [x dataUsingEncoding:NSASCIIStringEncoding]
+
+// Accepts any packet ending in "!", regardless of its prefix and suffix
+@interface ORSTExclamationPacketDescriptor : ORSSerialPacketDescriptor
+@end
+
+@implementation ORSTExclamationPacketDescriptor
+
+- (BOOL)dataIsValidPacket:(NSData *)packetData
+{
+	return [packetData length] && ((const uint8_t *)[packetData bytes])[[packetData length]-1] == '!';
+}
+
+@end
+
+@interface ORSSerialBuffer_Tests : XCTestCase
+
+@end
+
+@implementation ORSSerialBuffer_Tests
+
+- (void)testAppendingWithinMaximumLength
+{
+	ORSSerialBuffer *buffer = [[ORSSerialBuffer alloc] initWithMaximumLength:8];
+	XCTAssertEqual(buffer.length, (NSUInteger)0);
+	XCTAssertTrue([buffer bytes] == NULL, @"Empty buffer shouldn't have storage yet.");
+
+	[buffer appendData:ORSTStringToData_(@"abc")];
+	[buffer appendBytes:"de" length:2];
+	XCTAssertEqualObjects(buffer.data, ORSTStringToData_(@"abcde"));
+	XCTAssertEqual([buffer byteAtIndex:0], 'a');
+	XCTAssertEqual([buffer byteAtIndex:4], 'e');
+	XCTAssertThrows([buffer byteAtIndex:5], @"Reading past the end should raise.");
+
+	[buffer clearBuffer];
+	XCTAssertEqual(buffer.length, (NSUInteger)0);
+	XCTAssertEqualObjects(buffer.data, [NSData data]);
+}
+
+- (void)testOverflowKeepsNewestBytes
+{
+	ORSSerialBuffer *buffer = [[ORSSerialBuffer alloc] initWithMaximumLength:4];
+	[buffer appendData:ORSTStringToData_(@"abc")];
+	[buffer appendData:ORSTStringToData_(@"def")];
+	XCTAssertEqualObjects(buffer.data, ORSTStringToData_(@"cdef"));
+
+	// Appending more than maximumLength at once keeps only its end
+	[buffer appendData:ORSTStringToData_(@"0123456789")];
+	XCTAssertEqualObjects(buffer.data, ORSTStringToData_(@"6789"));
+	XCTAssertEqual(buffer.length, buffer.maximumLength);
+
+	ORSSerialBuffer *disabled = [[ORSSerialBuffer alloc] initWithMaximumLength:0];
+	[disabled appendData:ORSTStringToData_(@"abc")];
+	XCTAssertEqual(disabled.length, (NSUInteger)0, @"Buffer with maximumLength 0 shouldn't keep anything.");
+}
+
+// Appends chunks of varying sizes so storage slides and grows, comparing against a simple reference
+- (void)testSlidingWindowMatchesReference
+{
+	NSUInteger maximumLength = 100;
+	ORSSerialBuffer *buffer = [[ORSSerialBuffer alloc] initWithMaximumLength:maximumLength];
+	NSMutableData *reference = [NSMutableData data];
+	uint8_t value = 0;
+	for (NSUInteger i=0; i<1000; i++) {
+		NSUInteger chunkLength = (i * 7) % 37 + 1;
+		uint8_t chunk[64];
+		for (NSUInteger j=0; j<chunkLength; j++) chunk[j] = value++;
+		[buffer appendBytes:chunk length:chunkLength];
+
+		[reference appendBytes:chunk length:chunkLength];
+		if ([reference length] > maximumLength) {
+			[reference replaceBytesInRange:NSMakeRange(0, [reference length] - maximumLength) withBytes:NULL length:0];
+		}
+
+		XCTAssertEqualObjects(buffer.data, reference, @"Buffer diverged after %lu appends.", (unsigned long)i+1);
+		if (![buffer.data isEqualToData:reference]) break;
+	}
+	XCTAssertLessThanOrEqual(buffer.memoryFootprint, 4 * maximumLength, @"Storage grew past twice maximumLength.");
+}
+
+- (void)testLastBytes
+{
+	ORSSerialBuffer *buffer = [[ORSSerialBuffer alloc] initWithMaximumLength:6];
+	[buffer appendData:ORSTStringToData_(@"abcdefgh")];
+
+	XCTAssertEqual(memcmp([buffer lastBytes:3], "fgh", 3), 0);
+	XCTAssertEqual(memcmp([buffer lastBytes:6], "cdefgh", 6), 0);
+	XCTAssertEqualObjects([buffer dataWithLastBytes:2], ORSTStringToData_(@"gh"));
+	XCTAssertEqualObjects([buffer dataWithLastBytes:0], [NSData data]);
+	XCTAssertThrows([buffer lastBytes:7], @"Asking for more bytes than are buffered should raise.");
+}
+
+- (void)testPacketMatchingInBuffer
+{
+	ORSSerialBuffer *buffer = [[ORSSerialBuffer alloc] initWithMaximumLength:16];
+	[buffer appendData:ORSTStringToData_(@"xx!foo;")];
+
+	ORSSerialPacketDescriptor *descriptor = [[ORSSerialPacketDescriptor alloc] initWithPrefixString:@"!" suffixString:@";" maximumPacketLength:16 userInfo:nil];
+	XCTAssertEqualObjects([descriptor packetMatchingAtEndOfSerialBuffer:buffer], ORSTStringToData_(@"!foo;"));
+
+	ORSSerialPacketDescriptor *fixed = [[ORSSerialPacketDescriptor alloc] initWithPacketData:ORSTStringToData_(@"foo;") userInfo:nil];
+	XCTAssertEqualObjects([fixed packetMatchingAtEndOfSerialBuffer:buffer], ORSTStringToData_(@"foo;"));
+}
+
+// Subclasses overriding -dataIsValidPacket: must be consulted instead of matching the prefix and suffix directly
+- (void)testOverriddenPacketValidationIsUsed
+{
+	ORSSerialBuffer *buffer = [[ORSSerialBuffer alloc] initWithMaximumLength:16];
+	ORSTExclamationPacketDescriptor *descriptor = [[ORSTExclamationPacketDescriptor alloc] initWithPrefixString:@"<" suffixString:@">" maximumPacketLength:16 userInfo:nil];
+
+	[buffer appendData:ORSTStringToData_(@"<foo>")];
+	XCTAssertNil([descriptor packetMatchingAtEndOfSerialBuffer:buffer], @"Overridden -dataIsValidPacket: was bypassed.");
+	uint8_t lastByte = 0;
+	XCTAssertFalse([descriptor getLastPacketByte:&lastByte], @"Overridden -dataIsValidPacket: may accept any last byte.");
+
+	[buffer appendData:ORSTStringToData_(@"bar!")];
+	XCTAssertEqualObjects([descriptor packetMatchingAtEndOfSerialBuffer:buffer], ORSTStringToData_(@"!"));
+}
+
+@end
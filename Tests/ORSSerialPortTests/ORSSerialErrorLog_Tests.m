@@ -0,0 +1,157 @@
+//
+//  ORSSerialErrorLog_Tests.m
+//  ORSSerialPort
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 Open Reel Software. All rights reserved.
+//
+
+#import <Cocoa/Cocoa.h>
+#import <XCTest/XCTest.h>
+#import "ORSSerialErrorLog.h"
+
+#ifndef ORS_SERIAL_PORT_DISABLE_ERROR_LOG
+
+static NSString * const ORSTErrorLogTestPath = @"/dev/cu.ORSSerialErrorLogTest";
+
+@interface ORSSerialErrorLog_Tests : XCTestCase
+
+@property (nonatomic, strong) NSMutableArray *messages; // Guarded by @synchronized(messages)
+
+@end
+
+@implementation ORSSerialErrorLog_Tests
+
+- (void)setUp
+{
+	[super setUp];
+
+	// Drain anything left over from other tests before capturing messages
+	ORSSerialErrorLogFlush();
+	NSMutableArray *messages = [NSMutableArray array];
+	self.messages = messages;
+	ORSSerialErrorLogSetMessageHandler(^(NSString *message) {
+		@synchronized(messages) { [messages addObject:message]; }
+	});
+	ORSSerialErrorLogSetMaximumMessagesPerSecond(NSUIntegerMax);
+}
+
+- (void)tearDown
+{
+	ORSSerialErrorLogFlush();
+	ORSSerialErrorLogSetMessageHandler(nil);
+	ORSSerialErrorLogSetMaximumMessagesPerSecond(ORS_SERIAL_ERROR_LOG_MAXIMUM_MESSAGES_PER_SECOND);
+	self.messages = nil;
+	[super tearDown];
+}
+
+#pragma mark - Utilities
+
+// Error codes of the messages for errors recorded by the test, in the order they were logged
+- (NSArray *)loggedErrorCodes
+{
+	NSMutableArray *codes = [NSMutableArray array];
+	@synchronized(self.messages) {
+		for (NSString *message in self.messages) {
+			if ([message rangeOfString:ORSTErrorLogTestPath].location == NSNotFound) continue;
+			NSRange range = [message rangeOfString:@"(errno "];
+			if (range.location == NSNotFound) continue;
+			[codes addObject:@([[message substringFromIndex:NSMaxRange(range)] integerValue])];
+		}
+	}
+	return codes;
+}
+
+// Total of the counts in summary messages starting with prefix, e.g. @"ORSSerialPort dropped "
+static NSUInteger ORSTCountInSummaryMessages(NSArray *messages, NSString *prefix)
+{
+	NSUInteger count = 0;
+	for (NSString *message in messages) {
+		if ([message hasPrefix:prefix]) count += [[message substringFromIndex:[prefix length]] integerValue];
+	}
+	return count;
+}
+
+#pragma mark - Test Cases
+
+// Records several times the log's capacity in batches, so entries wrap around the ring
+- (void)testWraparound
+{
+	NSUInteger count = 3 * ORS_SERIAL_ERROR_LOG_CAPACITY;
+	NSUInteger batchLength = ORS_SERIAL_ERROR_LOG_CAPACITY / 2 + 1;
+	for (NSUInteger i=0; i<count; i++) {
+		ORS_LOG_SERIAL_PORT_ERROR(ORSSerialErrorLogOperationWrite, ORSTErrorLogTestPath, (int)i + 1);
+		if ((i + 1) % batchLength == 0) ORSSerialErrorLogFlush();
+	}
+	ORSSerialErrorLogFlush();
+
+	NSArray *codes = [self loggedErrorCodes];
+	XCTAssertEqual([codes count], count, @"Incorrect number of messages logged.");
+	for (NSUInteger i=0; i<MIN([codes count], count); i++) {
+		XCTAssertEqualObjects(codes[i], @(i + 1), @"Entry logged out of order, or twice.");
+		if (![codes[i] isEqual:@(i + 1)]) break;
+	}
+}
+
+- (void)testDroppedCountWhenFull
+{
+	// Hold up the drain in the middle of logging the first entry, so nothing else is drained
+	dispatch_semaphore_t drainBlocked = dispatch_semaphore_create(0);
+	dispatch_semaphore_t unblockDrain = dispatch_semaphore_create(0);
+	NSMutableArray *messages = self.messages;
+	__block BOOL blocked = NO;
+	ORSSerialErrorLogSetMessageHandler(^(NSString *message) {
+		@synchronized(messages) { [messages addObject:message]; }
+		if (blocked) return;
+		blocked = YES;
+		dispatch_semaphore_signal(drainBlocked);
+		dispatch_semaphore_wait(unblockDrain, DISPATCH_TIME_FOREVER);
+	});
+
+	ORS_LOG_SERIAL_PORT_ERROR(ORSSerialErrorLogOperationWrite, ORSTErrorLogTestPath, 1);
+	long timedOut = dispatch_semaphore_wait(drainBlocked, dispatch_time(DISPATCH_TIME_NOW, 5 * NSEC_PER_SEC));
+	XCTAssertEqual(timedOut, 0L, @"First entry was never drained.");
+
+	// The first entry's slot has been freed, so the whole ring is available
+	NSUInteger extraCount = 5;
+	for (NSUInteger i=0; i<ORS_SERIAL_ERROR_LOG_CAPACITY + extraCount; i++) {
+		ORS_LOG_SERIAL_PORT_ERROR(ORSSerialErrorLogOperationWrite, ORSTErrorLogTestPath, (int)i + 2);
+	}
+	dispatch_semaphore_signal(unblockDrain);
+	ORSSerialErrorLogFlush();
+
+	NSArray *codes = [self loggedErrorCodes];
+	XCTAssertEqual([codes count], (NSUInteger)ORS_SERIAL_ERROR_LOG_CAPACITY + 1, @"Incorrect number of messages logged.");
+	XCTAssertEqualObjects([codes lastObject], @(ORS_SERIAL_ERROR_LOG_CAPACITY + 1), @"Entries recorded while full weren't the ones dropped.");
+	@synchronized(messages) {
+		XCTAssertEqual(ORSTCountInSummaryMessages(messages, @"ORSSerialPort dropped "), extraCount, @"Incorrect dropped count.");
+	}
+}
+
+- (void)testSuppressionSummary
+{
+	NSUInteger maximum = 5, count = 12;
+	XCTestExpectation *summarized = [self expectationWithDescription:@"Every entry logged or summarized"];
+	NSMutableArray *messages = self.messages;
+	ORSSerialErrorLogSetMessageHandler(^(NSString *message) {
+		@synchronized(messages) {
+			[messages addObject:message];
+			if (ORSTCountInSummaryMessages(messages, @"ORSSerialPort suppressed ") + [[self loggedErrorCodes] count] == count) [summarized fulfill];
+		}
+	});
+	ORSSerialErrorLogSetMaximumMessagesPerSecond(maximum);
+
+	for (NSUInteger i=0; i<count; i++) {
+		ORS_LOG_SERIAL_PORT_ERROR(ORSSerialErrorLogOperationWrite, ORSTErrorLogTestPath, (int)i + 1);
+	}
+	ORSSerialErrorLogFlush();
+	XCTAssertGreaterThanOrEqual([[self loggedErrorCodes] count], maximum, @"Entries under the rate limit weren't logged.");
+	XCTAssertLessThan([[self loggedErrorCodes] count], count, @"Rate limit wasn't applied.");
+
+	// Suppressed entries are summarized once the current one second window has passed
+	[self waitForExpectationsWithTimeout:3.0 handler:nil];
+}
+
+@end
+
+#endif
@@ -16,6 +16,12 @@
 
 - (void)receiveData:(NSData *)data;
 
+#if OS_OBJECT_USE_OBJC
+@property (nonatomic, strong, readonly) dispatch_queue_t requestHandlingQueue;
+#else
+@property (nonatomic, readonly) dispatch_queue_t requestHandlingQueue;
+#endif
+
 @end
 
 @interface ORSSerialPacketDescriptor_Tests : XCTestCase <ORSSerialPortDelegate>
@@ -160,6 +166,26 @@
 	XCTAssertFalse([descriptor dataIsValidPacket:ORSTStringToData_(@"!foo;x")], @"Invalid packet not rejected by descriptor.");
 }
 
+- (void)testPacketMatchingAtEndOfBuffer
+{
+	ORSSerialPacketDescriptor *prefixSuffix = [self defaultPacketDescriptorWithUserInfo:nil];
+	XCTAssertEqualObjects([prefixSuffix packetMatchingAtEndOfBuffer:ORSTStringToData_(@"x!fo!bar;")], ORSTStringToData_(@"!bar;"), @"Shortest packet at end of buffer not matched.");
+	XCTAssertNil([prefixSuffix packetMatchingAtEndOfBuffer:ORSTStringToData_(@"!bar;x")], @"Packet not at end of buffer matched.");
+	XCTAssertNil([prefixSuffix packetMatchingAtEndOfBuffer:[NSData data]], @"Packet matched in empty buffer.");
+	
+	ORSSerialPacketDescriptor *fixed = [[ORSSerialPacketDescriptor alloc] initWithPacketData:ORSTStringToData_(@"OK") userInfo:nil];
+	XCTAssertEqualObjects([fixed packetMatchingAtEndOfBuffer:ORSTStringToData_(@"xxOK")], ORSTStringToData_(@"OK"), @"Fixed packet at end of buffer not matched.");
+	XCTAssertNil([fixed packetMatchingAtEndOfBuffer:ORSTStringToData_(@"K")], @"Partial fixed packet matched.");
+	
+	NSRegularExpression *regex = [NSRegularExpression regularExpressionWithPattern:@"^!.+;$" options:0 error:NULL];
+	ORSSerialPacketDescriptor *regexDescriptor = [[ORSSerialPacketDescriptor alloc] initWithRegularExpression:regex maximumPacketLength:20 userInfo:nil];
+	NSMutableData *buffer = [ORSTStringToData_(@"!foo;") mutableCopy];
+	NSData *match = [regexDescriptor packetMatchingAtEndOfBuffer:buffer];
+	XCTAssertEqualObjects(match, ORSTStringToData_(@"!foo;"), @"Regex packet at end of buffer not matched.");
+	[buffer resetBytesInRange:NSMakeRange(0, [buffer length])];
+	XCTAssertEqualObjects(match, ORSTStringToData_(@"!foo;"), @"Matched packet must not share storage with the buffer.");
+}
+
 - (void)testParsingWithLeadingBadData
 {
 	XCTestExpectation *expectation = [self expectationWithDescription:@"Leading bad data packet parsing expectation"];
@@ -271,6 +297,140 @@
 	}];
 }
 
+- (void)testMutuallyExclusiveDescriptors
+{
+	XCTestExpectation *expectation = [self expectationWithDescription:@"High priority descriptor matched"];
+	XCTestExpectation *unexpected = [self expectationWithDescription:@"Low priority descriptor matched consumed bytes"];
+	unexpected.inverted = YES;
+	
+	NSDictionary *userInfo1 = @{ORSTStringToData_(@"!foo;"): expectation};
+	NSDictionary *userInfo2 = @{ORSTStringToData_(@"foo;"): unexpected};
+	ORSSerialPacketDescriptor *descriptor1 = [self defaultPacketDescriptorWithUserInfo:userInfo1];
+	descriptor1.priority = 1;
+	// Completes on the same byte as descriptor1, so it only goes unmatched if exclusivity is honored
+	ORSSerialPacketDescriptor *descriptor2 = [[ORSSerialPacketDescriptor alloc] initWithPacketData:ORSTStringToData_(@"foo;")
+																						  userInfo:userInfo2];
+	self.port.packetDescriptorsAreMutuallyExclusive = YES;
+	[self.port startListeningForPacketsMatchingDescriptor:descriptor2];
+	[self.port startListeningForPacketsMatchingDescriptor:descriptor1];
+	
+	[self.port receiveData:ORSTStringToData_(@"!foo;")];
+	
+	[self waitForExpectationsWithTimeout:0.5 handler:^(NSError *error) {
+		if (error) {
+			NSLog(@"expectations failed: %@", error);
+		}
+	}];
+}
+
+- (void)testStartListeningForMultipleDescriptors
+{
+	XCTestExpectation *suffixExpectation = [self expectationWithDescription:@"Prefix/suffix descriptor matched"];
+	XCTestExpectation *dataExpectation = [self expectationWithDescription:@"Packet data descriptor matched"];
+	XCTestExpectation *regexExpectation = [self expectationWithDescription:@"Regex descriptor matched"];
+	
+	ORSSerialPacketDescriptor *suffixDescriptor = [self defaultPacketDescriptorWithUserInfo:@{ORSTStringToData_(@"!foo;"): suffixExpectation}];
+	ORSSerialPacketDescriptor *dataDescriptor = [[ORSSerialPacketDescriptor alloc] initWithPacketData:ORSTStringToData_(@"OK")
+																							 userInfo:@{ORSTStringToData_(@"OK"): dataExpectation}];
+	NSRegularExpression *regex = [NSRegularExpression regularExpressionWithPattern:@"^#[0-9]{3}$" options:0 error:NULL];
+	ORSSerialPacketDescriptor *regexDescriptor = [[ORSSerialPacketDescriptor alloc] initWithRegularExpression:regex
+																						   maximumPacketLength:4
+																									  userInfo:@{ORSTStringToData_(@"#123"): regexExpectation}];
+	NSArray *descriptors = @[suffixDescriptor, dataDescriptor, regexDescriptor];
+	
+	[self keyValueObservingExpectationForObject:self.port keyPath:@"packetDescriptors" expectedValue:descriptors];
+	[self.port startListeningForPacketsMatchingDescriptors:descriptors];
+	[self.port startListeningForPacketsMatchingDescriptors:@[dataDescriptor]]; // Already listening
+	XCTAssertEqualObjects(self.port.packetDescriptors, descriptors, @"-packetDescriptors did not return expected result.");
+	
+	[self.port receiveData:ORSTStringToData_(@"x!foo;yOKz#123")];
+	
+	[self waitForExpectationsWithTimeout:0.5 handler:^(NSError *error) {
+		if (error) {
+			NSLog(@"expectations failed: %@", error);
+		}
+	}];
+	
+	[self.port stopListeningForPacketsMatchingDescriptors:@[suffixDescriptor, regexDescriptor]];
+	XCTAssertEqualObjects(self.port.packetDescriptors, @[dataDescriptor], @"-packetDescriptors did not return expected result.");
+}
+
+// Descriptors started and stopped while received bytes are waiting on requestHandlingQueue apply
+// from the next byte matched, without waiting for the queued bytes.
+- (void)testSwappingDescriptorsWhileBytesAreQueued
+{
+	XCTestExpectation *startedMatched = [self expectationWithDescription:@"Descriptor started while bytes were queued matched"];
+	XCTestExpectation *laterMatched = [self expectationWithDescription:@"Descriptor started between queued bytes matched"];
+	XCTestExpectation *unexpected = [self expectationWithDescription:@"Stopped descriptor matched, or started descriptor matched bytes from before it was started"];
+	unexpected.inverted = YES;
+	
+	ORSSerialPacketDescriptor *stoppedDescriptor = [self defaultPacketDescriptorWithUserInfo:@{ORSTStringToData_(@"!foo;"): unexpected}];
+	ORSSerialPacketDescriptor *startedDescriptor = [[ORSSerialPacketDescriptor alloc] initWithPrefixString:@"<"
+																							  suffixString:@">"
+																					   maximumPacketLength:20
+																								  userInfo:@{ORSTStringToData_(@"<bar>"): startedMatched}];
+	ORSSerialPacketDescriptor *laterDescriptor = [[ORSSerialPacketDescriptor alloc] initWithPrefixString:@"["
+																							suffixString:@"]"
+																					 maximumPacketLength:20
+																								userInfo:@{ORSTStringToData_(@"[qux]"): laterMatched,
+																										   ORSTStringToData_(@"[baz]"): unexpected}];
+	[self.port startListeningForPacketsMatchingDescriptor:stoppedDescriptor];
+	
+	// Hold up requestHandlingQueue, so received bytes wait on it
+	dispatch_semaphore_t unblockQueue = dispatch_semaphore_create(0);
+	dispatch_async(self.port.requestHandlingQueue, ^{ dispatch_semaphore_wait(unblockQueue, DISPATCH_TIME_FOREVER); });
+	[self.port receiveData:ORSTStringToData_(@"!foo;<bar>[ba")];
+	
+	dispatch_semaphore_t swapped = dispatch_semaphore_create(0);
+	dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+		[self.port stopListeningForPacketsMatchingDescriptor:stoppedDescriptor];
+		[self.port startListeningForPacketsMatchingDescriptor:startedDescriptor];
+		dispatch_semaphore_signal(swapped);
+	});
+	long timedOut = dispatch_semaphore_wait(swapped, dispatch_time(DISPATCH_TIME_NOW, 2 * NSEC_PER_SEC));
+	XCTAssertEqual(timedOut, 0L, @"Swapping descriptors waited for queued bytes.");
+	XCTAssertEqualObjects(self.port.packetDescriptors, @[startedDescriptor], @"-packetDescriptors did not return expected result.");
+	
+	// Started after the first queued receive is matched, so only sees bytes from the second
+	dispatch_async(self.port.requestHandlingQueue, ^{ [self.port startListeningForPacketsMatchingDescriptor:laterDescriptor]; });
+	[self.port receiveData:ORSTStringToData_(@"z][qux]")];
+	dispatch_semaphore_signal(unblockQueue);
+	
+	[self waitForExpectationsWithTimeout:0.5 handler:^(NSError *error) {
+		if (error) {
+			NSLog(@"expectations failed: %@", error);
+		}
+	}];
+}
+
+- (void)testReceiveErrorsDiscardPartialPackets
+{
+	XCTestExpectation *expectation = [self expectationWithDescription:@"Packet after break matched"];
+	XCTestExpectation *unexpected = [self expectationWithDescription:@"Packet with error or break matched"];
+	unexpected.inverted = YES;
+	
+	NSDictionary *userInfo = @{ORSTStringToData_(@"!bar;"): expectation,
+							   ORSTStringToData_(@"!foXo;"): unexpected,
+							   ORSTStringToData_(@"!baz;"): unexpected};
+	[self.port startListeningForPacketsMatchingDescriptor:[self defaultPacketDescriptorWithUserInfo:userInfo]];
+	self.port.marksReceiveErrors = YES;
+	
+	// "X" received with a parity error, then a break between "!ba" and "z;"
+	const uint8_t bytes[] = {'!', 'f', 'o', 0xFF, 0x00, 'X', 'o', ';', '!', 'b', 'a', 0xFF, 0x00, 0x00, 'z', ';', '!', 'b', 'a', 'r', ';'};
+	[self.port receiveData:[NSData dataWithBytes:bytes length:sizeof(bytes)]];
+	
+	[self waitForExpectationsWithTimeout:0.5 handler:^(NSError *error) {
+		if (error) {
+			NSLog(@"expectations failed: %@", error);
+		}
+	}];
+	
+	ORSSerialPortStatistics *statistics = self.port.statistics;
+	XCTAssertEqual(statistics.receiveErrorCount, 1ULL, @"Incorrect receive error count.");
+	XCTAssertEqual(statistics.breakCount, 1ULL, @"Incorrect break count.");
+	XCTAssertEqual(statistics.receivedByteCount, 16ULL, @"Error marks counted as received bytes.");
+}
+
 - (void)testPacketDescriptorsPropertyAdd
 {
 	XCTAssertNotNil(self.port.packetDescriptors, @"-[ORSSerialPort packetDescriptors] returned nil.");
@@ -303,6 +463,26 @@
 	}];
 }
 
+- (void)testPacketStatistics
+{
+	ORSSerialPacketDescriptor *descriptor = [self defaultPacketDescriptorWithUserInfo:nil];
+	XCTAssertNil([self.port statisticsForPacketDescriptor:descriptor], @"Statistics returned for descriptor that isn't installed.");
+	
+	[self.port startListeningForPacketsMatchingDescriptor:descriptor];
+	ORSSerialPacketStatistics *statistics = [self.port statisticsForPacketDescriptor:descriptor];
+	XCTAssertEqual(statistics.packetCount, 0, @"Statistics for new descriptor not empty.");
+	XCTAssertEqual(statistics.recommendedMaximumPacketLength, descriptor.maximumPacketLength, @"Recommended length without packets should be descriptor's maximum.");
+	
+	[self.port receiveData:ORSTStringToData_(@"!a;xx!bcd;")];
+	statistics = [self.port statisticsForPacketDescriptor:descriptor];
+	XCTAssertEqual(statistics.packetCount, 2, @"Incorrect packet count.");
+	XCTAssertEqual(statistics.minimumPacketLength, 3, @"Incorrect minimum packet length.");
+	XCTAssertEqual(statistics.maximumPacketLength, 5, @"Incorrect maximum packet length.");
+	XCTAssertEqualWithAccuracy(statistics.averagePacketLength, 4.0, 0.001, @"Incorrect average packet length.");
+	XCTAssertTrue(statistics.recommendedMaximumPacketLength >= 5, @"Recommended length shorter than received packets.");
+	XCTAssertTrue(statistics.recommendedMaximumPacketLength <= descriptor.maximumPacketLength, @"Recommended length longer than descriptor's maximum.");
+}
+
 #pragma mark - Performance
 
 - (void)testPerformanceWithMultipleInstalledDescriptors
@@ -0,0 +1,117 @@
+//
+//  ORSSerialPacketMatcher_Tests.m
+//  ORSSerialPort
+//
+//  Created by agent on 10/18/26.
+//  Copyright (c) 2026 Open Reel Software. All rights reserved.
+//
+
+#import <Cocoa/Cocoa.h>
+#import <XCTest/XCTest.h>
+#import <ORSSerial/ORSSerial.h>
+#import "ORSSerialPacketMatcher.h"
+
+#define ORSTStringToData_(x) [x dataUsingEncoding:NSASCIIStringEncoding]
+
+// Matches more than the matcher's tuning sample count, so tuning has settled
+static const NSUInteger ORSTTuningPacketCount = 40;
+
+@interface ORSSerialPacketMatcher_Tests : XCTestCase
+
+@property (nonatomic, strong) ORSSerialPacketMatcher *matcher;
+@property (nonatomic, strong) ORSSerialPacketDescriptor *descriptor;
+@property (nonatomic, strong) NSMutableArray *packets;
+
+@end
+
+@implementation ORSSerialPacketMatcher_Tests
+
+- (void)setUp
+{
+	[super setUp];
+	self.descriptor = [[ORSSerialPacketDescriptor alloc] initWithPrefixString:@"!" suffixString:@";" maximumPacketLength:1024 userInfo:nil];
+	self.matcher = [[ORSSerialPacketMatcher alloc] init];
+	self.matcher.automaticallyTunesBufferLength = YES;
+	[self.matcher addPacketDescriptor:self.descriptor];
+	self.packets = [NSMutableArray array];
+}
+
+- (void)tearDown
+{
+	self.matcher = nil;
+	self.descriptor = nil;
+	self.packets = nil;
+	[super tearDown];
+}
+
+#pragma mark - Utilities
+
+- (void)appendString:(NSString *)string
+{
+	NSData *data = ORSTStringToData_(string);
+	const uint8_t *bytes = [data bytes];
+	NSMutableArray *packets = self.packets;
+	for (NSUInteger i=0; i<[data length]; i++) {
+		[self.matcher appendByte:bytes[i] matchHandler:^(ORSSerialPacketDescriptor *descriptor, NSData *packet) {
+			[packets addObject:packet];
+		}];
+	}
+}
+
+// A packet for self.descriptor, length bytes long
+- (NSString *)packetOfLength:(NSUInteger)length
+{
+	return [NSString stringWithFormat:@"!%@;", [@"" stringByPaddingToLength:length - 2 withString:@"x" startingAtIndex:0]];
+}
+
+- (void)appendTuningPackets
+{
+	for (NSUInteger i=0; i<ORSTTuningPacketCount; i++) [self appendString:@"!foo;"];
+}
+
+#pragma mark - Test Cases
+
+- (void)testTuningShrinksBuffer
+{
+	XCTAssertEqual(self.matcher.bufferLength, (NSUInteger)0, @"Buffer allocated before any bytes were received.");
+	[self appendString:@"!foo;"];
+	XCTAssertEqual(self.matcher.bufferLength, self.descriptor.maximumPacketLength, @"Buffer not sized for the declared maximum before tuning.");
+
+	[self appendTuningPackets];
+	XCTAssertEqual([self.packets count], ORSTTuningPacketCount + 1, @"Packets missed while tuning.");
+	NSUInteger recommendedLength = [self.matcher statisticsForPacketDescriptor:self.descriptor].recommendedMaximumPacketLength;
+	XCTAssertLessThan(recommendedLength, self.descriptor.maximumPacketLength, @"Recommended length not tuned.");
+	XCTAssertLessThanOrEqual(self.matcher.bufferLength, 2 * recommendedLength, @"Buffer didn't shrink after tuning.");
+
+	// Matching still works with the tuned buffer, including when there's junk between packets
+	[self.packets removeAllObjects];
+	[self appendString:@"junk!bar;morejunk!baz;"];
+	XCTAssertEqualObjects(self.packets, (@[ORSTStringToData_(@"!bar;"), ORSTStringToData_(@"!baz;")]), @"Packets missed after tuning.");
+}
+
+- (void)testLongerPacketAfterTuning
+{
+	[self appendTuningPackets];
+	NSUInteger tunedLength = self.matcher.bufferLength;
+
+	// Fits in the room kept for longer packets, so is matched straight away
+	[self.packets removeAllObjects];
+	NSString *longerPacket = [self packetOfLength:tunedLength];
+	[self appendString:longerPacket];
+	XCTAssertEqualObjects(self.packets, @[ORSTStringToData_(longerPacket)], @"Longer packet after tuning wasn't matched.");
+
+	// Far longer than anything seen. The room kept grows until it fits, then it's matched every time.
+	NSString *muchLongerPacket = [self packetOfLength:self.descriptor.maximumPacketLength];
+	NSUInteger attempts = 0;
+	[self.packets removeAllObjects];
+	while (![self.packets count] && attempts++ < 16) [self appendString:muchLongerPacket];
+	XCTAssertEqualObjects(self.packets, @[ORSTStringToData_(muchLongerPacket)], @"Room for longer packets never grew.");
+	XCTAssertEqual(self.matcher.bufferLength, self.descriptor.maximumPacketLength, @"Buffer didn't grow for the longer packet.");
+
+	[self.packets removeAllObjects];
+	[self appendString:muchLongerPacket];
+	[self appendString:@"!foo;"];
+	XCTAssertEqualObjects(self.packets, (@[ORSTStringToData_(muchLongerPacket), ORSTStringToData_(@"!foo;")]), @"Packets missed after growing.");
+}
+
+@end
@@ -8,11 +8,778 @@
 
 #import <Cocoa/Cocoa.h>
 #import <XCTest/XCTest.h>
+#import <ORSSerial/ORSSerial.h>
+#import "ORSSerialPortDiscovery.h"
+#import "ORSSerialPortMonitor.h"
+#import "ORSSerialTransmitPacer.h"
+#import <util.h>
+#import <poll.h>
+#import <libproc.h>
+#import <mach/mach_time.h>
 
-@interface ORSSerialPort_Tests : XCTestCase
+// Enough for the tests that use several ports. Tests of many ports at once add more.
+static const NSUInteger ORSTPseudoTerminalCount = 4;
+static const NSUInteger ORSTFleetPseudoTerminalCount = 64;
+
+@interface ORSSerialPort (Private)
+
+@property (atomic, readonly) BOOL RS485TransmitterEnabled;
+
+#if OS_OBJECT_USE_OBJC
+@property (nonatomic, strong, readonly) dispatch_source_t readPollSource;
+#else
+@property (nonatomic, readonly) dispatch_source_t readPollSource;
+#endif
+
+@end
+
+@interface ORSSerialPort_Tests : XCTestCase <ORSSerialPortDelegate>
+
+@property (nonatomic, strong) NSMutableArray *ports;
+@property (nonatomic, strong) NSMutableArray *masterFileDescriptors;
+
+@property (nonatomic, strong) NSMutableData *receivedData;
+@property (nonatomic, strong) XCTestExpectation *receivedDataExpectation;
+
+@property (nonatomic, strong) NSMutableArray *receiveBacklogWarnings;
+@property (nonatomic, strong) XCTestExpectation *receiveBacklogWarningExpectation;
+
+@property (atomic) BOOL isOpenChangedOffMainThread;
 
 @end
 
 @implementation ORSSerialPort_Tests
 
+- (void)setUp
+{
+	[super setUp];
+	
+	self.ports = [NSMutableArray array];
+	self.masterFileDescriptors = [NSMutableArray array];
+	[self addPseudoTerminalsUpToCount:ORSTPseudoTerminalCount];
+}
+
+- (void)tearDown
+{
+	for (ORSSerialPort *port in self.ports) [port close];
+	self.ports = nil;
+	for (NSNumber *master in self.masterFileDescriptors) close([master intValue]);
+	self.masterFileDescriptors = nil;
+	self.receivedData = nil;
+	self.receivedDataExpectation = nil;
+	self.receiveBacklogWarnings = nil;
+	self.receiveBacklogWarningExpectation = nil;
+	[super tearDown];
+}
+
+#pragma mark - Utilities
+
+// Reads whatever is available from descriptor, waiting up to timeout for something to arrive.
+// Returns 0 if nothing arrived in time, so a missing byte fails the test instead of hanging it.
+static ssize_t ORSTReadWithTimeout(int descriptor, void *buffer, size_t length, NSTimeInterval timeout)
+{
+	struct pollfd pollDescriptor = { .fd = descriptor, .events = POLLIN };
+	if (poll(&pollDescriptor, 1, (int)(timeout * 1000)) != 1) return 0;
+	return read(descriptor, buffer, length);
+}
+
+// Pseudo terminals stand in for real serial ports. The master side of each is kept open
+// until the test finishes so the slave side can be opened by ORSSerialPort.
+- (void)addPseudoTerminalsUpToCount:(NSUInteger)count
+{
+	while ([self.ports count] < count) {
+		int master = 0, slave = 0;
+		char name[128];
+		if (openpty(&master, &slave, name, NULL, NULL) != 0) break;
+		close(slave);
+		[self.masterFileDescriptors addObject:@(master)];
+		[self.ports addObject:[[ORSSerialPort alloc] initWithDevicelessPath:@(name)]];
+	}
+}
+
+// The shared manager, with ports standing in for its available ports until the test finishes,
+// even if it fails part way through
+- (ORSSerialPortManager *)sharedManagerWithAvailablePorts:(NSArray *)ports
+{
+	ORSSerialPortManager *manager = [ORSSerialPortManager sharedSerialPortManager];
+	NSArray *availablePorts = manager.availablePorts;
+	[manager setValue:ports forKey:@"availablePorts"];
+	[self addTeardownBlock:^{ [manager setValue:availablePorts forKey:@"availablePorts"]; }];
+	return manager;
+}
+
+#pragma mark - ORSSerialPortDelegate
+
+- (void)serialPortWasRemovedFromSystem:(ORSSerialPort *)serialPort {}
+
+- (void)serialPort:(ORSSerialPort *)serialPort didReceiveData:(NSData *)data
+{
+	[self.receivedData appendData:data];
+	[self.receivedDataExpectation fulfill];
+	self.receivedDataExpectation = nil;
+}
+
+- (void)serialPort:(ORSSerialPort *)serialPort receiveBacklogDidExceedThreshold:(NSUInteger)byteCount
+{
+	[self.receiveBacklogWarnings addObject:@(byteCount)];
+	[self.receiveBacklogWarningExpectation fulfill];
+}
+
+#pragma mark - Key Value Observing
+
+- (void)observeValueForKeyPath:(NSString *)keyPath ofObject:(id)object change:(NSDictionary *)change context:(void *)context
+{
+	if ([keyPath isEqualToString:@"isOpen"] && ![NSThread isMainThread]) self.isOpenChangedOffMainThread = YES;
+}
+
+#pragma mark - Test Cases
+
+- (void)testOpenAndCloseWithCompletionHandler
+{
+	ORSSerialPort *port = [self.ports firstObject];
+	XCTAssertNotNil(port, @"Unable to create pseudo terminal.");
+	
+	XCTestExpectation *opened = [self expectationWithDescription:@"Port opened"];
+	[port openWithCompletionHandler:^(NSError *error) {
+		XCTAssertNil(error, @"Opening port failed: %@", error);
+		XCTAssertTrue(port.isOpen, @"Port not open in open completion handler.");
+		[opened fulfill];
+	}];
+	[self waitForExpectationsWithTimeout:1.0 handler:nil];
+	
+	XCTestExpectation *closed = [self expectationWithDescription:@"Port closed"];
+	[port closeWithCompletionHandler:^(NSError *error) {
+		XCTAssertNil(error, @"Closing port failed: %@", error);
+		XCTAssertFalse(port.isOpen, @"Port still open in close completion handler.");
+		[closed fulfill];
+	}];
+	[self waitForExpectationsWithTimeout:1.0 handler:nil];
+}
+
+- (void)testTransmitCompletionHandler
+{
+	ORSSerialPort *port = [self.ports firstObject];
+	[port open];
+	XCTAssertTrue(port.isOpen, @"Unable to open pseudo terminal.");
+	
+	XCTestExpectation *transmitted = [self expectationWithDescription:@"Data transmitted"];
+	NSDate *sendDate = [NSDate date];
+	NSData *data = [@"hello" dataUsingEncoding:NSASCIIStringEncoding];
+	BOOL success = [port sendData:data transmitCompletionHandler:^(NSDate *transmitDate, NSError *error) {
+		XCTAssertNil(error, @"Waiting for transmission failed: %@", error);
+		XCTAssertTrue([transmitDate timeIntervalSinceDate:sendDate] >= 0, @"Data transmitted before it was sent.");
+		[transmitted fulfill];
+	}];
+	XCTAssertTrue(success, @"Sending data failed.");
+	
+	// Drain the other end of the pseudo terminal so transmission can finish
+	char buffer[16];
+	ssize_t length = read([[self.masterFileDescriptors firstObject] intValue], buffer, sizeof(buffer));
+	XCTAssertEqual(length, (ssize_t)[data length], @"Incorrect number of bytes transmitted.");
+	
+	[self waitForExpectationsWithTimeout:1.0 handler:nil];
+	XCTAssertEqual(port.statistics.sentByteCount, (unsigned long long)[data length], @"Incorrect sent byte count.");
+}
+
+- (void)testTransmitRateLimit
+{
+	ORSSerialPort *port = [self.ports firstObject];
+	[port open];
+	XCTAssertTrue(port.isOpen, @"Unable to open pseudo terminal.");
+	
+	double rate = 1000.0;
+	port.maximumTransmitRate = rate;
+	NSMutableData *data = [NSMutableData dataWithLength:200];
+	
+	// The pacer can't finish writing until the schedule allows it, so its completion handler
+	// only runs before -sendData: returns if sending blocked until the data was written
+	XCTestExpectation *transmitted = [self expectationWithDescription:@"Data transmitted"];
+	__block BOOL transmittedBeforeReturning = NO;
+	__block BOOL returned = NO;
+	NSTimeInterval sendTime = [[NSProcessInfo processInfo] systemUptime];
+	XCTAssertTrue([port sendData:data transmitCompletionHandler:^(NSDate *transmitDate, NSError *error) {
+		@synchronized(self) { transmittedBeforeReturning = !returned; }
+		[transmitted fulfill];
+	}], @"Sending data failed.");
+	@synchronized(self) { returned = YES; }
+	
+	// By any time, at most a full burst plus what's accumulated since sending may have been written
+	int master = [[self.masterFileDescriptors firstObject] intValue];
+	double burstLength = rate * ORSSerialTransmitPacerBurstInterval;
+	ssize_t totalLength = 0;
+	while (totalLength < (ssize_t)[data length]) {
+		char buffer[256];
+		ssize_t length = ORSTReadWithTimeout(master, buffer, sizeof(buffer), 2.0);
+		if (length <= 0) break;
+		totalLength += length;
+		NSTimeInterval elapsed = [[NSProcessInfo processInfo] systemUptime] - sendTime;
+		XCTAssertLessThanOrEqual((double)totalLength, burstLength + rate * elapsed + 1.0, @"Data transmitted faster than the rate limit.");
+	}
+	XCTAssertEqual(totalLength, (ssize_t)[data length], @"Incorrect number of bytes transmitted.");
+	
+	[self waitForExpectationsWithTimeout:2.0 handler:nil];
+	@synchronized(self) {
+		XCTAssertFalse(transmittedBeforeReturning, @"Sending paced data blocked until it was transmitted.");
+	}
+}
+
+- (void)testTransmitCompletionHandlerCalledWhenQueuedDataIsDiscarded
+{
+	ORSSerialPort *port = [self.ports firstObject];
+	[port open];
+	XCTAssertTrue(port.isOpen, @"Unable to open pseudo terminal.");
+	
+	port.maximumTransmitRate = 100.0;
+	XCTestExpectation *cancelled = [self expectationWithDescription:@"Transmit completion handler called"];
+	BOOL success = [port sendData:[NSMutableData dataWithLength:1000] transmitCompletionHandler:^(NSDate *transmitDate, NSError *error) {
+		XCTAssertNil(transmitDate, @"Discarded data reported as transmitted.");
+		XCTAssertEqual(error.code, (NSInteger)ECANCELED, @"Incorrect error for discarded data: %@", error);
+		[cancelled fulfill];
+	}];
+	XCTAssertTrue(success, @"Queueing data failed.");
+	[port close];
+	
+	[self waitForExpectationsWithTimeout:1.0 handler:nil];
+}
+
+- (void)testRS485DirectionControl
+{
+	ORSSerialPort *port = [self.ports firstObject];
+	port.delegate = self;
+	port.usesRS485DirectionControl = YES;
+	port.RS485DelayBeforeSend = 0.2;
+	port.RS485DelayAfterSend = 0.05;
+	[port open];
+	XCTAssertTrue(port.isOpen, @"Unable to open pseudo terminal.");
+	self.receivedData = [NSMutableData data];
+	
+	// Observed rather than polled, since the bus is only driven for a fraction of a second
+	XCTestExpectation *driven = [self keyValueObservingExpectationForObject:port keyPath:@"RS485TransmitterEnabled" expectedValue:@YES];
+	XCTestExpectation *transmitted = [self expectationWithDescription:@"Data transmitted"];
+	NSData *data = [@"request" dataUsingEncoding:NSASCIIStringEncoding];
+	NSTimeInterval sendTime = [[NSProcessInfo processInfo] systemUptime];
+	XCTAssertTrue([port sendData:data transmitCompletionHandler:^(NSDate *transmitDate, NSError *error) {
+		[transmitted fulfill];
+	}], @"Sending data failed.");
+	
+	// Pseudo terminals don't support RTS, but still get sent data. Bytes received while the
+	// bus is driven, which the transceiver would echo back, are discarded. The bus is driven
+	// for at least RS485DelayBeforeSend before the request is written.
+	int master = [[self.masterFileDescriptors firstObject] intValue];
+	[self waitForExpectations:@[driven] timeout:1.0];
+	write(master, "echo", 4);
+	
+	char buffer[16];
+	ssize_t length = ORSTReadWithTimeout(master, buffer, sizeof(buffer), 2.0);
+	XCTAssertEqual(length, (ssize_t)[data length], @"Incorrect number of bytes transmitted.");
+	XCTAssertGreaterThanOrEqual([[NSProcessInfo processInfo] systemUptime] - sendTime, port.RS485DelayBeforeSend, @"Request written before the transmitter was ready.");
+	[self waitForExpectationsWithTimeout:1.0 handler:nil];
+	
+	// Replies are only received once the bus has been released after RS485DelayAfterSend
+	[self expectationForPredicate:[NSPredicate predicateWithFormat:@"RS485TransmitterEnabled == NO"] evaluatedWithObject:port handler:nil];
+	[self waitForExpectationsWithTimeout:1.0 handler:nil];
+	self.receivedDataExpectation = [self expectationWithDescription:@"Reply received"];
+	write(master, "reply", 5);
+	[self waitForExpectationsWithTimeout:1.0 handler:nil];
+	XCTAssertEqualObjects(self.receivedData, [@"reply" dataUsingEncoding:NSASCIIStringEncoding], @"Local echo not discarded.");
+}
+
+- (void)testLocalEchoSuppression
+{
+	ORSSerialPort *port = [self.ports firstObject];
+	port.delegate = self;
+	port.suppressesLocalEcho = YES;
+	[port open];
+	XCTAssertTrue(port.isOpen, @"Unable to open pseudo terminal.");
+	self.receivedData = [NSMutableData data];
+	
+	XCTAssertTrue([port sendData:[@"ping" dataUsingEncoding:NSASCIIStringEncoding]], @"Sending data failed.");
+	int master = [[self.masterFileDescriptors firstObject] intValue];
+	char buffer[16];
+	XCTAssertEqual(read(master, buffer, sizeof(buffer)), (ssize_t)4, @"Incorrect number of bytes transmitted.");
+	
+	// Echo with one corrupted byte, followed by a reply
+	self.receivedDataExpectation = [self expectationWithDescription:@"Reply received"];
+	write(master, "pinXpong", 8);
+	[self waitForExpectationsWithTimeout:1.0 handler:nil];
+	
+	XCTAssertEqualObjects(self.receivedData, [@"pong" dataUsingEncoding:NSASCIIStringEncoding], @"Local echo not removed.");
+	ORSSerialPortStatistics *statistics = port.statistics;
+	XCTAssertEqual(statistics.echoedByteCount, 4ULL, @"Incorrect echoed byte count.");
+	XCTAssertEqual(statistics.echoMismatchCount, 1ULL, @"Incorrect echo mismatch count.");
+	XCTAssertEqual(statistics.receivedByteCount, 4ULL, @"Echo counted as received.");
+}
+
+- (void)testCompressedFraming
+{
+	ORSSerialPort *sender = self.ports[0];
+	ORSSerialPort *receiver = self.ports[1];
+	sender.usesCompressedFraming = YES;
+	receiver.usesCompressedFraming = YES;
+	receiver.delegate = self;
+	[sender open];
+	[receiver open];
+	XCTAssertTrue(sender.isOpen && receiver.isOpen, @"Unable to open pseudo terminals.");
+	self.receivedData = [NSMutableData data];
+	
+	NSMutableString *string = [NSMutableString string];
+	for (NSUInteger i=0; i<60; i++) [string appendFormat:@"reading %lu OK\r\n", (unsigned long)i % 10];
+	NSData *payload = [string dataUsingEncoding:NSASCIIStringEncoding];
+	XCTAssertTrue([sender sendData:payload], @"Sending data failed.");
+	
+	int senderMaster = [self.masterFileDescriptors[0] intValue];
+	int receiverMaster = [self.masterFileDescriptors[1] intValue];
+	char buffer[4096];
+	ssize_t frameLength = read(senderMaster, buffer, sizeof(buffer));
+	XCTAssertGreaterThan(frameLength, 0, @"Nothing transmitted.");
+	XCTAssertLessThan(frameLength, (ssize_t)[payload length] / 2, @"Payload not compressed.");
+	
+	// A corrupted copy of the frame should be discarded, and the intact one decoded
+	self.receivedDataExpectation = [self expectationWithDescription:@"Payload received"];
+	char corrupted[4096];
+	memcpy(corrupted, buffer, frameLength);
+	corrupted[frameLength / 2] ^= 0x55;
+	write(receiverMaster, corrupted, frameLength);
+	write(receiverMaster, buffer, frameLength);
+	[self waitForExpectationsWithTimeout:1.0 handler:nil];
+	
+	XCTAssertEqualObjects(self.receivedData, payload, @"Incorrect payload decoded.");
+	XCTAssertEqual(receiver.statistics.discardedFrameCount, 1ULL, @"Corrupted frame not discarded.");
+}
+
+- (void)testDeltaEncodedRequests
+{
+	ORSSerialPort *sender = self.ports[0];
+	ORSSerialPort *receiver = self.ports[1];
+	ORSSerialPort *unsynchronizedReceiver = self.ports[2];
+	for (ORSSerialPort *port in @[sender, receiver, unsynchronizedReceiver]) {
+		port.usesCompressedFraming = YES;
+		[port open];
+		XCTAssertTrue(port.isOpen, @"Unable to open pseudo terminal.");
+	}
+	receiver.delegate = self;
+	self.receivedData = [NSMutableData data];
+	int senderMaster = [self.masterFileDescriptors[0] intValue];
+	int receiverMaster = [self.masterFileDescriptors[1] intValue];
+	int unsynchronizedMaster = [self.masterFileDescriptors[2] intValue];
+	
+	char frames[3][256];
+	ssize_t frameLengths[3];
+	NSArray *polls = @[@"POLL 0001 STATUS TEMPERATURE HUMIDITY", @"POLL 0002 STATUS TEMPERATURE HUMIDITY", @"POLL 0003 STATUS TEMPERATURE HUMIDITY"];
+	for (NSUInteger i=0; i<2; i++) {
+		NSData *data = [polls[i] dataUsingEncoding:NSASCIIStringEncoding];
+		[sender sendRequest:[ORSSerialRequest requestWithDataToSend:data userInfo:nil timeoutInterval:-1 responseDescriptor:nil messageType:1]];
+		frameLengths[i] = read(senderMaster, frames[i], sizeof(frames[i]));
+		
+		self.receivedDataExpectation = [self expectationWithDescription:@"Request received"];
+		write(receiverMaster, frames[i], frameLengths[i]);
+		[self waitForExpectationsWithTimeout:1.0 handler:nil];
+	}
+	XCTAssertLessThan(frameLengths[1], frameLengths[0] / 2, @"Request not delta encoded.");
+	XCTAssertEqualObjects(self.receivedData, [[polls[0] stringByAppendingString:polls[1]] dataUsingEncoding:NSASCIIStringEncoding], @"Incorrect requests decoded.");
+	
+	// A receiver without the previous request should ask for the next one to be sent whole
+	write(unsynchronizedMaster, frames[1], frameLengths[1]);
+	struct pollfd pollDescriptor = { .fd = unsynchronizedMaster, .events = POLLIN };
+	XCTAssertEqual(poll(&pollDescriptor, 1, 1000), 1, @"Resync not requested.");
+	char resync[64];
+	write(senderMaster, resync, read(unsynchronizedMaster, resync, sizeof(resync)));
+	[NSThread sleepForTimeInterval:0.1];
+	
+	[sender sendRequest:[ORSSerialRequest requestWithDataToSend:[polls[2] dataUsingEncoding:NSASCIIStringEncoding] userInfo:nil timeoutInterval:-1 responseDescriptor:nil messageType:1]];
+	frameLengths[2] = read(senderMaster, frames[2], sizeof(frames[2]));
+	XCTAssertEqual(frameLengths[2], frameLengths[0], @"Request not sent whole after resync.");
+	XCTAssertEqual(unsynchronizedReceiver.statistics.discardedFrameCount, 1ULL, @"Undecodable delta not counted.");
+}
+
+- (void)testTraceRecording
+{
+	ORSSerialPortTraceRecorder *recorder = [ORSSerialPortTraceRecorder sharedTraceRecorder];
+	[recorder startRecording];
+	XCTAssertTrue(recorder.isRecording, @"Recording didn't start.");
+	
+	ORSSerialPort *port = [self.ports firstObject];
+	port.delegate = self;
+	[port open];
+	XCTAssertTrue(port.isOpen, @"Unable to open pseudo terminal.");
+	self.receivedData = [NSMutableData data];
+	
+	ORSSerialPacketDescriptor *descriptor = [[ORSSerialPacketDescriptor alloc] initWithPacketData:[@"OK" dataUsingEncoding:NSASCIIStringEncoding] userInfo:nil];
+	ORSSerialRequest *request = [ORSSerialRequest requestWithDataToSend:[@"ID?" dataUsingEncoding:NSASCIIStringEncoding]
+															   userInfo:nil
+														timeoutInterval:1.0
+													 responseDescriptor:descriptor];
+	XCTAssertTrue([port sendRequest:request], @"Sending request failed.");
+	int master = [[self.masterFileDescriptors firstObject] intValue];
+	char buffer[16];
+	XCTAssertEqual(read(master, buffer, sizeof(buffer)), (ssize_t)3, @"Incorrect number of bytes transmitted.");
+	self.receivedDataExpectation = [self expectationWithDescription:@"Response received"];
+	write(master, "OK", 2);
+	[self waitForExpectationsWithTimeout:1.0 handler:nil];
+	[NSThread sleepForTimeInterval:0.1]; // Let the response be matched
+	
+	NSData *trace = [recorder stopRecording];
+	XCTAssertFalse(recorder.isRecording, @"Recording didn't stop.");
+	NSDictionary *traceObject = trace ? [NSJSONSerialization JSONObjectWithData:trace options:0 error:NULL] : nil;
+	NSArray *events = traceObject[@"traceEvents"];
+	XCTAssertGreaterThan([events count], 0, @"No events recorded.");
+	
+	NSMutableSet *names = [NSMutableSet set];
+	for (NSDictionary *event in events) [names addObject:[NSString stringWithFormat:@"%@ %@", event[@"ph"], event[@"name"]]];
+	for (NSString *name in @[@"M process_name", @"i Read", @"i Request Sent", @"b Request", @"e Request", @"b Write", @"b Delegate Dispatch"]) {
+		XCTAssertTrue([names containsObject:name], @"No %@ event recorded.", name);
+	}
+}
+
+- (void)testMemoryFootprint
+{
+	ORSSerialPort *port = self.ports[0];
+	NSUInteger initialFootprint = port.memoryFootprint;
+	XCTAssertGreaterThan(initialFootprint, (NSUInteger)0, @"Port's own memory wasn't counted.");
+	
+	ORSSerialPacketDescriptor *descriptor = [[ORSSerialPacketDescriptor alloc] initWithPrefixString:@"!" suffixString:@";" maximumPacketLength:64 userInfo:nil];
+	[port startListeningForPacketsMatchingDescriptor:descriptor];
+	XCTAssertGreaterThan(port.memoryFootprint, initialFootprint, @"Packet matching state wasn't counted.");
+	[port stopListeningForPacketsMatchingDescriptor:descriptor];
+}
+
+// The warning is sent once each time the backlog rises above the threshold, not for every sample above it
+- (void)testReceiveBacklogWarnings
+{
+	ORSSerialPort *port = [self.ports firstObject];
+	port.delegate = self;
+	port.receiveBacklogWarningThreshold = 64;
+	port.monitorsReceiveBacklog = YES;
+	[port open];
+	XCTAssertTrue(port.isOpen, @"Unable to open pseudo terminal.");
+	self.receiveBacklogWarnings = [NSMutableArray array];
+	int master = [[self.masterFileDescriptors firstObject] intValue];
+	dispatch_source_t readPollSource = port.readPollSource;
+	NSUInteger crossingCount = 2;
+	
+	for (NSUInteger i=0; i<crossingCount; i++) {
+		// Hold up the port's reads, so received bytes are left waiting in the driver
+		dispatch_suspend(readPollSource);
+		self.receiveBacklogWarningExpectation = [self expectationWithDescription:@"Receive backlog warning"];
+		char bytes[2 * 64];
+		memset(bytes, 'x', sizeof(bytes));
+		XCTAssertEqual(write(master, bytes, sizeof(bytes)), (ssize_t)sizeof(bytes), @"Writing to pseudo terminal failed.");
+		[self waitForExpectationsWithTimeout:10 * ORSSerialPortMonitorInterval handler:nil];
+		
+		// Later samples are still above the threshold
+		self.receiveBacklogWarningExpectation = [self expectationWithDescription:@"Repeated receive backlog warning"];
+		self.receiveBacklogWarningExpectation.inverted = YES;
+		[self waitForExpectationsWithTimeout:4 * ORSSerialPortMonitorInterval handler:nil];
+		self.receiveBacklogWarningExpectation = nil;
+		
+		// Drain the backlog, and wait until that's been sampled, so the next write crosses the threshold again
+		dispatch_resume(readPollSource);
+		[self expectationForPredicate:[NSPredicate predicateWithFormat:@"statistics.receiveBacklog < 64"] evaluatedWithObject:port handler:nil];
+		[self waitForExpectationsWithTimeout:10 * ORSSerialPortMonitorInterval handler:nil];
+	}
+	
+	XCTAssertEqual([self.receiveBacklogWarnings count], crossingCount, @"Incorrect number of receive backlog warnings.");
+	for (NSNumber *byteCount in self.receiveBacklogWarnings) {
+		XCTAssertGreaterThanOrEqual([byteCount unsignedIntegerValue], (NSUInteger)64, @"Warned of a backlog below the threshold.");
+	}
+	XCTAssertEqual(port.statistics.receiveBacklogWarningCount, (unsigned long long)crossingCount, @"Incorrect receive backlog warning count.");
+}
+
+- (void)testXONXOFFFlowControl
+{
+	ORSSerialPort *port = [self.ports firstObject];
+	port.usesXONXOFFFlowControl = YES;
+	[port open];
+	XCTAssertTrue(port.isOpen, @"Unable to open pseudo terminal.");
+	
+	int master = [[self.masterFileDescriptors firstObject] intValue];
+	struct pollfd pollDescriptor = { .fd = master, .events = POLLIN };
+	write(master, "\x13", 1); // XOFF
+	[NSThread sleepForTimeInterval:0.05];
+	XCTAssertTrue([port sendData:[@"abc" dataUsingEncoding:NSASCIIStringEncoding]], @"Sending data failed.");
+	XCTAssertEqual(poll(&pollDescriptor, 1, 200), 0, @"Data transmitted after XOFF received.");
+	
+	write(master, "\x11", 1); // XON
+	XCTAssertEqual(poll(&pollDescriptor, 1, 1000), 1, @"Data not transmitted after XON received.");
+	char buffer[16];
+	XCTAssertEqual(read(master, buffer, sizeof(buffer)), (ssize_t)3, @"Incorrect number of bytes transmitted.");
+}
+
+- (void)testBaudRateDetection
+{
+	ORSSerialPort *port = [self.ports firstObject];
+	[port open];
+	XCTAssertTrue(port.isOpen, @"Unable to open pseudo terminal.");
+	
+	ORSSerialPacketDescriptor *descriptor = [[ORSSerialPacketDescriptor alloc] initWithPacketData:[@"OK" dataUsingEncoding:NSASCIIStringEncoding] userInfo:nil];
+	ORSSerialRequest *request = [ORSSerialRequest requestWithDataToSend:[@"ID?" dataUsingEncoding:NSASCIIStringEncoding]
+															   userInfo:nil
+														timeoutInterval:0.5
+													 responseDescriptor:descriptor];
+	XCTestExpectation *detected = [self expectationWithDescription:@"Baud rate detected"];
+	[port detectBaudRateFromCandidates:@[@9600, @115200] probeRequest:request completionHandler:^(NSNumber *baudRate, NSError *error) {
+		XCTAssertNil(error, @"Baud rate detection failed: %@", error);
+		XCTAssertEqualObjects(baudRate, @9600, @"Incorrect baud rate detected.");
+		XCTAssertEqualObjects(port.baudRate, @9600, @"Baud rate not set to detected rate.");
+		[detected fulfill];
+	}];
+	
+	// Pseudo terminals work at any rate, so the first one gets a response
+	int master = [[self.masterFileDescriptors firstObject] intValue];
+	char buffer[16];
+	XCTAssertEqual(read(master, buffer, sizeof(buffer)), (ssize_t)3, @"Probe request not sent.");
+	write(master, "OK", 2);
+	[self waitForExpectationsWithTimeout:2.0 handler:nil];
+}
+
+- (void)testDeviceDiscovery
+{
+	NSArray *ports = [self.ports subarrayWithRange:NSMakeRange(0, 4)];
+	ORSSerialPacketDescriptor *descriptor = [[ORSSerialPacketDescriptor alloc] initWithPrefixString:@"ID:" suffixString:@"\n" maximumPacketLength:16 userInfo:nil];
+	ORSSerialRequest *request = [ORSSerialRequest requestWithDataToSend:[@"ID?" dataUsingEncoding:NSASCIIStringEncoding]
+															   userInfo:nil
+														timeoutInterval:-1.0
+													 responseDescriptor:descriptor];
+	
+	// Devices on all but the last port answer
+	NSArray *masters = [self.masterFileDescriptors subarrayWithRange:NSMakeRange(0, 3)];
+	[masters enumerateObjectsUsingBlock:^(NSNumber *master, NSUInteger idx, BOOL *stop) {
+		dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+			char buffer[16];
+			if (read([master intValue], buffer, sizeof(buffer)) <= 0) return;
+			NSString *response = [NSString stringWithFormat:@"ID:%lu\n", (unsigned long)idx];
+			write([master intValue], [response UTF8String], [response length]);
+		});
+	}];
+	
+	XCTestExpectation *discovered = [self expectationWithDescription:@"Devices discovered"];
+	NSDate *startDate = [NSDate date];
+	[[ORSSerialPortManager sharedSerialPortManager] discoverDevicesOnPorts:ports probeRequest:request timeout:0.5 completionHandler:^(NSDictionary *responsesByPath) {
+		XCTAssertEqual([responsesByPath count], (NSUInteger)3, @"Incorrect number of devices discovered.");
+		for (NSUInteger i=0; i<3; i++) {
+			NSData *expected = [[NSString stringWithFormat:@"ID:%lu\n", (unsigned long)i] dataUsingEncoding:NSASCIIStringEncoding];
+			XCTAssertEqualObjects(responsesByPath[[ports[i] path]], expected, @"Incorrect response for port %lu.", (unsigned long)i);
+		}
+		XCTAssertLessThan([[NSDate date] timeIntervalSinceDate:startDate], 1.0, @"Discovery didn't finish at its deadline.");
+		for (ORSSerialPort *port in ports) XCTAssertFalse(port.isOpen, @"Port opened for discovery left open.");
+		[discovered fulfill];
+	}];
+	[self waitForExpectationsWithTimeout:2.0 handler:nil];
+}
+
+// The test case isn't the port's delegate, so this also covers delegates without -serialPortWasClosed:
+- (void)testClosingPortDiscardsRequests
+{
+	ORSSerialPort *port = [self.ports firstObject];
+	[port open];
+	XCTAssertTrue(port.isOpen, @"Unable to open pseudo terminal.");
+	
+	NSData *data = [@"AT" dataUsingEncoding:NSASCIIStringEncoding];
+	ORSSerialPacketDescriptor *descriptor = [[ORSSerialPacketDescriptor alloc] initWithPacketData:[@"OK" dataUsingEncoding:NSASCIIStringEncoding] userInfo:nil];
+	XCTestExpectation *responded = [self expectationWithDescription:@"Response handler called"];
+	ORSSerialRequest *request = [ORSSerialRequest requestWithDataToSend:data userInfo:nil timeoutInterval:10.0 responseDescriptor:descriptor];
+	XCTAssertTrue([port sendRequest:request responseHandler:^(NSData *response) {
+		XCTAssertNil(response, @"Response handler got a response from a closed port.");
+		[responded fulfill];
+	}], @"Sending request failed.");
+	XCTAssertTrue([port sendRequest:[ORSSerialRequest requestWithDataToSend:data userInfo:nil timeoutInterval:10.0 responseDescriptor:descriptor]],
+				  @"Sending request failed.");
+	
+	[port close];
+	[self waitForExpectationsWithTimeout:1.0 handler:nil];
+	
+	XCTAssertNil(port.pendingRequest, @"Pending request kept after closing.");
+	XCTAssertEqual([port.queuedRequests count], (NSUInteger)0, @"Queued requests kept after closing.");
+}
+
+- (void)testMetadata
+{
+	XCTSkipIf(![[[ORSSerialPortManager sharedSerialPortManager] availablePorts] count], @"No serial ports to read metadata from.");
+	for (ORSSerialPort *port in [[ORSSerialPortManager sharedSerialPortManager] availablePorts]) {
+		XCTAssertNotNil(port.metadata, @"No metadata for %@.", port);
+		XCTAssertEqualObjects(port.metadata.path, port.path, @"Incorrect path in metadata for %@.", port);
+		XCTAssertTrue(port.metadata.registryEntryID != 0, @"No registry entry ID in metadata for %@.", port);
+		XCTAssertEqual([ORSSerialPort serialPortWithPath:port.path], port, @"Port created by path isn't the existing port.");
+	}
+}
+
+- (void)testPortMatchingRules
+{
+	ORSSerialPortManager *manager = [ORSSerialPortManager sharedSerialPortManager];
+	XCTSkipIf(![manager.availablePorts count], @"No serial ports to match rules against.");
+	ORSSerialPortMatchingRule *anyPort = [ORSSerialPortMatchingRule ruleWithName:@"Any" vendorID:nil productID:nil serialNumber:nil locationID:nil];
+	ORSSerialPortMatchingRule *noPort = [ORSSerialPortMatchingRule ruleWithName:@"None" vendorID:@0xFFFFF productID:nil serialNumber:nil locationID:nil];
+	[manager addPortMatchingRule:anyPort];
+	[manager addPortMatchingRule:noPort];
+	
+	ORSSerialPort *port = [manager portMatchingRuleNamed:@"Any"];
+	XCTAssertTrue([manager.availablePorts containsObject:port], @"Rule matching any port didn't match an available port.");
+	XCTAssertNil([manager portMatchingRuleNamed:@"None"], @"Rule matching no port matched %@.", [manager portMatchingRuleNamed:@"None"]);
+	
+	[manager removePortMatchingRule:anyPort];
+	[manager removePortMatchingRule:noPort];
+	XCTAssertNil([manager portMatchingRuleNamed:@"Any"], @"Removed rule still matches a port.");
+}
+
+- (void)testMatchingRuleMatchesMetadata
+{
+	ORSSerialPortMetadata *metadata = [[ORSSerialPortMetadata alloc] initWithVendorID:@0x0403 productID:@0x6001 serialNumber:@"A1B2C3" locationID:@0x14200000];
+	ORSSerialPortMatchingRule *anyPort = [ORSSerialPortMatchingRule ruleWithName:@"Any" vendorID:nil productID:nil serialNumber:nil locationID:nil];
+	ORSSerialPortMatchingRule *sameModel = [ORSSerialPortMatchingRule ruleWithName:@"Model" vendorID:@0x0403 productID:@0x6001 serialNumber:nil locationID:nil];
+	ORSSerialPortMatchingRule *sameDevice = [ORSSerialPortMatchingRule ruleWithName:@"Device" vendorID:@0x0403 productID:@0x6001 serialNumber:@"A1B2C3" locationID:@0x14200000];
+	ORSSerialPortMatchingRule *otherVendor = [ORSSerialPortMatchingRule ruleWithName:@"Vendor" vendorID:@0x067B productID:@0x6001 serialNumber:nil locationID:nil];
+	ORSSerialPortMatchingRule *otherSerialNumber = [ORSSerialPortMatchingRule ruleWithName:@"Serial" vendorID:nil productID:nil serialNumber:@"Z9Y8X7" locationID:nil];
+	ORSSerialPortMatchingRule *otherLocation = [ORSSerialPortMatchingRule ruleWithName:@"Location" vendorID:nil productID:nil serialNumber:nil locationID:@0x14300000];
+	
+	XCTAssertTrue([anyPort matchesMetadata:metadata], @"Rule with no criteria didn't match.");
+	XCTAssertTrue([sameModel matchesMetadata:metadata], @"Rule matching vendor and product IDs didn't match.");
+	XCTAssertTrue([sameDevice matchesMetadata:metadata], @"Rule matching every property didn't match.");
+	XCTAssertFalse([otherVendor matchesMetadata:metadata], @"Rule with a different vendor ID matched.");
+	XCTAssertFalse([otherSerialNumber matchesMetadata:metadata], @"Rule with a different serial number matched.");
+	XCTAssertFalse([otherLocation matchesMetadata:metadata], @"Rule with a different location ID matched.");
+	
+	// A criterion can't match a property the port doesn't have
+	ORSSerialPortMetadata *noSerialNumber = [[ORSSerialPortMetadata alloc] initWithVendorID:@0x0403 productID:@0x6001 serialNumber:nil locationID:nil];
+	XCTAssertTrue([sameModel matchesMetadata:noSerialNumber], @"Rule matching vendor and product IDs didn't match.");
+	XCTAssertFalse([sameDevice matchesMetadata:noSerialNumber], @"Rule matched a port without a serial number.");
+	
+	// Pseudo terminals have no IOKit metadata, so don't match
+	XCTAssertNil([[self.ports firstObject] metadata], @"Pseudo terminal has metadata.");
+	XCTAssertFalse([anyPort matchesMetadata:[[self.ports firstObject] metadata]], @"Rule matched port without metadata.");
+}
+
+// Pseudo terminals stand in for the manager's available ports, since sleep/wake handling only closes those
+- (void)testClosingAndReopeningPortsAcrossSleep
+{
+	[self addPseudoTerminalsUpToCount:ORSTFleetPseudoTerminalCount];
+	ORSSerialPortManager *manager = [self sharedManagerWithAvailablePorts:self.ports];
+	NSArray *openPorts = [self.ports subarrayWithRange:NSMakeRange(0, [self.ports count] / 2)];
+	XCTAssertTrue([openPorts count] > 0, @"Unable to create pseudo terminals.");
+	NSArray *observedPorts = [self.ports copy];
+	for (ORSSerialPort *port in observedPorts) [port addObserver:self forKeyPath:@"isOpen" options:0 context:NULL];
+	[self addTeardownBlock:^{
+		for (ORSSerialPort *port in observedPorts) [port removeObserver:self forKeyPath:@"isOpen"];
+	}];
+	
+	XCTestExpectation *opened = [self expectationWithDescription:@"Ports opened"];
+	[manager openPorts:openPorts completionHandler:^(NSArray *failedPorts) { [opened fulfill]; }];
+	[self waitForExpectationsWithTimeout:5.0 handler:nil];
+	
+	XCTestExpectation *closed = [self expectationWithDescription:@"Ports closed for sleep"];
+	[manager closePortsForSystemSleepWithCompletionHandler:^{
+		for (ORSSerialPort *port in self.ports) XCTAssertFalse(port.isOpen, @"%@ still open after closing for sleep.", port);
+		[closed fulfill];
+	}];
+	[self waitForExpectationsWithTimeout:5.0 handler:nil];
+	
+	XCTestExpectation *reopened = [self expectationWithDescription:@"Ports reopened after wake"];
+	[manager reopenPortsAfterSystemWakeWithCompletionHandler:^{ [reopened fulfill]; }];
+	[self waitForExpectationsWithTimeout:5.0 handler:nil];
+	
+	for (ORSSerialPort *port in self.ports) {
+		XCTAssertEqual(port.isOpen, [openPorts containsObject:port], @"%@ in wrong state after wake.", port);
+	}
+	XCTAssertTrue(manager.lastWakeRecoveryTime > 0, @"Wake recovery time not recorded.");
+	XCTAssertFalse(self.isOpenChangedOffMainThread, @"isOpen changed off the main thread.");
+}
+
+- (void)testWakeBeforePortsFinishClosingForSleep
+{
+	[self addPseudoTerminalsUpToCount:ORSTFleetPseudoTerminalCount];
+	ORSSerialPortManager *manager = [self sharedManagerWithAvailablePorts:self.ports];
+	
+	XCTestExpectation *opened = [self expectationWithDescription:@"Ports opened"];
+	[manager openPorts:self.ports completionHandler:^(NSArray *failedPorts) { [opened fulfill]; }];
+	[self waitForExpectationsWithTimeout:5.0 handler:nil];
+	
+	// Wake right away, without waiting for the ports to close
+	XCTestExpectation *closed = [self expectationWithDescription:@"Ports closed for sleep"];
+	XCTestExpectation *reopened = [self expectationWithDescription:@"Ports reopened after wake"];
+	[manager closePortsForSystemSleepWithCompletionHandler:^{ [closed fulfill]; }];
+	[manager reopenPortsAfterSystemWakeWithCompletionHandler:^{ [reopened fulfill]; }];
+	[self waitForExpectationsWithTimeout:5.0 handler:nil];
+	
+	for (ORSSerialPort *port in self.ports) XCTAssertTrue(port.isOpen, @"%@ not reopened after wake.", port);
+}
+
+#pragma mark - Performance
+
+// Measures the time from requesting that all ports be opened until every one of them is ready
+- (void)testPerformanceOpeningManyPorts
+{
+	[self addPseudoTerminalsUpToCount:ORSTFleetPseudoTerminalCount];
+	XCTAssertEqual([self.ports count], ORSTFleetPseudoTerminalCount, @"Unable to create pseudo terminals.");
+	ORSSerialPortManager *manager = [ORSSerialPortManager sharedSerialPortManager];
+	
+	[self measureMetrics:@[XCTPerformanceMetric_WallClockTime] automaticallyStartMeasuring:NO forBlock:^{
+		XCTestExpectation *opened = [self expectationWithDescription:@"All ports opened"];
+		[self startMeasuring];
+		[manager openPorts:self.ports completionHandler:^(NSArray *failedPorts) {
+			[self stopMeasuring];
+			XCTAssertEqual([failedPorts count], (NSUInteger)0, @"Ports failed to open: %@", failedPorts);
+			[opened fulfill];
+		}];
+		[self waitForExpectationsWithTimeout:10.0 handler:nil];
+		
+		XCTestExpectation *closed = [self expectationWithDescription:@"All ports closed"];
+		[manager closePorts:self.ports completionHandler:^(NSArray *failedPorts) {
+			XCTAssertEqual([failedPorts count], (NSUInteger)0, @"Ports failed to close: %@", failedPorts);
+			[closed fulfill];
+		}];
+		[self waitForExpectationsWithTimeout:10.0 handler:nil];
+	}];
+}
+
+// Reports wakeups per second and CPU use per port while all ports are open but idle, with and
+// without conservesIdleWakeups, in an attachment kept with the test results. Counts are for the
+// whole process, so include background noise. That's too unreliable for a tight bound, but 64
+// ports each polling every 10 ms should still wake more than the shared, slowed down timer.
+- (void)testPerformanceIdleWakeups
+{
+	[self addPseudoTerminalsUpToCount:ORSTFleetPseudoTerminalCount];
+	XCTAssertEqual([self.ports count], ORSTFleetPseudoTerminalCount, @"Unable to create pseudo terminals.");
+	ORSSerialPortManager *manager = [ORSSerialPortManager sharedSerialPortManager];
+	NSTimeInterval duration = 2.0;
+	mach_timebase_info_data_t timebase;
+	mach_timebase_info(&timebase);
+	double wakeupsPerSecond[2] = {0, 0};
+	NSMutableString *report = [NSMutableString string];
+	
+	for (NSUInteger conserves=0; conserves<2; conserves++) {
+		for (ORSSerialPort *port in self.ports) port.conservesIdleWakeups = (conserves != 0);
+		
+		XCTestExpectation *opened = [self expectationWithDescription:@"All ports opened"];
+		[manager openPorts:self.ports completionHandler:^(NSArray *failedPorts) {
+			XCTAssertEqual([failedPorts count], (NSUInteger)0, @"Ports failed to open: %@", failedPorts);
+			[opened fulfill];
+		}];
+		[self waitForExpectationsWithTimeout:10.0 handler:nil];
+		
+		// Give adaptive polling time to slow down to its maximum interval
+		[[NSRunLoop currentRunLoop] runUntilDate:[NSDate dateWithTimeIntervalSinceNow:1.5]];
+		
+		struct rusage_info_v3 before, after;
+		XCTAssertEqual(proc_pid_rusage(getpid(), RUSAGE_INFO_V3, (rusage_info_t *)&before), 0);
+		[[NSRunLoop currentRunLoop] runUntilDate:[NSDate dateWithTimeIntervalSinceNow:duration]];
+		XCTAssertEqual(proc_pid_rusage(getpid(), RUSAGE_INFO_V3, (rusage_info_t *)&after), 0);
+		
+		uint64_t wakeups = (after.ri_pkg_idle_wkups + after.ri_interrupt_wkups) - (before.ri_pkg_idle_wkups + before.ri_interrupt_wkups);
+		uint64_t CPUTime = (after.ri_user_time + after.ri_system_time) - (before.ri_user_time + before.ri_system_time);
+		double CPUSeconds = (double)CPUTime * timebase.numer / timebase.denom / NSEC_PER_SEC;
+		wakeupsPerSecond[conserves] = wakeups / duration;
+		[report appendFormat:@"conservesIdleWakeups = %@: %.0f wakeups/s, %.4f%% CPU per idle port\n", conserves ? @"YES" : @"NO",
+		 wakeupsPerSecond[conserves], 100.0 * CPUSeconds / duration / [self.ports count]];
+		
+		XCTestExpectation *closed = [self expectationWithDescription:@"All ports closed"];
+		[manager closePorts:self.ports completionHandler:^(NSArray *failedPorts) { [closed fulfill]; }];
+		[self waitForExpectationsWithTimeout:10.0 handler:nil];
+	}
+	
+	XCTAttachment *attachment = [XCTAttachment attachmentWithString:report];
+	attachment.name = @"Idle wakeups";
+	attachment.lifetime = XCTAttachmentLifetimeKeepAlways;
+	[self addAttachment:attachment];
+	XCTAssertLessThan(wakeupsPerSecond[1], wakeupsPerSecond[0], @"Conserving idle wakeups didn't reduce them.\n%@", report);
+}
+
 @end